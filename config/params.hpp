@@ -3,7 +3,6 @@
 
 #define RENDER_THREAD_SLEEP_MS 0//6
 #define INFO_THREAD_SLEEP_MS   50
-#define MESH_THREAD_SLEEP_MS   10
 #define MAIN_THREAD_SLEEP_MS   20
 #define PHYSICS_TIMESTEP_MS    10
 #define BLOCK_TIMESTEP_MS      50
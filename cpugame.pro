@@ -30,8 +30,8 @@ SOURCES += source/src/compute/*.cpp source/src/graphics/*.cpp source/src/gui/*.c
 #SOURCES += libs/tinyobjloader/tiny_obj_loader.cc
 
 # Paths
-DEPENDPATH = ./source/src/compute ./source/src/graphics ./source/src/gui ./source/src/math ./source/src/threading ./source/src/tools ./source/src/voxels ./source/src ./libs/FastNoise ./libs/FastNoiseSIMD/FastNoiseSIMD
-INCLUDEPATH = ./config ./source/inc/compute ./source/inc/graphics ./source/inc/gui ./source/inc/math ./source/inc/threading ./source/inc/tools ./source/inc/voxels ./source/inc ./libs/FastNoise ./libs/FastNoiseSIMD/FastNoiseSIMD
+DEPENDPATH = ./source/src/compute ./source/src/graphics ./source/src/gui ./source/src/math ./source/src/threading ./source/src/tools ./source/src/voxels ./source/src ./libs/FastNoise
+INCLUDEPATH = ./config ./source/inc/compute ./source/inc/graphics ./source/inc/gui ./source/inc/math ./source/inc/threading ./source/inc/tools ./source/inc/voxels ./source/inc ./libs/FastNoise
 
 OBJECTS_DIR = build/.obj
 MOC_DIR = build/.moc
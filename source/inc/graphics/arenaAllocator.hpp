@@ -0,0 +1,45 @@
+#ifndef ARENA_ALLOCATOR_HPP
+#define ARENA_ALLOCATOR_HPP
+
+#include <map>
+#include <vector>
+
+// Sub-allocator for one large buffer (offsets/sizes are in elements, not bytes).
+//  - first-fit over a free list of ranges, coalesced when freed
+//  - CPU-side only (no GL) -- the owner applies the moves returned by compact() to the actual buffer
+class ArenaAllocator
+{
+public:
+  struct Move
+  {
+    int from;
+    int to;
+    int size;
+  };
+  
+  ArenaAllocator(int capacity = 0);
+
+  int capacity() const { return mCapacity; }
+  int used() const     { return mUsed; }
+  int available() const { return mCapacity - mUsed; }
+  int largestFree() const;
+  int numAllocations() const { return mAllocated.size(); }
+
+  // returns offset of allocated range, or -1 if there's no free range big enough
+  int allocate(int size);
+  void free(int offset);
+  void clear();
+  
+  // packs all allocations (in offset order) to the start of an arena with the given capacity
+  //  - newCapacity must be at least used()
+  //  - returns every allocation's old and new offset (copy each into the new buffer)
+  std::vector<Move> compact(int newCapacity);
+
+private:
+  int mCapacity = 0;
+  int mUsed = 0;
+  std::map<int, int> mFree;      // offset --> size
+  std::map<int, int> mAllocated; // offset --> size
+};
+
+#endif // ARENA_ALLOCATOR_HPP
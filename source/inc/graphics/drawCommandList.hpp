@@ -0,0 +1,48 @@
+#ifndef DRAW_COMMAND_LIST_HPP
+#define DRAW_COMMAND_LIST_HPP
+
+#include "vector.hpp"
+#include <vector>
+#include <cstdint>
+
+// location of a mesh within a MeshArena (in vertices/indices)
+struct ArenaMesh
+{
+  int vOffset = -1;
+  int numVertices = 0;
+  int vCapacity = 0;  // (allocated -- mesh can be patched in place while it fits)
+  int iOffset = -1;
+  int numIndices = 0;
+  int iCapacity = 0;
+  int indexBase = 0;  // value of the mesh's first vertex index (subtracted when drawn)
+};
+
+// matches GL's DrawElementsIndirectCommand
+struct DrawCommand
+{
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t  baseVertex;
+  uint32_t baseInstance;
+};
+
+// Indirect draw commands for one glMultiDrawElementsIndirect call.
+//  - each draw gets one instance, whose baseInstance indexes its entry in positions()
+//    (chunk mesh vertices are relative to the chunk)
+class DrawCommandList
+{
+public:
+  void clear();
+  void add(const ArenaMesh &mesh, const Point3f &chunkPos);
+
+  int size() const { return mCommands.size(); }
+  const std::vector<DrawCommand>& commands() const { return mCommands; }
+  const std::vector<Point3f>& positions() const    { return mPositions; }
+
+private:
+  std::vector<DrawCommand> mCommands;
+  std::vector<Point3f> mPositions;
+};
+
+#endif // DRAW_COMMAND_LIST_HPP
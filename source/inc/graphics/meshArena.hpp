@@ -0,0 +1,67 @@
+#ifndef MESH_ARENA_HPP
+#define MESH_ARENA_HPP
+
+#include "hashing.hpp"
+#include "meshData.hpp"
+#include "arenaAllocator.hpp"
+#include "drawCommandList.hpp"
+#include "meshing.hpp"
+
+#include <array>
+#include <unordered_map>
+
+#include <QOpenGLFunctions_4_3_Core>
+
+#define MESH_ARENA_VERTICES (4*1024*1024) // initial capacity (grows as needed)
+#define MESH_ARENA_INDICES  (6*1024*1024)
+
+// Shared vertex/index buffers holding every chunk's block mesh.
+//  - chunk section meshes are sub-allocated from the arena (see ArenaAllocator), and drawn
+//    together with a single glMultiDrawElementsIndirect
+//  - a remeshed section is written over its old data if it fits (allocations have some slack)
+//  - when an allocation doesn't fit, live meshes are compacted into new buffers
+//    (doubled in size if needed)
+// make sure to only use this from the OpenGL thread!
+class MeshArena : protected QOpenGLFunctions_4_3_Core
+{
+public:
+  typedef std::array<ArenaMesh, ChunkBounds::numSections> ChunkSections;
+  
+  MeshArena();
+  ~MeshArena();
+
+  bool initGL(int numVertices = MESH_ARENA_VERTICES, int numIndices = MESH_ARENA_INDICES);
+  void cleanupGL();
+  bool initialized() const { return mVao != 0; }
+
+  int numMeshes() const { return mMeshes.size(); }
+  const ChunkSections* find(hash_t hash) const;
+
+  // updates the sections in sections.mask (replacing their old meshes)
+  bool upload(hash_t hash, const BlockMeshData &data, const MeshSections &sections);
+  // same, but copies mesh data from another GL buffer (vertices at srcOffset, indices directly after)
+  bool copy(hash_t hash, const BlockMeshData &data, const MeshSections &sections,
+            GLuint srcBuffer, int srcOffset );
+  void remove(hash_t hash);
+  void clear();
+
+  void render(const DrawCommandList &draws);
+
+private:
+  GLuint mVao = 0;
+  GLuint mVbo = 0;
+  GLuint mIbo = 0;
+  GLuint mInstanceBuffer = 0; // chunk positions (one per draw)
+  GLuint mIndirectBuffer = 0;
+  ArenaAllocator mVertices;
+  ArenaAllocator mIndices;
+  std::unordered_map<hash_t, ChunkSections> mMeshes;
+
+  // (returns mesh to write section data to -- reallocated if it doesn't fit)
+  ArenaMesh* allocate(hash_t hash, int section, int numVertices, int numIndices);
+  int allocate(ArenaAllocator &alloc, GLuint &buffer, int elementSize, int size);
+  void free(ArenaMesh &mesh);
+  void bindAttributes();
+};
+
+#endif // MESH_ARENA_HPP
@@ -0,0 +1,84 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "hashing.hpp"
+#include "meshData.hpp"
+#include "meshing.hpp"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#define MESH_CACHE_SIZE (64*1024*1024) // default memory cap (bytes)
+#define MESH_CACHE_FILE "meshes.cache" // (in world directory, if saved)
+
+// LRU cache of built chunk meshes, keyed by chunk position.
+//  - an entry is only used if the content hash of the chunk and its border (see PaddedChunk)
+//    still matches, so modified chunks miss and are replaced
+//  - also keeps the chunk's active faces, so a hit skips calcBounds as well as vertex generation
+//    (LOD meshes also keep the chunk's full resolution faces, since fluids still need them)
+class MeshCache
+{
+public:
+  MeshCache(long maxBytes = MESH_CACHE_SIZE);
+
+  void setMaxBytes(long maxBytes);
+  long maxBytes() const { return mMaxBytes; }
+  long bytes();
+  int size();
+  void clear();
+
+  // on a hit, copies cached mesh (all sections) and faces into meshOut/sectionsOut/facesOut
+  //  (and full resolution faces into chunkFacesOut, if given)
+  bool get(hash_t hash, uint64_t contentHash, bool greedy, BlockMeshData &meshOut,
+           MeshSections &sectionsOut, std::vector<ActiveBlock> &facesOut,
+           std::vector<ActiveBlock> *chunkFacesOut = nullptr );
+  // (mesh must include all sections)
+  void put(hash_t hash, uint64_t contentHash, bool greedy, const BlockMeshData &mesh,
+           const MeshSections &sections, const std::vector<ActiveBlock> &faces,
+           const std::vector<ActiveBlock> *chunkFaces = nullptr );
+
+  long hits() const   { return mHits; }
+  long misses() const { return mMisses; }
+  void resetStats()   { mHits = 0; mMisses = 0; }
+
+  // (for fast startup -- entries are checked against chunk contents as usual when loaded)
+  bool save(const std::string &path);
+  bool load(const std::string &path);
+  
+private:
+  struct Entry
+  {
+    hash_t hash;
+    uint64_t contentHash;
+    bool greedy;
+    std::vector<cBlockVertex> vertices;
+    std::vector<unsigned int> indices;
+    MeshSections sections;
+    std::vector<ActiveBlock> faces;
+    std::vector<ActiveBlock> chunkFaces; // (full resolution faces -- LOD meshes only)
+
+    long bytes() const
+    {
+      return (sizeof(Entry) + sizeof(cBlockVertex)*vertices.size() + sizeof(unsigned int)*indices.size() +
+              sizeof(ActiveBlock)*(faces.size() + chunkFaces.size()) );
+    }
+  };
+
+  std::mutex mLock;
+  std::list<Entry> mEntries; // (most recently used first)
+  std::unordered_map<hash_t, std::list<Entry>::iterator> mLookup;
+  long mMaxBytes;
+  long mBytes = 0;
+  std::atomic<long> mHits = 0;
+  std::atomic<long> mMisses = 0;
+
+  void insert(Entry &&entry, bool front);
+  void evict();
+};
+
+#endif // MESH_CACHE_HPP
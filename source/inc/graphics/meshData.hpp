@@ -4,26 +4,30 @@
 #include <vector>
 #include "vertex.hpp"
 
-class MeshData
+template<typename VertexT>
+class MeshDataT
 {
 public:
-  MeshData(bool doubleBuffer = false);
-  ~MeshData();
+  MeshDataT(bool doubleBuffer = false);
+  ~MeshDataT();
 
   bool empty() const;
   void swap();
 
-  const std::vector<cSimpleVertex>& vertices() const { return mVertices[mActive]; }
+  const std::vector<VertexT>& vertices() const { return mVertices[mActive]; }
   const std::vector<unsigned int>& indices() const { return mIndices[mActive]; }
-  std::vector<cSimpleVertex>& vertices() { return mVertices[mActive]; }
+  std::vector<VertexT>& vertices() { return mVertices[mActive]; }
   std::vector<unsigned int>& indices() { return mIndices[mActive]; }
 
 private:
-  std::vector<cSimpleVertex> mVertices[2];
+  std::vector<VertexT> mVertices[2];
   std::vector<unsigned int> mIndices[2];
   int mActive = 0;
   bool mDoubleBuffer;
 };
 
+typedef MeshDataT<cSimpleVertex> MeshData;
+typedef MeshDataT<cBlockVertex> BlockMeshData; // (chunk meshes)
+
 
 #endif // MESH_DATA_HPP
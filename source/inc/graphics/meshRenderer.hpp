@@ -5,10 +5,17 @@
 #include "camera.hpp"
 #include "hashing.hpp"
 #include "vector.hpp"
-#include "threadPool.hpp"
+#include "taskExecutor.hpp"
 #include "meshData.hpp"
 #include "matrix.hpp"
 #include "chunkMap.hpp"
+#include "threadQueue.hpp"
+#include "meshing.hpp"
+#include "uploadRing.hpp"
+#include "meshArena.hpp"
+#include "drawCommandList.hpp"
+#include "meshCache.hpp"
+#include "occlusionBuffer.hpp"
 
 #include <queue>
 #include <deque>
@@ -18,6 +25,15 @@
 #include <unordered_set>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+
+#define RENDER_QUEUE_SIZE 1024
+#define UNUSED_MC_SIZE 1024
+#define RENDER_UPLOAD_BUDGET 2.0f // default ms per frame spent uploading finished meshes
+#define VISIBLE_STATS_INTERVAL 600 // frames between visibility timing logs
+#define LOD_LEVELS 4     // level l is meshed from cells of 2^l blocks (1x, 2x, 4x, 8x)
+#define LOD_DISTANCE 4   // (chunks) full resolution within this distance of the center -- doubles each level
+#define LOD_HYSTERESIS 1 // (chunks) past a level's distance before a meshed chunk switches level
 
 class QObject;
 class Chunk;
@@ -39,9 +55,9 @@ public:
   MeshRenderer();
   ~MeshRenderer();
 
+  void setExecutor(TaskExecutor *executor) { mExecutor = executor; }
   void startMeshing();
   void stopMeshing();
-  void setMeshThreads(int meshThreads);
   void clearMeshes();
   
   bool initGL(QObject *qParent);
@@ -49,6 +65,7 @@ public:
   void render(const Matrix4 &pvm, const Point3f &camPos, bool reset = false);
   void setCamera(Camera *camera);
   void setFrustumCulling(bool on);
+  void setOcclusionCulling(bool on); // (only with frustum culling)
   void pauseFrustumCulling();
 
   MeshData makeFrustumMesh();
@@ -61,21 +78,45 @@ public:
     mFluidMeshes.clear();
   }
   int numMeshed();
+  int numVisible();
 
   bool isMeshed(hash_t hash);
   bool isMeshing(hash_t hash);
   bool isVisible(hash_t hash);
+  // true if any chunk within [minChunk, maxChunk] was drawn last frame
+  bool anyVisible(const Point3i &minChunk, const Point3i &maxChunk);
 
   void load(Chunk *chunk, const Point3i &center, bool priority);
   void reorderQueue(const Point3i &newCenter);
   void unload(hash_t hash);
+  // (for measuring block edit --> visible mesh latency)
+  void blockEdited(hash_t hash);
 
   void setFog(float fogStart, float fogEnd, const Vector3f &dirScale);
-  void setCenter(const Point3i &pos) { mCenter = pos; }
+  void setCenter(const Point3i &pos);
   void setRadius(const Vector3i &rad) { mRadius = rad; }
 
   void setMap(ChunkMap *map)
   { mMap = map; }
+  // merge coplanar faces into larger quads (takes effect for chunks meshed after)
+  void setGreedyMeshing(bool greedy) { mGreedyMeshing = greedy; }
+  bool greedyMeshing() const         { return mGreedyMeshing; }
+  void setUploadBudget(float ms) { mUploadBudget = ms; }
+  // level of detail -- distant chunks are meshed from downsampled blocks
+  //  (level by distance from the center, takes effect for chunks meshed after)
+  void setLodEnabled(bool on) { mLodEnabled = on; }
+  bool lodEnabled() const     { return mLodEnabled; }
+  // meshed chunks whose level changed with the center (need remeshing)
+  std::vector<hash_t> lodChanges();
+  float uploadBudget() const     { return mUploadBudget; }
+
+  // cache of built meshes (reloaded chunks with unchanged contents skip meshing)
+  void setMeshCacheSize(long bytes) { mMeshCache.setMaxBytes(bytes); }
+  long meshCacheHits() const        { return mMeshCache.hits(); }
+  long meshCacheMisses() const      { return mMeshCache.misses(); }
+  bool loadMeshCache(const std::string &path) { return mMeshCache.load(path); }
+  bool saveMeshCache(const std::string &path) { return mMeshCache.save(path); }
+  void clearMeshCache()                       { mMeshCache.clear(); }
 
   struct TraverseLine
   {
@@ -87,6 +128,18 @@ public:
   std::vector<TraverseLine> getRenderOrder()
   { std::lock_guard<std::mutex> lock(mRenderLock); return mRenderOrder; }
 
+  // chunk mesh quads (static -- see meshQuads.cpp)
+  //  - lighting is 0 to 3 per corner, from the blocks around the vertex (ambient occlusion)
+  //  - scale > 1 for faces on a LOD cell grid (see PaddedChunk::downsample)
+  static int getLighting(const PaddedChunk &padded, const Point3i &bp, const Point3f &vp,
+                         blockSide_t side );
+  // lighting of each corner, 2 bits each in faceVertices order (faces only merge if these match)
+  static uint32_t faceLighting(const PaddedChunk &padded, const Point3i &bp, blockSide_t side);
+  // quad covering size blocks from bp on the given side
+  static void addQuad(BlockMeshData &mesh, const Point3i &bp, const Vector3i &size, blockSide_t side,
+                      block_t type, uint32_t lighting, int scale = 1 );
+  static void addRect(BlockMeshData &mesh, const ActiveRect &rect, int scale = 1);
+
   
 private:
   // CUBE FACE INDICES
@@ -100,16 +153,22 @@ private:
   bool mInitialized = false;
   bool mFrustumCulling = true;
   bool mFrustumPaused = false;
+  bool mOcclusionCulling = true;
+  OcclusionBuffer mOcclusion;
+  std::atomic<bool> mGreedyMeshing = false;
+  std::atomic<float> mUploadBudget = RENDER_UPLOAD_BUDGET;
   Camera *mCamera = nullptr;
   Camera mPausedCamera;
 
   FluidManager *mFluids = nullptr;
   
   Shader *mBlockShader = nullptr;
+  Shader *mFluidShader = nullptr;
   cTextureAtlas *mTexAtlas = nullptr;
 
-  ThreadPool mMeshPool;
-  std::atomic<int> mWaitingThreads = 0;
+  TaskExecutor *mExecutor = nullptr;
+  std::atomic<bool> mMeshingActive = false;
+  int mActiveMeshTasks = 0; // mesh tasks submitted to executor
 
   bool mFogChanged = false;
   float mFogStart = 0.0f;
@@ -118,20 +177,36 @@ private:
 
   Vector3i mRadius;
   Point3i mCenter;
+
+  std::atomic<bool> mLodEnabled = true;
+  std::mutex mLodLock;
+  Point3i mLodCenter;
+  std::unordered_map<hash_t, int> mLods; // (level each chunk was meshed at)
+  // level for chunk at cp (current is its meshed level, or -1)
+  int lodLevel(const Point3i &cp, int current) const;
   
   struct MeshedChunk
   {
     hash_t hash = 0;
-    MeshData mesh;
+    BlockMeshData mesh;
+    MeshSections sections;     // (only sections in sections.mask were remeshed)
+    UploadRing::Region staged; // (mesh data copied to upload ring, if it had space)
   };
   
   std::mutex mMeshLock;
-  std::condition_variable mMeshCv;
-  std::condition_variable mPriorityCv;
+  std::condition_variable mMeshDoneCv;
   std::list<Chunk*> mMeshQueue;
   std::list<Chunk*> mPriorityMeshQueue;
   std::unordered_set<hash_t> mMeshing;
   
+  void queueRender(MeshedChunk *mc);
+  MeshedChunk* nextRender();
+  void recycleMC(MeshedChunk *mc);
+
+  // staging for mesh uploads (mesh workers --> GPU)
+  UploadRing mUploadRing;
+  void stageMesh(MeshedChunk *mc);
+  
   std::mutex mUnloadLock;
   std::unordered_set<hash_t> mUnloadQueue;
   
@@ -139,20 +214,22 @@ private:
   std::mutex mNowLock;
   std::unordered_set<hash_t> mMeshed;
   std::unordered_set<hash_t> mMeshingNow;
-  std::mutex mUnusedMCLock;
-  std::queue<MeshedChunk*> mUnusedMC;
+  ThreadQueue<MeshedChunk*> mUnusedMC{UNUSED_MC_SIZE};
   
   std::mutex mRenderLock;
-  std::unordered_map<hash_t, ChunkMesh*> mRenderMeshes;
+  MeshArena mArena;          // block meshes (all chunks share one set of buffers)
+  DrawCommandList mDrawList; // (visible chunk meshes -- rebuilt each frame)
   std::unordered_map<hash_t, ChunkMesh*> mFluidMeshes;
-  std::queue<ChunkMesh*> mUnusedMeshes;
+  std::queue<ChunkMesh*> mUnusedFluidMeshes;
   std::unordered_map<hash_t, Chunk*> mRenderChunks;
   std::mutex mChunkLock;
 
-  std::mutex mRenderQueueLock;
-  std::mutex mFRenderQueueLock;
-  std::queue<MeshedChunk*> mRenderQueue;
-  std::queue<MeshedChunk*> mFRenderQueue;
+  // meshed chunks waiting for upload (mesh workers --> render thread)
+  ThreadQueue<MeshedChunk*> mRenderQueue{RENDER_QUEUE_SIZE};
+  // (used when render queue fills up, until the render thread drains it)
+  std::mutex mOverflowLock;
+  std::queue<MeshedChunk*> mRenderOverflow;
+  std::atomic<int> mNumOverflow = 0;
   
   Shader *mComplexShader = nullptr;
   Shader *mMiniMapShader = nullptr;
@@ -161,21 +238,33 @@ private:
 
   std::vector<TraverseLine> mRenderOrder;
   std::unordered_set<hash_t> mVisible;
+  std::vector<hash_t> mVisibleHashes; // (reused every frame)
+  double mVisibleTime = 0.0;
+  long mVisibleChunks = 0;
+  long mOccludedChunks = 0;
+  int mVisibleFrames = 0;
 
   std::mutex mTimingLock;
   double mMeshTime = 0.0;
+  long mMeshVertices = 0;
   int mMeshNum = 0;
+  std::array<int, LOD_LEVELS> mMeshLods = {0};
   double mBoundsTime = 0.0;
   int mBoundsNum = 0;
 
+  MeshCache mMeshCache;
+
+  std::mutex mEditLock;
+  std::unordered_map<hash_t, std::chrono::high_resolution_clock::time_point> mEditTimes;
+
   ChunkMap *mMap;
   
-  void meshWorker(int tid);
-  block_t getBlock(Chunk *chunk, const Point3i &wp);
-  int getAO(int e1, int e2, int c);
-  int getLighting(Chunk *chunk, const Point3i &wp, const Point3f &vp,
-                  blockSide_t side );
+  void submitMesh();
+  void meshNext();
+  static int getAO(int e1, int e2, int c);
   void updateChunkMesh(Chunk *chunk);
+  void buildMesh(BlockMeshData &mesh, MeshSections &sections, uint32_t sectionMask,
+                 const PaddedChunk &padded, ChunkBounds *bounds, bool greedy, int lod );
   void addMesh(MeshedChunk *mc);
 };
 
@@ -0,0 +1,67 @@
+#ifndef UPLOAD_RING_HPP
+#define UPLOAD_RING_HPP
+
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+#include <QOpenGLFunctions_4_4_Core>
+
+#define UPLOAD_RING_SIZE (32*1024*1024) // bytes
+
+// Persistently mapped staging buffer for mesh uploads.
+//  - mesh workers reserve regions and write mesh data straight into mapped memory (any thread)
+//  - the render thread copies regions into mesh buffers on the GPU, then fences them
+//  - space is reused once a region's fence has signaled (reclaimed in reservation order)
+class UploadRing : protected QOpenGLFunctions_4_4_Core
+{
+public:
+  struct Region
+  {
+    uint64_t id = 0; // (0 if none)
+    int offset = 0;
+    int size = 0;
+  };
+  
+  UploadRing();
+  ~UploadRing();
+
+  // make sure to call these from the OpenGL thread
+  bool initGL(int size);
+  void cleanupGL();
+  bool initialized() const { return mData != nullptr; }
+  GLuint bufferId() const { return mBuffer; }
+
+  // returns false if there isn't enough free space (or the ring isn't initialized)
+  bool reserve(int size, Region &regionOut, char* &dataOut);
+  // true if region is still reserved (false after cleanupGL)
+  bool valid(const Region &region);
+  // (render thread) call after issuing the commands that read from region
+  void fence(const Region &region);
+  // region won't be read -- free without a fence
+  void discard(const Region &region);
+  // (render thread) frees regions whose fences have signaled
+  void reclaim();
+
+private:
+  struct Entry
+  {
+    uint64_t id;
+    int start;
+    int end;
+    bool done = false;      // fenced or discarded
+    GLsync sync = nullptr;
+  };
+  
+  std::mutex mLock;
+  GLuint mBuffer = 0;
+  char *mData = nullptr;
+  int mSize = 0;
+  int mHead = 0; // next free offset
+  uint64_t mNextId = 1;
+  std::deque<Entry> mEntries; // (in reservation order)
+
+  Entry* findEntry(uint64_t id);
+};
+
+#endif // UPLOAD_RING_HPP
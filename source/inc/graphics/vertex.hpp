@@ -2,6 +2,7 @@
 #define VERTEX_HPP
 
 #include "vector.hpp"
+#include <cstdint>
 
 struct cVertex
 {
@@ -36,6 +37,28 @@ struct cSimpleVertex
   { }
 };
 
+// packed chunk mesh vertex (decoded in simpleBlock.vsh)
+//  - bits 0-17:  position within chunk (6 bits per axis, 0 to Chunk::size inclusive)
+//  - bits 18-20: face index (normal_t)
+//  - bits 21-22: lighting (0 to 3)
+//  - bits 24-31: block type
+//  (texcoords are derived from position -- texture repeats per block)
+struct cBlockVertex
+{
+  uint32_t data = 0;
+
+  cBlockVertex() { }
+  cBlockVertex(const Point3i &p, int face, int lighting, int type)
+    : data((uint32_t)p[0] | ((uint32_t)p[1] << 6) | ((uint32_t)p[2] << 12) |
+           ((uint32_t)face << 18) | ((uint32_t)lighting << 21) | ((uint32_t)type << 24) )
+  { }
+
+  Point3i pos() const { return Point3i{(int)(data & 0x3F), (int)((data >> 6) & 0x3F), (int)((data >> 12) & 0x3F)}; }
+  int face() const     { return (data >> 18) & 0x7; }
+  int lighting() const { return (data >> 21) & 0x3; }
+  int type() const     { return (data >> 24) & 0xFF; }
+};
+
 struct QuadVertex
 {
   Point2f  pos;
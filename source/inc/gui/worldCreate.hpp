@@ -26,6 +26,8 @@ protected slots:
   void setChunkRadiusZ(int rz);
   void setLoadThreads(int threads);
   void setMeshThreads(int threads);
+  void setGreedyMesh(int on);
+  void setPersistMeshCache(int on);
   void createWorld();
   
 protected:
@@ -30,6 +30,8 @@ protected slots:
   void setChunkRadiusZ(int rz);
   void setLoadThreads(int threads);
   void setMeshThreads(int threads);
+  void setGreedyMesh(int on);
+  void setPersistMeshCache(int on);
   void selectWorld(int index);
   void loadWorld();
   void deleteWorld();
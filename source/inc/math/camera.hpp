@@ -4,6 +4,7 @@
 #include "vector.hpp"
 #include "meshData.hpp"
 #include "matrix.hpp"
+#include "frustum.hpp"
 
 class Camera
 {
@@ -35,6 +36,8 @@ public:
   bool pointInFrustum(const Point3f &p);
   bool sphereInFrustum(const Point3f &center, float radius);
   bool cubeInFrustum(const Point3f &pos, const Vector3f &size);
+  // (includes near/far planes -- use for batch culling)
+  const Frustum& getFrustum() const { return mFrustum; }
 
   MeshData makeDebugMesh();
 
@@ -72,6 +75,7 @@ private:
     Point3f normal;
   };
   Plane mPlanes[6];
+  Frustum mFrustum;
 
   void updateView();
   void updateProj();
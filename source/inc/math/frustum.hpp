@@ -0,0 +1,92 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include "vector.hpp"
+#include <cstdint>
+#include <vector>
+
+// View frustum as six planes, for culling axis-aligned boxes.
+//  - boxes are tested with the positive vertex of each plane (the corner furthest along its
+//    normal) -- a box is outside if that corner is outside any plane
+//  - cull() tests 8 (AVX) or 4 (SSE) boxes at once when the CPU supports it (picked at runtime)
+class Frustum
+{
+public:
+  enum class simd_t
+    {
+     SCALAR = 0,
+     SSE,
+     AVX
+    };
+  // best instruction set supported by this CPU
+  static simd_t supported();
+  static const char* toString(simd_t simd);
+
+  // (points inside satisfy normal.dot(p) + d >= 0)
+  struct Plane
+  {
+    Vector3f normal;
+    float d;
+  };
+  enum planeIndex_t
+    {
+     LEFT = 0,
+     RIGHT,
+     TOP,
+     BOTTOM,
+     FRONT, // (near)
+     BACK,  // (far)
+     NUM_PLANES
+    };
+
+  // boxes laid out as separate arrays (SoA) for batch culling
+  struct BoxList
+  {
+    std::vector<float> minX;
+    std::vector<float> minY;
+    std::vector<float> minZ;
+    std::vector<float> maxX;
+    std::vector<float> maxY;
+    std::vector<float> maxZ;
+
+    int size() const { return minX.size(); }
+    void clear();
+    void reserve(int n);
+    void add(const Point3f &minP, const Point3f &maxP);
+  };
+
+  Frustum();
+
+  void setPlane(planeIndex_t index, const Plane &plane);
+  const Plane& getPlane(planeIndex_t index) const { return mPlanes[index]; }
+  // (clamped to what the CPU supports)
+  void setSimd(simd_t simd);
+  simd_t getSimd() const { return mSimd; }
+
+  bool pointInside(const Point3f &p) const;
+  bool boxInside(const Point3f &minP, const Point3f &maxP) const;
+  // sets bit (i % 64) of maskOut[i / 64] if box i is at least partly inside -- clears the rest
+  //  (maskOut needs (n + 63) / 64 words)
+  void cull(const float *minX, const float *minY, const float *minZ,
+            const float *maxX, const float *maxY, const float *maxZ,
+            int n, uint64_t *maskOut ) const;
+  void cull(const BoxList &boxes, std::vector<uint64_t> &maskOut) const;
+
+private:
+  Plane mPlanes[NUM_PLANES];
+  simd_t mSimd = simd_t::SCALAR;
+
+  // (per plane -- which box bound each axis takes its positive vertex from)
+  struct PlaneArrays
+  {
+    const float *p[3];
+  };
+  void selectVertices(const float *const minP[3], const float *const maxP[3],
+                      PlaneArrays arrays[NUM_PLANES] ) const;
+
+  void cullScalar(const PlaneArrays arrays[NUM_PLANES], int start, int end, uint64_t *maskOut) const;
+  int cullSSE(const PlaneArrays arrays[NUM_PLANES], int n, uint64_t *maskOut) const;
+  int cullAVX(const PlaneArrays arrays[NUM_PLANES], int n, uint64_t *maskOut) const;
+};
+
+#endif // FRUSTUM_HPP
@@ -4,49 +4,122 @@
 #include "block.hpp"
 #include "blockSides.hpp"
 #include "hashing.hpp"
-#include <unordered_map>
+#include <vector>
+#include <array>
+#include <functional>
 #include <mutex>
 
+// block with at least one exposed face
 struct ActiveBlock
 {
   block_t block = block_t::NONE;
   blockSide_t sides = blockSide_t::NONE;
+  uint16_t index = 0; // block index within chunk (x + sizeX*(z + sizeZ*y))
 };
 
+// merged rectangle of faces on one side
+//  - pos/size are in the two dimensions perpendicular to the side (see ChunkBounds::rectDims)
 struct ActiveRect
 {
   block_t type;
   Point2i pos;
   Point2i size;
+  blockSide_t side = blockSide_t::NONE;
+  int depth = 0;     // position along side normal
+  uint32_t key = 0;  // extra face data that matched for all merged faces (24 bits)
 };
 
 class Chunk;
 
+// copy of a chunk's blocks plus a one-block border from its 26 neighbors
+//  - taken once per mesh job, so meshing needs no neighbor lookups and sees a consistent view of the blocks
+//  - block positions are chunk-relative, from -1 to Chunk::size (inclusive)
+class PaddedChunk
+{
+public:
+  static const int size = 34; // (Chunk::size + 2)
+  static const int totalSize = size*size*size;
+  typedef std::function<Chunk*(const Point3i &cp)> chunkLookup_t;
+
+  // missing neighbors are padded with empty blocks
+  void capture(Chunk *chunk, const chunkLookup_t &getChunk);
+  
+  block_t get(int bx, int by, int bz) const
+  { return mBlocks[index(bx, by, bz)]; }
+  block_t get(const Point3i &bp) const
+  { return mBlocks[index(bp[0], bp[1], bp[2])]; }
+  const block_t* data() const
+  { return mBlocks.data(); }
+  // hash of all captured blocks (identical snapshots produce identical meshes)
+  uint64_t contentHash() const;
+  // replaces the chunk's blocks with cells of scale^3 blocks (level of detail)
+  //  - cell c is stored at block c (0 to Chunk::size/scale), the rest of the chunk is emptied
+  //    (meshed on the cell grid -- quads are scaled back up when emitted)
+  //  - cells at least half solid are filled with their highest solid block, others are emptied
+  //  - the border is cleared, so faces on the chunk's sides are always meshed
+  //    (closes gaps against neighbors meshed at a different scale)
+  void downsample(int scale);
+
+  static int index(int bx, int by, int bz)
+  { return (bx+1) + size*((bz+1) + size*(by+1)); }
+  
+private:
+  std::array<block_t, totalSize> mBlocks;
+};
+
 class ChunkBounds
 {
 public:
+  // chunks are meshed in horizontal sections, so an edit only rebuilds the sections it touches
+  static const int sectionHeight = 8;
+  static const int numSections = 4; // (Chunk::sizeY / sectionHeight)
+  
   ChunkBounds();
-  ChunkBounds(Chunk *chunk);
+  ChunkBounds(const PaddedChunk &padded);
   ~ChunkBounds();
 
-  bool calcBounds(Chunk *chunk);
-  void simplifyGreedy();
-  std::unordered_map<hash_t, ActiveBlock>& getBounds();
+  typedef std::function<uint32_t(const Point3i &bp, blockSide_t side)> faceKey_t;
+  
+  // finds exposed faces with bitwise ops on occupancy rows (one per (y,z), bit x)
+  bool calcBounds(const PaddedChunk &padded);
+  // merges coplanar faces of the same type (and same faceKey) into rectangles
+  //  - only faces of blocks within the given section (rects never cross sections)
+  //  - scale > 1 if faces were found on a downsampled cell grid (see PaddedChunk::downsample)
+  std::vector<ActiveRect>& simplifyGreedy(const faceKey_t &faceKey, int section, int scale = 1);
+  // range of getFaces() within section
+  void sectionFaces(int section, int &startOut, int &endOut, int scale = 1);
+  // dimensions of side normal and rect pos/size
+  static void rectDims(blockSide_t side, int &normalDim, int &dim0, int &dim1);
+  // active blocks, sorted by index
+  std::vector<ActiveBlock>& getFaces();
+  // restores faces previously found by calcBounds (e.g. from a cached mesh)
+  void setFaces(const std::vector<ActiveBlock> &faces);
   int numFaces() const { return mNumFaces; }
   
-  block_t getBlock(Chunk *chunk, const Point3i &wp, blockSide_t side);
-  ActiveBlock* getBlock(hash_t hash);
+  static Point3i blockPos(const ActiveBlock &block);
+  // nullptr if block at bp has no active faces (or bp is outside the chunk)
+  ActiveBlock* getBlock(const Point3i &bp);
+  static const ActiveBlock* find(const std::vector<ActiveBlock> &faces, const Point3i &bp);
 
   void lock() { mLock.lock(); }
   void unlock() { mLock.unlock(); }
   
 private:
   std::mutex mLock;
-  std::unordered_map<hash_t, ActiveBlock> mBounds;
+  std::vector<ActiveBlock> mFaces;
   std::vector<ActiveRect> mSimplified;
   int mNumFaces = 0;
 };
 
 
+// where each section's geometry starts within a chunk mesh
+//  - section s has vertices [vertices[s], vertices[s+1]) and indices [indices[s], indices[s+1])
+//  - indices are relative to the whole mesh
+struct MeshSections
+{
+  uint32_t mask = 0; // sections included in the mesh (others are unchanged)
+  std::array<int, ChunkBounds::numSections+1> vertices = {0};
+  std::array<int, ChunkBounds::numSections+1> indices = {0};
+};
 
 #endif // MESHING_HPP
@@ -0,0 +1,69 @@
+#ifndef OCCLUSION_BUFFER_HPP
+#define OCCLUSION_BUFFER_HPP
+
+#include "vector.hpp"
+#include <vector>
+
+#define OCCLUSION_WIDTH  256 // depth buffer resolution (multiple of 4)
+#define OCCLUSION_HEIGHT 128
+
+class Camera;
+
+// Low resolution software depth buffer for occlusion culling on the CPU.
+//  - occluders are convex quads, rasterized at their farthest depth (so they never hide
+//    anything in front of them) -- one span per row, filled 4 pixels at a time with SSE2
+//    when supported
+//  - boxes are tested against a max-depth pyramid (hierarchical Z), at the level where
+//    their screen bounds cover at most 2x2 texels
+//  - depth is distance along the camera's view direction
+class OcclusionBuffer
+{
+public:
+  OcclusionBuffer(int width = OCCLUSION_WIDTH, int height = OCCLUSION_HEIGHT);
+
+  int width() const { return mWidth; }
+  int height() const { return mHeight; }
+  int numLevels() const { return mLevels.size(); }
+  const std::vector<float>& level(int l) const { return mLevels[l].depth; }
+
+  // clears depth (nothing occluded) and projects from cam
+  void begin(const Camera &cam);
+  // corners in order around the quad -- skipped if any corner is behind the near plane
+  void addOccluder(const Point3f corners[4]);
+  // builds the depth pyramid -- call after all occluders are added
+  void finish();
+
+  // false if the box is entirely behind occluders
+  bool boxVisible(const Point3f &minP, const Point3f &maxP) const;
+  int numOccluders() const { return mNumOccluders; }
+
+private:
+  struct Level
+  {
+    int width;
+    int height;
+    std::vector<float> depth; // (max depth of each texel's pixels)
+  };
+  std::vector<Level> mLevels; // (0 is full resolution)
+  int mWidth;
+  int mHeight;
+  bool mSSE = false;
+  int mNumOccluders = 0;
+
+  // projection
+  Point3f mPos;
+  Vector3f mEye;
+  Vector3f mRight;
+  Vector3f mUp;
+  float mScaleX; // (screen pixels per unit of (right / depth))
+  float mScaleY;
+  float mNearZ;
+
+  // screen position (pixels) and depth of a point
+  Point3f project(const Point3f &p) const;
+  // depth = min(depth, d) for pixels x0 to x1 of a row
+  void drawSpanScalar(float *row, int x0, int x1, float depth);
+  void drawSpanSSE(float *row, int x0, int x1, float depth);
+};
+
+#endif // OCCLUSION_BUFFER_HPP
@@ -0,0 +1,50 @@
+#ifndef SIMPLEX_BATCH_HPP
+#define SIMPLEX_BATCH_HPP
+
+#include <cstdint>
+
+// 3D simplex noise evaluated for many points at once.
+//  - gives the same results (bit-identical) as FastNoise::GetNoise with noise type Simplex,
+//    frequency 1.0 and the same seed
+//  - uses AVX2 or SSE2 when the CPU supports it (picked at runtime), otherwise scalar
+//  - eval() is const, so one instance can be shared between threads
+class SimplexBatch
+{
+public:
+  enum class simd_t
+    {
+     SCALAR = 0,
+     SSE2,
+     AVX2
+    };
+  // best instruction set supported by this CPU
+  static simd_t supported();
+  static const char* toString(simd_t simd);
+  // |noise| stays below this for any input (measured max ~0.979)
+  static constexpr float bound = 1.0f;
+  
+  SimplexBatch(int seed = 1337);
+
+  void setSeed(int seed);
+  int getSeed() const { return mSeed; }
+  // (clamped to what the CPU supports)
+  void setSimd(simd_t simd);
+  simd_t getSimd() const { return mSimd; }
+
+  // out[i] = noise(x[i], y[i], z[i])
+  void eval(const float *x, const float *y, const float *z, float *out, int n) const;
+  float eval(float x, float y, float z) const;
+  
+private:
+  int mSeed = 0;
+  simd_t mSimd = simd_t::SCALAR;
+  // (same permutation tables as FastNoise, widened for vector gathers)
+  int32_t mPerm[512];
+  int32_t mPerm12[512];
+
+  void evalScalar(const float *x, const float *y, const float *z, float *out, int n) const;
+  void evalSSE2(const float *x, const float *y, const float *z, float *out, int n) const;
+  void evalAVX2(const float *x, const float *y, const float *z, float *out, int n) const;
+};
+
+#endif // SIMPLEX_BATCH_HPP
@@ -0,0 +1,35 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#define EPOCH_MAX_THREADS 128 // (threads alive and using EpochGuard at once -- slots are freed on thread exit)
+
+// Epoch-based reclamation for objects shared between threads without a lock.
+//  - threads holding pointers to shared objects do so inside an EpochGuard
+//  - a removed object is retired at the current epoch, then reused once minActive() has passed it
+namespace Epoch
+{
+  // advances the global epoch, returning the epoch objects removed before this call are retired at
+  uint64_t retire();
+  // oldest epoch any thread is still reading in (or the current epoch if none are)
+  uint64_t minActive();
+  // true if objects retired at the given epoch can no longer be referenced by any reader
+  inline bool safe(uint64_t retired)
+  { return retired < minActive(); }
+
+  void enter();
+  void exit();
+};
+
+class EpochGuard
+{
+public:
+  EpochGuard()  { Epoch::enter(); }
+  ~EpochGuard() { Epoch::exit(); }
+  EpochGuard(const EpochGuard &other) = delete;
+  EpochGuard& operator=(const EpochGuard &other) = delete;
+};
+
+#endif // EPOCH_HPP
@@ -0,0 +1,90 @@
+#ifndef TASK_EXECUTOR_HPP
+#define TASK_EXECUTOR_HPP
+
+#include <thread>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+// Shared pool of worker threads that run submitted tasks.
+//  - each worker has its own task deque; idle workers steal from the others
+//  - workers block on a condition variable while there is no work
+class TaskExecutor
+{
+public:
+  typedef std::function<void()> task_t;
+
+  TaskExecutor(int numThreads = 1);
+  ~TaskExecutor();
+
+  void start();
+  void stop(); // (runs any tasks left in queue before returning)
+
+  void setThreads(int numThreads); // (takes effect on next start)
+  bool running() const   { return mRunning; }
+  int numThreads() const { return mNumThreads; }
+
+  void submit(const task_t &task);
+  // runs one queued task in the calling thread (returns false if none were queued)
+  bool runOne();
+
+  // stats
+  int queueDepth() const { return mNumTasks; }
+  // fraction of time each worker spent running tasks since last call
+  std::vector<float> utilization();
+
+private:
+  struct Worker
+  {
+    std::mutex lock;
+    std::deque<task_t> tasks;
+    std::thread thread;
+    std::atomic<long> busyNs = 0;
+  };
+  typedef std::chrono::high_resolution_clock clock_t;
+
+  int mNumThreads;
+  std::atomic<bool> mRunning = false;
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+  std::atomic<int> mNumTasks = 0;
+  std::atomic<unsigned int> mNextWorker = 0;
+  std::mutex mWaitLock;
+  std::condition_variable mWaitCv;
+  clock_t::time_point mLastSample;
+
+  bool popTask(int id, task_t &task);
+  void workerLoop(int id);
+};
+
+// Tracks a set of tasks submitted to an executor so the caller can wait for them.
+//  - state is shared with the submitted tasks, so a worker can still be notifying after wait() returns
+class TaskGroup
+{
+public:
+  TaskGroup(TaskExecutor *executor) : mExecutor(executor), mState(new State()) { }
+  ~TaskGroup() { wait(); }
+
+  void submit(const TaskExecutor::task_t &task);
+  void wait(); // (runs this group's tasks that haven't started yet while waiting)
+
+private:
+  struct State
+  {
+    std::mutex lock;
+    std::condition_variable doneCv;
+    std::deque<TaskExecutor::task_t> tasks; // (not yet started)
+    int remaining = 0;
+  };
+
+  TaskExecutor *mExecutor;
+  std::shared_ptr<State> mState;
+
+  static bool runNext(const std::shared_ptr<State> &state);
+};
+
+#endif // TASK_EXECUTOR_HPP
@@ -2,16 +2,77 @@
 #define THREAD_MAP_HPP
 
 #include <unordered_map>
+#include <shared_mutex>
 #include <mutex>
+#include <atomic>
+#include <iterator>
 
 #include "hashing.hpp"
 
+#define THREAD_MAP_SHARDS 32 // (power of two)
+
+// Hash map split into shards, each with its own reader/writer lock.
+//  - shard is chosen by the low bits of the Morton hash, so neighboring chunks land in different shards
+//  - lookups only take a shared lock on one shard; lock() locks every shard (for iteration/locked* functions)
 template<typename T>
 class ThreadMap
 {
   static_assert(std::is_pointer<T>::value, "ThreadMap typename must be a pointer type.");
+  typedef std::unordered_map<hash_t, T> map_t;
+  struct alignas(64) Shard
+  {
+    std::shared_mutex lock;
+    map_t map;
+  };
 public:
-  typedef typename std::unordered_map<hash_t, T>::iterator iterator_t;
+  // iterates over every shard in order
+  class iterator_t
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename map_t::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef value_type* pointer;
+    typedef value_type& reference;
+
+    iterator_t(Shard *shards, int shard)
+      : mShards(shards), mShard(shard)
+    {
+      if(mShard < THREAD_MAP_SHARDS)
+        {
+          mIter = mShards[mShard].map.begin();
+          skipEmpty();
+        }
+    }
+    reference operator*() const  { return *mIter; }
+    pointer operator->() const   { return &(*mIter); }
+    iterator_t& operator++()
+    {
+      ++mIter;
+      skipEmpty();
+      return *this;
+    }
+    bool operator==(const iterator_t &other) const
+    { return (mShard == other.mShard && (mShard >= THREAD_MAP_SHARDS || mIter == other.mIter)); }
+    bool operator!=(const iterator_t &other) const
+    { return !(*this == other); }
+
+  private:
+    Shard *mShards;
+    int mShard;
+    typename map_t::iterator mIter;
+
+    void skipEmpty()
+    {
+      while(mIter == mShards[mShard].map.end())
+        {
+          if(++mShard >= THREAD_MAP_SHARDS)
+            { return; }
+          mIter = mShards[mShard].map.begin();
+        }
+    }
+  };
+
   ThreadMap()
   { }
   ~ThreadMap()
@@ -19,149 +80,143 @@ public:
   ThreadMap(ThreadMap &other)
   {
     other.lock();
-    mMap = other.mMap;
-    mSize = other.size;
+    for(int i = 0; i < THREAD_MAP_SHARDS; i++)
+      { mShards[i].map = other.mShards[i].map; }
+    mSize = other.size();
     other.unlock();
   }
   ThreadMap& operator=(ThreadMap &other)
   {
     lock();
     other.lock();
-    mMap = other.mMap;
-    mSize = other.size;
+    for(int i = 0; i < THREAD_MAP_SHARDS; i++)
+      { mShards[i].map = other.mShards[i].map; }
+    mSize = other.size();
     other.unlock();
     unlock();
     return *this;
   }
 
-  
+
   void lock()
   {
-    mLock.lock();
+    for(auto &s : mShards)
+      { s.lock.lock(); }
     mLocked = true;
   }
   void unlock()
   {
     mLocked = false;
-    mLock.unlock();
+    for(auto &s : mShards)
+      { s.lock.unlock(); }
   }
   bool isLocked() const
   { return mLocked; }
 
   int size() const
   { return mSize; }
-  
+
   // NOTE: Lock before using these!!
   iterator_t begin()
-  { return mMap.begin(); }
+  { return iterator_t(mShards, 0); }
   iterator_t end()
-  { return mMap.end(); }
-  const iterator_t begin() const
-  { return mMap.begin(); }
-  const iterator_t end() const
-  { return mMap.end(); }
+  { return iterator_t(mShards, THREAD_MAP_SHARDS); }
 
   bool contains(hash_t hash)
   {
-    std::lock_guard<std::mutex> lock(mLock);
-    return (mMap.find(hash) != mMap.end());
+    Shard &s = shard(hash);
+    std::shared_lock<std::shared_mutex> lock(s.lock);
+    return (s.map.find(hash) != s.map.end());
   }
   T at(hash_t hash)
   {
-    std::lock_guard<std::mutex> lock(mLock);
-    auto iter = mMap.find(hash);
-    if(iter != mMap.end())
+    Shard &s = shard(hash);
+    std::shared_lock<std::shared_mutex> lock(s.lock);
+    auto iter = s.map.find(hash);
+    if(iter != s.map.end())
       { return iter->second; }
     else
       { return nullptr; }
   }
   T operator[](hash_t hash)
-  {
-    std::lock_guard<std::mutex> lock(mLock);
-    auto iter = mMap.find(hash);
-    if(iter != mMap.end())
-      { return iter->second; }
-    else
-      { return nullptr; }
-  }
+  { return at(hash); }
 
   void emplace(hash_t hash, T obj)
   {
-    std::lock_guard<std::mutex> lock(mLock);
-    auto iter = mMap.find(hash);
-    if(iter != mMap.end() && iter->second)
+    Shard &s = shard(hash);
+    std::lock_guard<std::shared_mutex> lock(s.lock);
+    auto iter = s.map.find(hash);
+    if(iter != s.map.end() && iter->second)
       {
         iter->second = obj;
       }
     else
       {
-        mMap.emplace(hash, obj);
+        s.map.emplace(hash, obj);
         mSize++;
       }
   }
   void erase(hash_t hash)
   {
-    std::lock_guard<std::mutex> lock(mLock);
-    auto iter = mMap.find(hash);
-    if(iter != mMap.end())
-      {
-        mMap.erase(hash);
-        mSize--;
-      }
+    Shard &s = shard(hash);
+    std::lock_guard<std::shared_mutex> lock(s.lock);
+    if(s.map.erase(hash) > 0)
+      { mSize--; }
   }
   void clear()
   {
-    std::lock_guard<std::mutex> lock(mLock);
-    mMap.clear();
-    mSize = 0;
+    lock();
+    lockedClear();
+    unlock();
   }
 
 
 
-  
+
   bool lockedContains(hash_t hash)
   {
-    return (mMap.find(hash) != mMap.end());
+    const map_t &m = shard(hash).map;
+    return (m.find(hash) != m.end());
   }
   void lockedEmplace(hash_t hash, T obj)
   {
-    auto iter = mMap.find(hash);
-    if(iter == mMap.end())
+    map_t &m = shard(hash).map;
+    auto iter = m.find(hash);
+    if(iter == m.end())
       { mSize++; }
-    mMap[hash] = obj;
+    m[hash] = obj;
   }
   T lockedAt(hash_t hash)
   {
-    auto iter = mMap.find(hash);
-    if(iter != mMap.end())
+    map_t &m = shard(hash).map;
+    auto iter = m.find(hash);
+    if(iter != m.end())
       { return iter->second; }
     else
       { return nullptr; }
   }
   void lockedErase(hash_t hash)
   {
-    auto iter = mMap.find(hash);
-    if(iter != mMap.end())
-      {
-        mMap.erase(hash);
-        mSize--;
-      }
+    if(shard(hash).map.erase(hash) > 0)
+      { mSize--; }
   }
   void lockedClear()
   {
-    mMap.clear();
+    for(auto &s : mShards)
+      { s.map.clear(); }
     mSize = 0;
   }
-  
-  
-  
-  
+
+
+
+
 private:
-  std::mutex mLock;
-  bool mLocked = false;
-  int mSize = 0;
-  std::unordered_map<hash_t, T> mMap;
+  Shard mShards[THREAD_MAP_SHARDS];
+  std::atomic<bool> mLocked = false;
+  std::atomic<int> mSize = 0;
 
+  Shard& shard(hash_t hash)
+  { return mShards[(uint32_t)hash & (THREAD_MAP_SHARDS-1)]; }
 };
 
 #endif // THREAD_MAP_HPP
@@ -1,149 +1,117 @@
 #ifndef THREAD_QUEUE_HPP
 #define THREAD_QUEUE_HPP
 
-#include <queue>
-#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
 
+// Bounded lock-free multi-producer/multi-consumer queue.
+//  - ring of cells, each with a sequence number marking whether it is ready to be written or read
+//  - capacity is rounded up to a power of two
 template<typename T>
 class ThreadQueue
 {
-  static_assert(std::is_pointer<T>::value, "ThreadQueue typename must be a pointer type.");
 public:
-  ThreadQueue() { }
-
-  void push(T obj)
-  {
-    if(mLocked)
-      {
-        mQueue.push(obj);
-      }
-    else
-      {
-        std::lock_guard<std::mutex> lock(mLock);
-        mQueue.push(obj);
-      }
-  }
-  
-  T pop()
-  {
-    T obj = nullptr;
-    bool locked = mLocked;
-    
-    if(!locked) { lock(); }
-    if(mQueue.size() > 0)
-      {
-        obj = mQueue.front();
-        mQueue.pop();
-      }
-    if(!locked) { unlock(); }
-    
-    return obj;
-  }
-  int size()
+  ThreadQueue(int capacity = 1024)
+    : mCapacity(roundCapacity(capacity)), mMask(mCapacity - 1), mCells(mCapacity)
   {
-    if(mLocked)
-      {
-        return mQueue.size();
-      }
-    else
-      {
-        std::lock_guard<std::mutex> lock(mLock);
-        return mQueue.size();
-      }
+    for(int i = 0; i < mCapacity; i++)
+      { mCells[i].seq.store(i, std::memory_order_relaxed); }
   }
 
-  void lock()
-  {
-    if(!mLocked)
-      { mLock.lock(); }
-    mLocked = true;
-  }
-  void unlock()
+  // returns false if the queue is full
+  bool tryPush(const T &obj)
   {
-    if(mLocked)
-      { mLock.unlock(); }
-    mLocked = false;
-  }
-  
-private:
-  std::queue<T> mQueue;
-  std::mutex mLock;
-  bool mLocked = false;
-};
-
-template<typename T>
-class RawThreadQueue
-{
-public:
-  RawThreadQueue() { }
-
-  void push(T obj)
-  {
-    if(mLocked)
-      {
-        mQueue.push(obj);
-      }
-    else
+    size_t pos = mTail.load(std::memory_order_relaxed);
+    Cell *cell;
+    while(true)
       {
-        std::lock_guard<std::mutex> lock(mLock);
-        mQueue.push(obj);
+        cell = &mCells[pos & mMask];
+        const size_t seq = cell->seq.load(std::memory_order_acquire);
+        const long diff = (long)seq - (long)pos;
+        if(diff == 0)
+          { // cell free -- claim it
+            if(mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+              { break; }
+          }
+        else if(diff < 0)
+          { return false; } // full
+        else
+          { pos = mTail.load(std::memory_order_relaxed); }
       }
+    cell->data = obj;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
   }
-  
-  T pop()
+
+  // returns false if the queue is empty
+  bool tryPop(T &objOut)
   {
-    if(mQueue.size() > 0)
+    size_t pos = mHead.load(std::memory_order_relaxed);
+    Cell *cell;
+    while(true)
       {
-        if(mLocked)
-          {
-            T obj = mQueue.front();
-            mQueue.pop();
-            return obj;
+        cell = &mCells[pos & mMask];
+        const size_t seq = cell->seq.load(std::memory_order_acquire);
+        const long diff = (long)seq - (long)(pos + 1);
+        if(diff == 0)
+          { // cell written -- claim it
+            if(mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+              { break; }
           }
+        else if(diff < 0)
+          { return false; } // empty
         else
-          {
-            std::lock_guard<std::mutex> lock(mLock);
-            T obj = mQueue.front();
-            mQueue.pop();
-            return obj;
-          }
-      }
-    else
-      {
-        LOGE("RawThreadQueue popped with no entries!!");
-        exit(1);
+          { pos = mHead.load(std::memory_order_relaxed); }
       }
+    objOut = cell->data;
+    cell->seq.store(pos + mMask + 1, std::memory_order_release);
+    return true;
   }
-  int size()
+
+  // pops up to maxCount entries onto the end of objsOut (returns number popped)
+  int popBatch(std::vector<T> &objsOut, int maxCount)
   {
-    if(mLocked)
+    int num = 0;
+    T obj;
+    while(num < maxCount && tryPop(obj))
       {
-        return mQueue.size();
-      }
-    else
-      {
-        std::lock_guard<std::mutex> lock(mLock);
-        return mQueue.size();
+        objsOut.push_back(obj);
+        num++;
       }
+    return num;
   }
 
-  void lock()
+  // (approximate while other threads are pushing/popping)
+  int size() const
   {
-    if(!mLocked)
-      { mLock.lock(); }
-    mLocked = true;
+    const size_t tail = mTail.load(std::memory_order_relaxed);
+    const size_t head = mHead.load(std::memory_order_relaxed);
+    return (tail > head ? (int)(tail - head) : 0);
   }
-  void unlock()
+  bool empty() const   { return size() == 0; }
+  int capacity() const { return mCapacity; }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  static int roundCapacity(int capacity)
   {
-    if(mLocked)
-      { mLock.unlock(); }
-    mLocked = false;
+    int c = 2;
+    while(c < capacity)
+      { c <<= 1; }
+    return c;
   }
-  
-private:
-  std::queue<T> mQueue;
-  std::mutex mLock;
-  bool mLocked = false;
+
+  const int mCapacity;
+  const size_t mMask;
+  std::vector<Cell> mCells;
+  alignas(64) std::atomic<size_t> mHead = 0;
+  alignas(64) std::atomic<size_t> mTail = 0;
 };
 
 
@@ -13,7 +13,7 @@
 
 static World::Options getDefaultOptions()
 {
-  World::Options opt{"", terrain_t::PERLIN_WORLD, 0, {0,0,0}, {8,8,4}, 8, 8};
+  World::Options opt{"", terrain_t::PERLIN_WORLD, 0, {0,0,0}, {8,8,4}, 8, 8, true};
   
   std::ifstream config(CONFIG_PATH);
   std::string line;
@@ -78,6 +78,12 @@ static World::Options getDefaultOptions()
               ss >> threads;
               opt.meshThreads = threads;
             }
+          else if(option == "GREEDY_MESH")
+            {
+              int greedy;
+              ss >> greedy;
+              opt.greedyMesh = (greedy != 0);
+            }
           else
             {
               LOGW("Unknown option in '%s':  %s", CONFIG_PATH, option.c_str());
@@ -99,7 +105,8 @@ static void writeDefaultOptions(const World::Options &opt)
              << "CHUNK_RAD_Y" << "\t" << opt.chunkRadius[1] << "\n"
              << "CHUNK_RAD_Z" << "\t" << opt.chunkRadius[2] << "\n"
              << "LOAD_THREADS" << "\t" << opt.loadThreads << "\n"
-             << "MESH_THREADS" << "\t" << opt.meshThreads << "\n\n";
+             << "MESH_THREADS" << "\t" << opt.meshThreads << "\n"
+             << "GREEDY_MESH" << "\t" << (opt.greedyMesh ? 1 : 0) << "\n\n";
     }
   else
     {
@@ -7,6 +7,7 @@
 #include "hashing.hpp"
 #include "meshing.hpp"
 #include <array>
+#include <algorithm>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
@@ -36,6 +37,20 @@ public:
   static const int maskX = (sizeX - 1);
   static const int maskY = (sizeY - 1);
   static const int maskZ = (sizeZ - 1);
+
+  // sections (meshed separately -- see ChunkBounds)
+  static const int sectionHeight = ChunkBounds::sectionHeight;
+  static const int numSections = ChunkBounds::numSections;
+  static const uint32_t allSections = (1 << numSections) - 1;
+  // sections containing any block with by in [minY, maxY] (clamped to chunk)
+  static inline uint32_t sectionMask(int minY, int maxY)
+  {
+    if(maxY < 0 || minY >= sizeY)
+      { return 0; }
+    const int minS = std::max(minY, 0) / sectionHeight;
+    const int maxS = std::min(maxY, sizeY-1) / sectionHeight;
+    return ((1 << (maxS+1)) - 1) & ~((1 << minS) - 1);
+  }
   
   static inline Point3i blockPos(const Point3i &wp)
   { return Point3i({blockX(wp[0]), blockY(wp[1]), blockZ(wp[2])}); }
@@ -48,9 +63,9 @@ public:
 
   Chunk(const Point3i &worldPos);
   //Chunk(const Point3i &worldPos, const std::array<Block, totalSize> &data);
+  ~Chunk();
 
-  bool calcBounds()
-  { return mBounds.calcBounds(this); }
+  bool calcBounds(const PaddedChunk &padded);
   ChunkBounds* getBounds()
   { return &mBounds; }
   
@@ -60,16 +75,20 @@ public:
   hash_t neighborHash(blockSide_t side);
   bool isEmpty() const;
 
+  // uniform chunks (every block the same type) have no block storage until a block is changed
+  bool isUniform() const { return !mBlocks.load(std::memory_order_acquire); }
+  block_t uniformType() const { return mUniform; } // (only valid if isUniform())
+  void setUniform(block_t type);
+
   // data access
   block_t operator[](const Point3i &bp) const
-  { return mBlocks[mIndexer.index(bp)]; }
-  block_t* at(int bx, int by, int bz);
+  { return getType(bp); }
+  block_t* at(int bx, int by, int bz); // (allocates storage for uniform chunks)
   block_t* at(const Point3i &bp);
   block_t* at(int bi);
   block_t getType(int bx, int by, int bz) const;
   block_t getType(const Point3i &bp) const;
-  std::array<block_t, totalSize>& data();
-  const std::array<block_t, totalSize>& data() const;
+  const block_t* blocks() const; // (nullptr if uniform)
 
   std::unordered_map<int, ComplexBlock*>& getComplex()
   { return mComplex; }
@@ -93,11 +112,36 @@ public:
   void updateConnected();
   bool edgesConnected(blockSide_t prevSide, blockSide_t nextSide);
   bool sideOpen(blockSide_t side);
+  // fully solid layers of (simple) blocks, for occlusion culling -- updated with connected edges
+  //  - along each axis, the chunk is split into occluderTiles^2 columns of tiles
+  //    (tile t1 + occluderTiles*t2 over axes (a+1)%3 and (a+2)%3)
+  //  - lowest/highest layer solid across each tile (noLayer if none)
+  static const int occluderTiles = 2;
+  static const uint8_t noLayer = 0xFF;
+  struct SolidLayers
+  {
+    uint8_t lowest[3][occluderTiles*occluderTiles];
+    uint8_t highest[3][occluderTiles*occluderTiles];
+  };
+  const SolidLayers& solidLayers() const { return mSolidLayers; }
   void printEdgeConnections();
   
   // updating
   bool isDirty() { return mDirty; }
-  void setDirty(bool dirty) { mDirty = dirty; }
+  void setDirty(bool dirty)
+  {
+    if(dirty)
+      { mDirtySections |= allSections; }
+    mDirty = dirty;
+  }
+  // (only the given sections need to be remeshed)
+  void setDirtySections(uint32_t sections)
+  {
+    mDirtySections |= sections;
+    mDirty = true;
+  }
+  // returns sections to remesh, and clears them (called by mesher)
+  uint32_t takeDirtySections() { return mDirtySections.exchange(0); }
   bool isPriority() { return mPriority; }
   void setPriority(bool priority) { mPriority = priority; }
   
@@ -109,24 +153,41 @@ public:
   void setUnloaded(bool unloaded) { mUnloaded = unloaded; }
 
   // serialization
+  enum class format_t : uint8_t
+    {
+      RAW = 1,
+      RLE,
+      PALETTE,
+      UNIFORM
+    };
   int serialize(std::vector<uint8_t> &dataOut) const;
-  void deserialize(const std::vector<uint8_t> &dataIn);
+  bool deserialize(const std::vector<uint8_t> &dataIn);
+  static int serializeBlocks(const std::array<block_t, totalSize> &blocks, std::vector<uint8_t> &dataOut);
+  static int serializeUniform(block_t type, std::vector<uint8_t> &dataOut);
+  // (uniform chunks serialize to 2 bytes -- no block data)
+  static bool isUniformData(const std::vector<uint8_t> &data)
+  { return (data.size() == 2 && data[0] == (uint8_t)format_t::UNIFORM); }
 
   static const Indexer<sizeX, sizeY, sizeZ>& indexer() { return mIndexer; }
   
 private:
   static const Indexer<sizeX, sizeY, sizeZ> mIndexer;
+  static const int RLE_MAX_RUN = (1 << 16);
+  typedef std::array<block_t, totalSize> BlockArray;
   
   Point3i mWorldPos;
   hash_t mHash;
   ChunkBounds mBounds;
-  std::array<block_t, totalSize> mBlocks;
+  // (only freed while no other thread can see the chunk -- see deserialize)
+  std::atomic<BlockArray*> mBlocks = nullptr;
+  block_t mUniform = block_t::NONE;
   std::unordered_map<int, ComplexBlock*> mComplex;
   std::unordered_map<blockSide_t, Chunk*> mNeighbors;
   std::unordered_map<blockSide_t, hash_t> mNeighborHashes;
   
   std::atomic<int> mNumBlocks = 0;
   std::atomic<bool> mDirty = true;
+  std::atomic<uint32_t> mDirtySections = allSections;
   std::atomic<bool> mPriority = false;
   std::atomic<bool> mNeedSave = false;
   std::atomic<bool> mReady = false;
@@ -134,8 +195,17 @@ private:
 
   //std::unordered_map<blockSide_t, blockSide_t> mConnectedEdges;
   uint16_t mConnectedEdges = 0;
+  SolidLayers mSolidLayers;
   
   void reset();
+  BlockArray* storage(); // (uninitialized if newly allocated)
+  BlockArray* expand();  // (filled with the uniform type if newly allocated)
+  void freeStorage();
+  inline block_t get(int bi) const
+  {
+    const BlockArray *blocks = mBlocks.load(std::memory_order_acquire);
+    return (blocks ? (*blocks)[bi] : mUniform);
+  }
   
   static inline int blockX(int wx)
   { return wx & maskX; }
@@ -0,0 +1,50 @@
+#ifndef CHUNK_GRID_HPP
+#define CHUNK_GRID_HPP
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include "vector.hpp"
+
+class Chunk;
+typedef Chunk* ChunkPtr;
+
+// Dense 3D array of chunk pointers covering the loaded window.
+//  - indexed by chunk position modulo the window size (toroidal), so moving the window
+//    only reassigns the slots of chunks that enter/leave it
+//  - lookups are lock-free; writers must be serialized by the owner (ChunkMap's mChunkLock)
+class ChunkGrid
+{
+public:
+  ChunkGrid();
+  ~ChunkGrid();
+
+  // returns true if the grid was reallocated (window size changed) -- chunks need to be re-added
+  bool setWindow(const Point3i &minChunk, const Point3i &maxChunk);
+  bool inWindow(const Point3i &cp) const;
+  void getWindow(Point3i &minOut, Point3i &maxOut) const;
+
+  // nullptr if no chunk is loaded at cp (or cp is outside the window)
+  ChunkPtr at(const Point3i &cp) const;
+  void set(const Point3i &cp, ChunkPtr chunk);
+  void unset(const Point3i &cp, ChunkPtr chunk); // (only if slot still holds chunk)
+  void clear();
+
+private:
+  struct Grid
+  {
+    Point3i dim;
+    std::vector<std::atomic<ChunkPtr>> chunks;
+    Grid(const Point3i &d) : dim(d), chunks(d[0]*d[1]*d[2]) { }
+  };
+
+  std::atomic<Grid*> mGrid = nullptr;
+  std::atomic<int> mMin[3] = {0, 0, 0};
+  std::atomic<int> mMax[3] = {-1, -1, -1};
+  std::vector<std::pair<uint64_t, Grid*>> mRetiredGrids; // (freed once no readers can see them)
+
+  static int index(const Grid *grid, const Point3i &cp);
+};
+
+#endif // CHUNK_GRID_HPP
@@ -5,6 +5,7 @@
 #include "world.hpp"
 #include "chunk.hpp"
 #include "threadPool.hpp"
+#include "taskExecutor.hpp"
 #include "threadQueue.hpp"
 #include "terrain.hpp"
 #include "worldFile.hpp"
@@ -15,7 +16,9 @@
 #include <unordered_set>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
+#include <functional>
 
 class RegionFile;
 
@@ -26,15 +29,17 @@ public:
   static const std::unordered_set<uint32_t> acceptedVersions;
   typedef std::function<void(Chunk* chunk)> loadCallback_t;
   
-  ChunkLoader(int loadThreads, const loadCallback_t &loadCallback);
+  ChunkLoader(const loadCallback_t &loadCallback);
   ~ChunkLoader();
 
+  void setExecutor(TaskExecutor *executor) { mExecutor = executor; }
   void start();
   void stop();
-  void flush();
-  bool isRunning() const { return mLoadPool.running(); }
-  void setThreads(int numThreads) { mLoadPool.setThreads(numThreads); }
-  int numThreads() const { return mLoadPool.numThreads(); }
+  // finishes queued loads and writes pending saves
+  //  (false if some snapshots couldn't be written -- they stay pending to be retried)
+  bool flush();
+  void compactRegions();
+  bool isRunning() const { return mRunning; }
 
   bool createWorld(const std::string &worldName, terrain_t terrain,
                    uint32_t seed );
@@ -48,11 +53,27 @@ public:
   std::vector<std::string> listWorlds();
   std::vector<std::string> listRegions(const std::string &worldDir);
   
-  void load(Chunk *chunk);
+  // queues chunk to be loaded (lower priority loads first)
+  void load(Chunk *chunk, int priority = 0);
   void loadDirect(Chunk *chunk); // loads chunk in calling thread
-  void save(Chunk *chunk);
+  // recalculates priority of all queued chunks
+  void reprioritize(const std::function<int(const Point3i&)> &priority);
+  // removes queued chunks outside of range (returns cancelled chunks)
+  std::vector<Chunk*> cancelOutside(const Point3i &minChunk, const Point3i &maxChunk);
+  int numQueued();
+  // snapshots chunk data to be written in the background
+  //  (returns false if the save queue is full -- try again later)
+  bool save(Chunk *chunk);
+  int numPendingSaves();
+  // prefetches region data for chunks within [minChunk, maxChunk], skipping [skipMin, skipMax]
+  int prefetch(const Point3i &minChunk, const Point3i &maxChunk,
+               const Point3i &skipMin, const Point3i &skipMax );
+  int prefetchHits();
+  int prefetchMisses();
 
   uint32_t getSeed() const { return mHeader.seed; }
+  // directory of the loaded world (with its region files)
+  std::string getWorldDir() const;
   
 private:
   // world file
@@ -64,9 +85,41 @@ private:
   std::unordered_map<uint32_t, RegionFile*> mRegionLookup;
   // threading
   loadCallback_t mLoadCallback;
-  ThreadPool mLoadPool;
+  TaskExecutor *mExecutor = nullptr;
+  std::atomic<bool> mRunning = false;
+  int mActiveLoads = 0; // load tasks submitted to executor
   std::mutex mLoadLock;
-  std::queue<Chunk*> mLoadQueue;
+  std::condition_variable mLoadDoneCv;
+  struct LoadRequest
+  {
+    int priority;
+    Chunk *chunk;
+    bool operator<(const LoadRequest &other) const
+    { return priority > other.priority; } // (min heap)
+  };
+  std::vector<LoadRequest> mLoadQueue; // heap ordered by priority
+  // write-behind saving
+  struct SaveEntry
+  {
+    Point3i pos;
+    bool uniform = false;
+    block_t type = block_t::NONE; // (if uniform)
+    std::array<block_t, Chunk::totalSize> blocks;
+  };
+  typedef std::unordered_map<hash_t, std::unordered_map<hash_t, SaveEntry*>> saveBatch_t;
+  ThreadPool mSavePool;
+  std::mutex mSaveLock;
+  std::condition_variable mSaveCv;
+  std::condition_variable mSaveDoneCv;
+  saveBatch_t mPendingSaves;             // region hash --> chunk hash --> snapshot
+  saveBatch_t mWritingSaves;             // (batch being written by the save thread)
+  std::vector<SaveEntry*> mUnusedSaves;
+  int mNumPendingSaves = 0;
+  int mNumWriting = 0;
+  int mSaveBatch = 0;   // (batches taken by the save thread)
+  int mSavedBatch = 0;  // (last batch written)
+  int mFailedSaves = 0; // (snapshots the last batch couldn't write -- pending again)
+  bool mSaving = false; // save thread running (guarded by mSaveLock)
   // other
   TerrainGenerator mTerrainGen;
   
@@ -74,7 +127,14 @@ private:
   bool checkWorldDir();
 
   void loadChunk(Chunk *chunk);
-  void loadWorker(int tid);
+  void submitLoad();
+  void loadNext();
+  // loads chunk from a snapshot waiting to be written (false if none)
+  bool loadSaved(Chunk *chunk);
+  void saveWorker(int tid);
+  // (returns number of snapshots that couldn't be written -- moved back to mPendingSaves)
+  int writeSaves(saveBatch_t &saves);
+  RegionFile* getRegion(const Point3i &regionPos, bool create);
 };
 
 
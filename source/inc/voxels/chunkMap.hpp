@@ -13,9 +13,16 @@
 #include "hashing.hpp"
 #include "vector.hpp"
 #include "traversalTree.hpp"
+#include "threadQueue.hpp"
+#include "threadMap.hpp"
+#include "chunkGrid.hpp"
+#include "frustum.hpp"
+
+#define LOADED_QUEUE_SIZE 1024 // max loaded chunks waiting to be added to the map
 
 class ChunkLoader;
 class Camera;
+class OcclusionBuffer;
 
 class ChunkMap
 {
@@ -45,8 +52,12 @@ public:
   //void updateOrder();
   std::vector<hash_t> updateTree();
   //std::vector<OrderLine>& getOrder();
-  TreeNode getTree();
+  // chunks visible from cam (cave culling through connected chunk edges, then frustum)
+  //  - visibleOut and the traversal buffers are reused (no allocation once their sizes settle)
+  void getVisible(Camera *cam, std::vector<hash_t> &visibleOut);
   std::vector<hash_t> getVisible(Camera *cam);
+  // removes chunks hidden behind solid layers of blocks in nearby chunks (from getVisible() -- see chunkOcclusion.hpp)
+  void cullOccluded(Camera *cam, OcclusionBuffer &buffer, std::vector<hash_t> &visible);
 
   bool isLoading(const Point3i &cp); // chunk is loading                  
   bool isLoaded(const Point3i &cp);  // chunk and all neighbors are loaded
@@ -58,12 +69,15 @@ public:
   int numLoaded() const;
 
   void updateAdjacent(const Point3i &cp, blockSide_t edges);
+  // marks the mesh sections that include block wp (or its neighbors' faces/lighting) dirty
+  void updateBlock(const Point3i &wp);
   
   std::vector<hash_t> unloadOutside(const Point3i minChunk, const Point3i maxChunk);
   //void setChunkRange(const Point3i minChunk, const Point3i maxChunk);
-  int chunkPriority(const Point3i &cp);//hash_t hash);
+  int chunkPriority(const Point3i &cp);
+  void reprioritize();
   
-  std::unordered_map<hash_t, ChunkPtr>& getChunks();
+  ThreadMap<ChunkPtr>& getChunks();
   void lock();
   void unlock();
   
@@ -71,37 +85,61 @@ public:
   ChunkPtr operator[](hash_t hash);
   
 private:
-  std::unordered_map<hash_t, ChunkPtr> mChunks;
+  // (readers only lock one shard -- all changes are made with mChunkLock held)
+  ThreadMap<ChunkPtr> mChunks;
+  ChunkGrid mGrid; // (lock-free lookups within loaded window)
   std::unordered_map<hash_t, sideFlag_t> mChunkNeighbors;
-  std::unordered_set<hash_t> mLoadList; // list of chunks that need to be loaded
-  std::list<Point3i> mLoadOrder; // list of chunks that need to be loaded
   std::unordered_set<hash_t> mLoadingChunks;
   std::unordered_set<hash_t> mUnloadedChunks;
   std::queue<ChunkPtr> mUnusedChunks;
+  std::deque<std::pair<uint64_t, ChunkPtr>> mRetiredChunks; // unloaded chunks (with epoch)
   std::unordered_map<hash_t, std::unordered_map<blockSide_t, hash_t>> mNeighbors;
   
   std::unordered_set<hash_t> mNextEdge;
   std::unordered_map<hash_t, int> mTreeOrder;
   
   TreeNode mChunkTree;
-  TreeNode mVisibleTree;
+
+  // visibility traversal state (reused every frame)
+  struct VisibleStep
+  {
+    Point3i pos;
+    blockSide_t enterSide; // (side the traversal entered this chunk through)
+    blockSide_t stepped;   // directions stepped so far -- never step back against them
+  };
+  std::vector<uint32_t> mVisitStamps; // frame stamp for each chunk in the loaded window
+  uint32_t mVisitStamp = 0;
+  std::vector<VisibleStep> mVisibleSteps; // (flat BFS queue)
+  Frustum::BoxList mFrustumBoxes;         // bounds of each chunk in the window
+  Point3i mFrustumWindow;                 // (window min when mFrustumBoxes was built)
+  std::vector<uint64_t> mFrustumMask;     // (bit set if chunk is in the view frustum)
   
   ChunkLoader *mLoader = nullptr;
   Camera *mCamera = nullptr;
   Point3i mCamPos;
+  Vector3f mCamForward;    // camera direction at last reprioritization
+  Point3i mPriorityPos;    // camera chunk at last reprioritization
   Vector3i mRadius;
 
+  // chunks finished loading, waiting to be added to the map in update()
+  ThreadQueue<ChunkPtr> mLoadedQueue{LOADED_QUEUE_SIZE};
+  std::vector<ChunkPtr> mLoadedBatch;
+
   std::atomic<int> mNumLoaded = 0;
   std::atomic<int> mNumLoading = 0;
 
   std::mutex mChunkLock;
-  std::mutex mLoadLock;
   std::mutex mTreeLock;
   std::mutex mNeighborLock;
+  std::mutex mVisibleLock;
 
-  void loadChunk(hash_t hash);
+  void updateCamPos();
+  ChunkPtr findChunk(const Point3i &cp);
+  void loadChunk(hash_t hash, int priority);
   void unloadChunk(hash_t hash);
   void chunkFinishedLoading(Chunk *chunk);
+  void addLoadedChunk(Chunk *chunk);
+  void retireChunk(ChunkPtr chunk);
 };
 
 #endif // CHUNK_MAP_HPP
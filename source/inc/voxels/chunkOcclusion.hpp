@@ -0,0 +1,24 @@
+#ifndef CHUNK_OCCLUSION_HPP
+#define CHUNK_OCCLUSION_HPP
+
+#include <functional>
+#include <vector>
+
+#include "vector.hpp"
+#include "hashing.hpp"
+
+#define OCCLUDER_RADIUS 4 // (chunks) solid layers further from the camera aren't used as occluders
+
+class Chunk;
+class Camera;
+class OcclusionBuffer;
+
+// Occlusion culling of visible chunks (shared by ChunkMap and the headless benchmark).
+//  - occluders are the outer faces of the solid layers (Chunk::solidLayers) in non-empty
+//    chunks within OCCLUDER_RADIUS of the camera that face it
+//  - chunks entirely behind them are removed from visible (the camera's chunk is always kept)
+typedef std::function<Chunk*(const Point3i &cp)> chunkLookup_t;
+void cullOccludedChunks(const Camera &cam, OcclusionBuffer &buffer, const chunkLookup_t &getChunk,
+                        std::vector<hash_t> &visible );
+
+#endif // CHUNK_OCCLUSION_HPP
@@ -4,14 +4,14 @@
 #include <unordered_map>
 #include <mutex>
 #include "threadMap.hpp"
+#include "meshData.hpp"
 
-class MeshData;
 class ChunkMesh;
 class ChunkBounds;
 class Chunk;
 class Fluid;
 class FluidChunk;
-class Chunk;
+class TaskExecutor;
 
 class FluidManager
 {
@@ -19,6 +19,8 @@ public:
   FluidManager();
   ~FluidManager();
 
+  void setExecutor(TaskExecutor *executor) { mExecutor = executor; }
+
   bool makeFluidChunk(int32_t hash);
   bool setChunkBoundary(int32_t hash, ChunkBounds *boundary);
   bool setChunk(int32_t hash, Chunk *chunk);
@@ -38,6 +40,7 @@ public:
   void clear();
   
 private:
+  TaskExecutor *mExecutor = nullptr;
   ThreadMap<FluidChunk*> mFluids;
   ThreadMap<Chunk*> mChunks;
   ThreadMap<ChunkBounds*> mBoundaries;
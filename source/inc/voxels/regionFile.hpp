@@ -10,6 +10,7 @@
 #include <array>
 #include <mutex>
 #include <atomic>
+#include <map>
 
 class RegionFile
 {
@@ -24,7 +25,21 @@ public:
   Point3i getRegionPos() const { return mRegionPos; }
   bool readChunk(Chunk *chunk);
   bool writeChunk(const Chunk *chunk);
+  // writes serialized chunks in one batch (returns number written)
+  //  - indices of chunks that couldn't be written are added to failedOut (if given)
+  int writeChunks(const std::vector<std::pair<Point3i, std::vector<uint8_t>>> &chunks,
+                  std::vector<int> *failedOut = nullptr );
   void close();
+
+  // hints kernel to read ahead data for given chunk indices (returns number of chunks prefetched)
+  int prefetch(const std::vector<int> &chunkIndices);
+  int prefetchHits() const     { return mPrefetchHits; }
+  int prefetchMisses() const   { return mPrefetchMisses; }
+  static int chunkIndex(const Point3i cp);
+  
+  // compacts chunk data to remove free space (NOTE: call while idle)
+  size_t compact();
+  size_t freeBytes() const     { return mFreeBytes; }
   
   static std::string regionFileName(const Point3i &regionPos);
   
@@ -37,6 +52,16 @@ private:
   std::array<wData::ChunkInfo, CHUNKS_PER_REGION> mChunkInfo;
   std::array<std::atomic<bool>, CHUNKS_PER_REGION> mChunkStatus;
   Point3i mRegionPos;
+  
+  // slot allocation (capacities are sector aligned; derived from layout when file is read)
+  std::array<uint32_t, CHUNKS_PER_REGION> mChunkCapacity;
+  std::map<uint32_t, uint32_t> mFreeList; // offset --> size
+  size_t mFreeBytes = 0;
+  
+  // prefetching
+  std::array<std::atomic<bool>, CHUNKS_PER_REGION> mPrefetched;
+  std::atomic<int> mPrefetchHits = 0;
+  std::atomic<int> mPrefetchMisses = 0;
 
   // mmap file stuff
   std::string mFilePath;
@@ -47,7 +72,18 @@ private:
 
   bool openFile();
   bool createFile();
-  bool resizeFile(int extraBytes);
+  bool resizeFile(size_t newSize);
+  bool growFile(size_t minSize);
+
+  uint32_t allocate(uint32_t capacity);
+  void release(uint32_t offset, uint32_t capacity);
+  void buildFreeList();
+  static uint32_t sectorAlign(uint32_t bytes)
+  { return ((bytes + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE) * REGION_SECTOR_SIZE; }
+  static size_t dataStart()
+  { return sectorAlign(sizeof(wData::Header) + CHUNK_LOOKUP_SIZE); }
+  static bool isUniformRecord(const wData::ChunkInfo &info)
+  { return (info.chunkSize == 0 && (info.offset & CHUNK_UNIFORM_OFFSET) == CHUNK_UNIFORM_OFFSET); }
   
   void calRegionPos();
   bool readRegion();
@@ -62,10 +98,9 @@ private:
   void readOffset();
   void writeOffset();
   void readChunkData(int chunkIndex);
-  void writeChunkData(int chunkIndex);
+  bool writeSlot(int chunkIndex, const std::vector<uint8_t> &data);
   
-  int chunkIndex(int bx, int by, int bz);
-  int chunkIndex(const Point3i cp);
+  static int chunkIndex(int bx, int by, int bz);
   Point3i unflattenChunkIndex(int index);
 };
 
@@ -6,7 +6,7 @@
 #include <vector>
 #include <string>
 #include <ios>
-#include "FastNoise.h"
+#include "simplexBatch.hpp"
 
 #include "vector.hpp"
 #include "chunk.hpp"
@@ -49,26 +49,35 @@ class TerrainGenerator
 {
 public:
   TerrainGenerator(uint32_t seed)
-    : mSeed(seed)
-  {
-    mNoise.SetNoiseType(FastNoise::Simplex);
-    mNoise.SetFrequency(1.0);
-    mNoise.SetSeed(seed);
-    //mNoise.SetInterp(FastNoise::Linear);
-    mNoise.SetFractalOctaves(4);
-  }
+    : mNoise(seed), mSeed(seed)
+  { }
 
   void setSeed(uint32_t seed)
   {
     mSeed = seed;
-    mNoise.SetSeed(mSeed);
+    mNoise.setSeed(mSeed);
   }
   uint32_t getSeed() const { return mSeed; }
   
+  // outputs raw block data, or uniform chunk data (see Chunk::serializeUniform)
+  //  (thread-safe -- noise is evaluated in per-thread buffers)
   void generate(const Point3i &chunkPos, terrain_t genType,
                      std::vector<uint8_t> &dataOut);
+  // true if every block in the chunk is the same type (returned in blockOut)
+  //  - decided from the terrain's vertical bounds, without evaluating any noise
+  static bool uniformChunk(const Point3i &chunkPos, terrain_t genType, block_t &blockOut);
+  
 private:
-  FastNoise mNoise;
+  // whole-chunk noise grid (inputs and results, indexed like chunk blocks)
+  struct NoiseGrid
+  {
+    std::vector<float> x, y, z, n;
+    void resize(int size) { x.resize(size); y.resize(size); z.resize(size); n.resize(size); }
+    // expands per-axis noise inputs (ax[x], ay[y], az[z]) over the chunk
+    void fill(const float *ax, const float *ay, const float *az);
+  };
+  
+  SimplexBatch mNoise; // (same results as FastNoise Simplex)
   uint32_t mSeed;
   Indexer<Chunk::sizeX, Chunk::sizeY, Chunk::sizeZ> mIndexer;
 };
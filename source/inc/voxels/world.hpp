@@ -9,9 +9,12 @@
 #include "terrain.hpp"
 #include "fluidManager.hpp"
 #include "hashing.hpp"
+#include "taskExecutor.hpp"
 
 #include <mutex>
 #include <vector>
+#include <atomic>
+#include <chrono>
 
 class Shader;
 class cTextureAtlas;
@@ -39,6 +42,8 @@ public:
     Vector3i chunkRadius;
     int loadThreads;
     int meshThreads;
+    bool greedyMesh = false; // (merges fewer faces than it costs at full resolution -- see greedyMeshBench)
+    bool persistMeshCache = false; // save built chunk meshes with the world (faster startup)
   };
   
   // loading
@@ -97,6 +102,7 @@ public:
   
   void setLightLevel(int level) { mLighting = level; }
   void setCenter(const Point3i &chunkCenter);
+  void setVelocity(const Vector3f &vel) { mVelocity = vel; }
   void setRadius(const Vector3i &chunkRadius);
   Point3i getCenter() const;
   Vector3i getRadius() const { return mLoadRadius; }
@@ -130,11 +136,13 @@ private:
   bool mFrustumPaused = false;
 
   // main objects
+  TaskExecutor mExecutor; // (shared by loader, mesher and fluids)
   ChunkMap mChunkMap;
   FluidManager mFluids;
   ChunkLoader *mLoader;
   MeshRenderer *mRenderer;
   RayTracer *mRayTracer;
+  std::string mMeshCachePath = ""; // (empty if mesh cache isn't saved)
 
   Camera *mCamera = nullptr;
 
@@ -153,6 +161,7 @@ private:
   Vector3i mChunkDim;
   Point3i mMinChunk;
   Point3i mMaxChunk;
+  Vector3f mVelocity;
 
   // fog
   float mFogStart;
@@ -171,12 +180,20 @@ private:
   // timing update loop
   double mUpdateTime = 0.0;
   int mUpdateCount = 0;
+  // time to first visible chunk after teleporting (center jumped past the whole loaded window)
+  std::mutex mTeleportLock;
+  bool mTeleported = false;
+  std::chrono::high_resolution_clock::time_point mTeleportTime;
+  Point3i mTeleportMin; // (window loaded after the teleport -- no chunk in it was loaded before)
+  Point3i mTeleportMax;
   
   void addChunkFace(MeshData &data, Chunk *chunk, const Point3i &cp, bool meshed);
 
   bool isEdge(hash_t hash);
   blockSide_t getEdges(hash_t hash);
   void meshChunk(Chunk *chunk);
+  // true if the chunk can't have any visible faces (doesn't need meshing)
+  bool noFaces(Chunk *chunk);
   
   block_t* atBlock(const Point3i &wp);
   block_t getBlock(const Point3i &wp);
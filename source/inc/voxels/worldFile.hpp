@@ -88,6 +88,11 @@ namespace wData
 }
 
 #define CHUNK_LOOKUP_SIZE (sizeof(wData::ChunkInfo) * CHUNKS_PER_REGION)
+#define REGION_SECTOR_SIZE 256          // chunk slot capacities are multiples of this
+#define REGION_GROW_BYTES (64 * 1024)   // minimum region file growth
+// uniform chunks are stored with no data -- chunkSize is 0 and offset is (CHUNK_UNIFORM_OFFSET | type)
+//  (offsets that large are never used for chunk data; a missing chunk has offset 0)
+#define CHUNK_UNIFORM_OFFSET 0xFFFFFF00
 
 
 
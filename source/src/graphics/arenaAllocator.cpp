@@ -0,0 +1,109 @@
+#include "arenaAllocator.hpp"
+
+#include "logging.hpp"
+
+ArenaAllocator::ArenaAllocator(int capacity)
+  : mCapacity(capacity)
+{
+  if(mCapacity > 0)
+    { mFree.emplace(0, mCapacity); }
+}
+
+int ArenaAllocator::largestFree() const
+{
+  int largest = 0;
+  for(auto &iter : mFree)
+    {
+      if(iter.second > largest)
+        { largest = iter.second; }
+    }
+  return largest;
+}
+
+int ArenaAllocator::allocate(int size)
+{
+  if(size <= 0)
+    { return -1; }
+  for(auto iter = mFree.begin(); iter != mFree.end(); iter++)
+    {
+      if(iter->second >= size)
+        {
+          const int offset = iter->first;
+          const int remaining = iter->second - size;
+          mFree.erase(iter);
+          if(remaining > 0)
+            { mFree.emplace(offset + size, remaining); }
+          mAllocated.emplace(offset, size);
+          mUsed += size;
+          return offset;
+        }
+    }
+  return -1;
+}
+
+void ArenaAllocator::free(int offset)
+{
+  auto aIter = mAllocated.find(offset);
+  if(aIter == mAllocated.end())
+    {
+      LOGW("ArenaAllocator: freeing unallocated offset %d!", offset);
+      return;
+    }
+  int start = offset;
+  int size = aIter->second;
+  mAllocated.erase(aIter);
+  mUsed -= size;
+
+  // merge with neighboring free ranges
+  auto next = mFree.lower_bound(start);
+  if(next != mFree.begin())
+    {
+      auto prev = std::prev(next);
+      if(prev->first + prev->second == start)
+        {
+          start = prev->first;
+          size += prev->second;
+          mFree.erase(prev);
+        }
+    }
+  if(next != mFree.end() && start + size == next->first)
+    {
+      size += next->second;
+      mFree.erase(next);
+    }
+  mFree.emplace(start, size);
+}
+
+void ArenaAllocator::clear()
+{
+  mAllocated.clear();
+  mFree.clear();
+  mUsed = 0;
+  if(mCapacity > 0)
+    { mFree.emplace(0, mCapacity); }
+}
+
+std::vector<ArenaAllocator::Move> ArenaAllocator::compact(int newCapacity)
+{
+  if(newCapacity < mUsed)
+    {
+      LOGW("ArenaAllocator: compacting to %d (less than %d used)!", newCapacity, mUsed);
+      newCapacity = mUsed;
+    }
+  std::vector<Move> moves;
+  moves.reserve(mAllocated.size());
+  std::map<int, int> packed;
+  int offset = 0;
+  for(auto &iter : mAllocated)
+    {
+      moves.push_back(Move{iter.first, offset, iter.second});
+      packed.emplace_hint(packed.end(), offset, iter.second);
+      offset += iter.second;
+    }
+  mAllocated.swap(packed);
+  mCapacity = newCapacity;
+  mFree.clear();
+  if(offset < mCapacity)
+    { mFree.emplace(offset, mCapacity - offset); }
+  return moves;
+}
@@ -0,0 +1,16 @@
+#include "drawCommandList.hpp"
+
+void DrawCommandList::clear()
+{
+  mCommands.clear();
+  mPositions.clear();
+}
+
+void DrawCommandList::add(const ArenaMesh &mesh, const Point3f &chunkPos)
+{
+  if(mesh.numIndices <= 0)
+    { return; }
+  mCommands.push_back(DrawCommand{(uint32_t)mesh.numIndices, 1, (uint32_t)mesh.iOffset,
+                                  (int32_t)(mesh.vOffset - mesh.indexBase), (uint32_t)mPositions.size() });
+  mPositions.push_back(chunkPos);
+}
@@ -0,0 +1,272 @@
+#include "meshArena.hpp"
+
+#include "vertex.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+
+static_assert(sizeof(Point3f) == 3*sizeof(float), "Chunk positions must be tightly packed!");
+
+MeshArena::MeshArena()
+{ }
+
+MeshArena::~MeshArena()
+{ }
+
+bool MeshArena::initGL(int numVertices, int numIndices)
+{
+  if(mVao)
+    { return false; }
+  initializeOpenGLFunctions();
+
+  mVertices = ArenaAllocator(numVertices);
+  mIndices = ArenaAllocator(numIndices);
+  
+  glGenBuffers(1, &mVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cBlockVertex)*numVertices, nullptr, GL_DYNAMIC_DRAW);
+  glGenBuffers(1, &mIbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mIbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int)*numIndices, nullptr, GL_DYNAMIC_DRAW);
+  glGenBuffers(1, &mInstanceBuffer);
+  glGenBuffers(1, &mIndirectBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glGenVertexArrays(1, &mVao);
+  bindAttributes();
+  return true;
+}
+
+void MeshArena::cleanupGL()
+{
+  if(!mVao)
+    { return; }
+  glDeleteVertexArrays(1, &mVao);
+  glDeleteBuffers(1, &mVbo);
+  glDeleteBuffers(1, &mIbo);
+  glDeleteBuffers(1, &mInstanceBuffer);
+  glDeleteBuffers(1, &mIndirectBuffer);
+  mVao = mVbo = mIbo = mInstanceBuffer = mIndirectBuffer = 0;
+  mVertices = ArenaAllocator();
+  mIndices = ArenaAllocator();
+  mMeshes.clear();
+}
+
+void MeshArena::bindAttributes()
+{
+  glBindVertexArray(mVao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+  // packed vertices (see cBlockVertex)
+  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(cBlockVertex), (GLvoid*)0);
+  // chunk position (per draw -- indexed by baseInstance)
+  glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Point3f), (GLvoid*)0);
+  glVertexAttribDivisor(1, 1);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const MeshArena::ChunkSections* MeshArena::find(hash_t hash) const
+{
+  auto iter = mMeshes.find(hash);
+  return (iter != mMeshes.end() ? &iter->second : nullptr);
+}
+
+int MeshArena::allocate(ArenaAllocator &alloc, GLuint &buffer, int elementSize, int size)
+{
+  int offset = alloc.allocate(size);
+  if(offset >= 0)
+    { return offset; }
+
+  // compact live data into a new buffer (grow if mostly full)
+  int capacity = std::max(alloc.capacity(), 1);
+  while(alloc.used() + size > capacity*3/4)
+    { capacity *= 2; }
+  if(capacity != alloc.capacity())
+    { LOGI("Growing mesh arena buffer: %d --> %d elements", alloc.capacity(), capacity); }
+  
+  GLuint newBuffer = 0;
+  glGenBuffers(1, &newBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)elementSize*capacity, nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+  std::unordered_map<int, int> moved; // old offset --> new offset
+  for(auto &move : alloc.compact(capacity))
+    {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)elementSize*move.from,
+                          (GLintptr)elementSize*move.to, (GLsizeiptr)elementSize*move.size );
+      moved.emplace(move.from, move.to);
+    }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteBuffers(1, &buffer);
+  buffer = newBuffer;
+  
+  for(auto &iter : mMeshes)
+    {
+      for(auto &mesh : iter.second)
+        {
+          int &meshOffset = (&alloc == &mVertices ? mesh.vOffset : mesh.iOffset);
+          if(meshOffset >= 0)
+            { meshOffset = moved[meshOffset]; }
+        }
+    }
+  bindAttributes();
+  return alloc.allocate(size);
+}
+
+// room to grow when a section is remeshed (so small edits can be patched in place)
+static inline int withSlack(int size)
+{ return ((size + size/4) + 63) & ~63; }
+
+void MeshArena::free(ArenaMesh &mesh)
+{
+  if(mesh.vOffset >= 0)
+    { mVertices.free(mesh.vOffset); }
+  if(mesh.iOffset >= 0)
+    { mIndices.free(mesh.iOffset); }
+  mesh = ArenaMesh();
+}
+
+ArenaMesh* MeshArena::allocate(hash_t hash, int section, int numVertices, int numIndices)
+{
+  ArenaMesh *mesh = &mMeshes[hash][section];
+  if(numVertices <= 0 || numIndices <= 0)
+    { // empty section
+      free(*mesh);
+      return mesh;
+    }
+  if(numVertices > mesh->vCapacity || numIndices > mesh->iCapacity)
+    {
+      free(*mesh);
+      const int vCapacity = withSlack(numVertices);
+      const int iCapacity = withSlack(numIndices);
+      // (mesh offsets were reset by free(), so a compaction while allocating skips it)
+      const int vOffset = allocate(mVertices, mVbo, sizeof(cBlockVertex), vCapacity);
+      if(vOffset < 0)
+        {
+          LOGE("Mesh arena failed to allocate %d vertices!", vCapacity);
+          return nullptr;
+        }
+      const int iOffset = allocate(mIndices, mIbo, sizeof(unsigned int), iCapacity);
+      if(iOffset < 0)
+        {
+          LOGE("Mesh arena failed to allocate %d indices!", iCapacity);
+          mVertices.free(vOffset);
+          return nullptr;
+        }
+      mesh = &mMeshes[hash][section];
+      mesh->vOffset = vOffset;
+      mesh->vCapacity = vCapacity;
+      mesh->iOffset = iOffset;
+      mesh->iCapacity = iCapacity;
+    }
+  mesh->numVertices = numVertices;
+  mesh->numIndices = numIndices;
+  return mesh;
+}
+
+bool MeshArena::upload(hash_t hash, const BlockMeshData &data, const MeshSections &sections)
+{
+  bool success = true;
+  for(int s = 0; s < ChunkBounds::numSections; s++)
+    {
+      if(!(sections.mask & (1 << s)))
+        { continue; }
+      const int numVertices = sections.vertices[s+1] - sections.vertices[s];
+      const int numIndices = sections.indices[s+1] - sections.indices[s];
+      ArenaMesh *mesh = allocate(hash, s, numVertices, numIndices);
+      if(!mesh)
+        {
+          success = false;
+          continue;
+        }
+      if(mesh->numIndices > 0)
+        {
+          mesh->indexBase = sections.vertices[s];
+          glBindBuffer(GL_COPY_WRITE_BUFFER, mVbo);
+          glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(cBlockVertex)*mesh->vOffset,
+                          sizeof(cBlockVertex)*numVertices, &data.vertices()[sections.vertices[s]] );
+          glBindBuffer(GL_COPY_WRITE_BUFFER, mIbo);
+          glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int)*mesh->iOffset,
+                          sizeof(unsigned int)*numIndices, &data.indices()[sections.indices[s]] );
+          glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+  return success;
+}
+
+bool MeshArena::copy(hash_t hash, const BlockMeshData &data, const MeshSections &sections,
+                     GLuint srcBuffer, int srcOffset )
+{
+  bool success = true;
+  const int iSrcOffset = srcOffset + sizeof(cBlockVertex)*data.vertices().size();
+  for(int s = 0; s < ChunkBounds::numSections; s++)
+    {
+      if(!(sections.mask & (1 << s)))
+        { continue; }
+      const int numVertices = sections.vertices[s+1] - sections.vertices[s];
+      const int numIndices = sections.indices[s+1] - sections.indices[s];
+      ArenaMesh *mesh = allocate(hash, s, numVertices, numIndices);
+      if(!mesh)
+        {
+          success = false;
+          continue;
+        }
+      if(mesh->numIndices > 0)
+        {
+          mesh->indexBase = sections.vertices[s];
+          glBindBuffer(GL_COPY_READ_BUFFER, srcBuffer);
+          glBindBuffer(GL_COPY_WRITE_BUFFER, mVbo);
+          glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                              srcOffset + sizeof(cBlockVertex)*sections.vertices[s],
+                              sizeof(cBlockVertex)*mesh->vOffset, sizeof(cBlockVertex)*numVertices );
+          glBindBuffer(GL_COPY_WRITE_BUFFER, mIbo);
+          glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                              iSrcOffset + sizeof(unsigned int)*sections.indices[s],
+                              sizeof(unsigned int)*mesh->iOffset, sizeof(unsigned int)*numIndices );
+          glBindBuffer(GL_COPY_READ_BUFFER, 0);
+          glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+  return success;
+}
+
+void MeshArena::remove(hash_t hash)
+{
+  auto iter = mMeshes.find(hash);
+  if(iter != mMeshes.end())
+    {
+      for(auto &mesh : iter->second)
+        { free(mesh); }
+      mMeshes.erase(iter);
+    }
+}
+
+void MeshArena::clear()
+{
+  mMeshes.clear();
+  mVertices.clear();
+  mIndices.clear();
+}
+
+void MeshArena::render(const DrawCommandList &draws)
+{
+  if(draws.size() == 0)
+    { return; }
+  glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Point3f)*draws.size(), draws.positions().data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand)*draws.size(), draws.commands().data(),
+               GL_STREAM_DRAW );
+  
+  glBindVertexArray(mVao);
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, draws.size(), 0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
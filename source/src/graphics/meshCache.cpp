@@ -0,0 +1,183 @@
+#include "meshCache.hpp"
+
+#include "logging.hpp"
+
+#include <fstream>
+
+#define MESH_CACHE_MAGIC 0x4843534D // "MSCH"
+#define MESH_CACHE_VERSION 3
+
+MeshCache::MeshCache(long maxBytes)
+  : mMaxBytes(maxBytes)
+{ }
+
+void MeshCache::setMaxBytes(long maxBytes)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  mMaxBytes = maxBytes;
+  evict();
+}
+
+long MeshCache::bytes()
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  return mBytes;
+}
+
+int MeshCache::size()
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  return mEntries.size();
+}
+
+void MeshCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  mEntries.clear();
+  mLookup.clear();
+  mBytes = 0;
+}
+
+bool MeshCache::get(hash_t hash, uint64_t contentHash, bool greedy, BlockMeshData &meshOut,
+                    MeshSections &sectionsOut, std::vector<ActiveBlock> &facesOut,
+                    std::vector<ActiveBlock> *chunkFacesOut )
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  auto iter = mLookup.find(hash);
+  if(iter == mLookup.end() || iter->second->contentHash != contentHash ||
+     iter->second->greedy != greedy )
+    {
+      mMisses++;
+      return false;
+    }
+  mEntries.splice(mEntries.begin(), mEntries, iter->second);
+  const Entry &entry = *iter->second;
+  meshOut.vertices() = entry.vertices;
+  meshOut.indices() = entry.indices;
+  sectionsOut = entry.sections;
+  facesOut = entry.faces;
+  if(chunkFacesOut)
+    { *chunkFacesOut = entry.chunkFaces; }
+  mHits++;
+  return true;
+}
+
+void MeshCache::put(hash_t hash, uint64_t contentHash, bool greedy, const BlockMeshData &mesh,
+                    const MeshSections &sections, const std::vector<ActiveBlock> &faces,
+                    const std::vector<ActiveBlock> *chunkFaces )
+{
+  Entry entry{hash, contentHash, greedy, mesh.vertices(), mesh.indices(), sections, faces,
+              (chunkFaces ? *chunkFaces : std::vector<ActiveBlock>()) };
+  std::lock_guard<std::mutex> lock(mLock);
+  insert(std::move(entry), true);
+  evict();
+}
+
+void MeshCache::insert(Entry &&entry, bool front)
+{
+  auto iter = mLookup.find(entry.hash);
+  if(iter != mLookup.end())
+    { // replace old entry
+      mBytes -= iter->second->bytes();
+      mEntries.erase(iter->second);
+      mLookup.erase(iter);
+    }
+  if(entry.bytes() > mMaxBytes)
+    { return; }
+  mBytes += entry.bytes();
+  auto eIter = (front ? mEntries.insert(mEntries.begin(), std::move(entry)) :
+                        mEntries.insert(mEntries.end(), std::move(entry)) );
+  mLookup.emplace(eIter->hash, eIter);
+}
+
+void MeshCache::evict()
+{
+  while(mBytes > mMaxBytes && mEntries.size() > 0)
+    {
+      const Entry &entry = mEntries.back();
+      mBytes -= entry.bytes();
+      mLookup.erase(entry.hash);
+      mEntries.pop_back();
+    }
+}
+
+template<typename T>
+static void writeVector(std::ofstream &file, const std::vector<T> &v)
+{
+  const uint32_t n = v.size();
+  file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  file.write(reinterpret_cast<const char*>(v.data()), sizeof(T)*n);
+}
+template<typename T>
+static bool readVector(std::ifstream &file, std::vector<T> &v)
+{
+  uint32_t n = 0;
+  if(!file.read(reinterpret_cast<char*>(&n), sizeof(n)) || n > (1 << 24))
+    { return false; }
+  v.resize(n);
+  return (bool)file.read(reinterpret_cast<char*>(v.data()), sizeof(T)*n);
+}
+
+bool MeshCache::save(const std::string &path)
+{
+  std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file.is_open())
+    {
+      LOGW("Failed to open mesh cache file '%s' for writing!", path.c_str());
+      return false;
+    }
+  std::lock_guard<std::mutex> lock(mLock);
+  const uint32_t header[3] = { MESH_CACHE_MAGIC, MESH_CACHE_VERSION, (uint32_t)mEntries.size() };
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  for(auto &entry : mEntries)
+    { // (most recent first)
+      const uint8_t greedy = entry.greedy;
+      file.write(reinterpret_cast<const char*>(&entry.hash), sizeof(entry.hash));
+      file.write(reinterpret_cast<const char*>(&entry.contentHash), sizeof(entry.contentHash));
+      file.write(reinterpret_cast<const char*>(&greedy), sizeof(greedy));
+      writeVector(file, entry.vertices);
+      writeVector(file, entry.indices);
+      file.write(reinterpret_cast<const char*>(&entry.sections), sizeof(entry.sections));
+      writeVector(file, entry.faces);
+      writeVector(file, entry.chunkFaces);
+    }
+  LOGI("Saved %d cached chunk meshes (%.1f MB)", (int)mEntries.size(), mBytes/(1024.0*1024.0));
+  return (bool)file;
+}
+
+bool MeshCache::load(const std::string &path)
+{
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if(!file.is_open())
+    { return false; }
+  uint32_t header[3];
+  if(!file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+     header[0] != MESH_CACHE_MAGIC || header[1] != MESH_CACHE_VERSION )
+    {
+      LOGW("Ignoring invalid mesh cache file '%s'", path.c_str());
+      return false;
+    }
+  
+  std::lock_guard<std::mutex> lock(mLock);
+  for(uint32_t i = 0; i < header[2]; i++)
+    {
+      Entry entry;
+      uint8_t greedy = 0;
+      if(!file.read(reinterpret_cast<char*>(&entry.hash), sizeof(entry.hash)) ||
+         !file.read(reinterpret_cast<char*>(&entry.contentHash), sizeof(entry.contentHash)) ||
+         !file.read(reinterpret_cast<char*>(&greedy), sizeof(greedy)) ||
+         !readVector(file, entry.vertices) || !readVector(file, entry.indices) ||
+         !file.read(reinterpret_cast<char*>(&entry.sections), sizeof(entry.sections)) ||
+         !readVector(file, entry.faces) || !readVector(file, entry.chunkFaces) )
+        {
+          LOGW("Mesh cache file '%s' is truncated (read %d/%d entries)", path.c_str(), i, header[2]);
+          break;
+        }
+      entry.greedy = greedy;
+      if(mLookup.count(entry.hash) == 0) // (already cached entries are newer)
+        { insert(std::move(entry), false); }
+    }
+  evict();
+  LOGI("Loaded %d cached chunk meshes (%.1f MB)", (int)mEntries.size(), mBytes/(1024.0*1024.0));
+  return true;
+}
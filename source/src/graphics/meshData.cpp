@@ -1,20 +1,27 @@
 #include "meshData.hpp"
 
 
-MeshData::MeshData(bool doubleBuffer)
+template<typename VertexT>
+MeshDataT<VertexT>::MeshDataT(bool doubleBuffer)
   : mDoubleBuffer(doubleBuffer)
 { }
 
-MeshData::~MeshData()
+template<typename VertexT>
+MeshDataT<VertexT>::~MeshDataT()
 { }
 
-bool MeshData::empty() const
+template<typename VertexT>
+bool MeshDataT<VertexT>::empty() const
 { return (indices().size() == 0 || vertices().size() == 0); }
 
-void MeshData::swap()
+template<typename VertexT>
+void MeshDataT<VertexT>::swap()
 {
   if(mDoubleBuffer)
     { mActive = (mActive + 1) % 2; }
   vertices().clear();
   indices().clear();
 }
+
+template class MeshDataT<cSimpleVertex>;
+template class MeshDataT<cBlockVertex>;
@@ -0,0 +1,137 @@
+// MeshRenderer quad building -- tables and static helpers that build chunk meshes
+//  (kept out of meshRenderer.cpp so tools can build identical meshes without a renderer)
+#include "meshRenderer.hpp"
+
+#include "chunk.hpp"
+
+
+// CUBE FACE INDICES
+const std::array<unsigned int, 6> MeshRenderer::faceIndices =
+  { 0, 1, 2, 3, 1, 0 };
+const std::array<unsigned int, 6> MeshRenderer::reverseIndices =
+  { 0, 1, 3, 2, 1, 0 };
+const std::array<unsigned int, 6> MeshRenderer::flippedIndices =
+  { 0, 3, 2, 1, 2, 3 };
+std::unordered_map<blockSide_t, std::array<cSimpleVertex, 4>> MeshRenderer::faceVertices =
+  // CUBE FACE VERTICES
+  {{blockSide_t::PX,
+    {cSimpleVertex(Point3f{1, 0, 0}, Vector3f{1, 0, 0}, Vector2f{0.0f, 0.0f} ),
+     cSimpleVertex(Point3f{1, 1, 1}, Vector3f{1, 0, 0}, Vector2f{1.0f, 1.0f} ),
+     cSimpleVertex(Point3f{1, 0, 1}, Vector3f{1, 0, 0}, Vector2f{0.0f, 1.0f} ),
+     cSimpleVertex(Point3f{1, 1, 0}, Vector3f{1, 0, 0}, Vector2f{1.0f, 0.0f} ) }},
+   {blockSide_t::PY,
+    {cSimpleVertex(Point3f{0, 1, 0}, Vector3f{0, 1, 0}, Vector2f{0.0f, 0.0f} ),
+     cSimpleVertex(Point3f{1, 1, 1}, Vector3f{0, 1, 0}, Vector2f{1.0f, 1.0f} ),
+     cSimpleVertex(Point3f{1, 1, 0}, Vector3f{0, 1, 0}, Vector2f{0.0f, 1.0f} ),
+     cSimpleVertex(Point3f{0, 1, 1}, Vector3f{0, 1, 0}, Vector2f{1.0f, 0.0f} ) }},
+   {blockSide_t::PZ,
+    {cSimpleVertex(Point3f{0, 0, 1}, Vector3f{0, 0, 1}, Vector2f{0.0f, 0.0f} ),
+     cSimpleVertex(Point3f{1, 1, 1}, Vector3f{0, 0, 1}, Vector2f{1.0f, 1.0f} ),
+     cSimpleVertex(Point3f{0, 1, 1}, Vector3f{0, 0, 1}, Vector2f{0.0f, 1.0f} ),
+     cSimpleVertex(Point3f{1, 0, 1}, Vector3f{0, 0, 1}, Vector2f{1.0f, 0.0f} ) }},
+   {blockSide_t::NX,
+    {cSimpleVertex(Point3f{0, 0, 0}, Vector3f{-1, 0, 0}, Vector2f{0.0f, 0.0f} ),
+     cSimpleVertex(Point3f{0, 1, 1}, Vector3f{-1, 0, 0}, Vector2f{1.0f, 1.0f} ),
+     cSimpleVertex(Point3f{0, 1, 0}, Vector3f{-1, 0, 0}, Vector2f{0.0f, 1.0f} ),
+     cSimpleVertex(Point3f{0, 0, 1}, Vector3f{-1, 0, 0}, Vector2f{1.0f, 0.0f} ) }},
+   {blockSide_t::NY,
+    {cSimpleVertex(Point3f{0, 0, 0}, Vector3f{0, -1, 0}, Vector2f{0.0f, 0.0f} ),
+     cSimpleVertex(Point3f{1, 0, 1}, Vector3f{0, -1, 0}, Vector2f{1.0f, 1.0f} ),
+     cSimpleVertex(Point3f{0, 0, 1}, Vector3f{0, -1, 0}, Vector2f{0.0f, 1.0f} ),
+     cSimpleVertex(Point3f{1, 0, 0}, Vector3f{0, -1, 0}, Vector2f{1.0f, 0.0f} ) }},
+   {blockSide_t::NZ,
+    {cSimpleVertex(Point3f{0, 0, 0}, Vector3f{0, 0, -1}, Vector2f{0.0f, 0.0f} ),
+     cSimpleVertex(Point3f{1, 1, 0}, Vector3f{0, 0, -1}, Vector2f{1.0f, 1.0f} ),
+     cSimpleVertex(Point3f{1, 0, 0}, Vector3f{0, 0, -1}, Vector2f{0.0f, 1.0f} ),
+     cSimpleVertex(Point3f{0, 1, 0}, Vector3f{0, 0, -1}, Vector2f{1.0f, 0.0f} ) }} };
+
+const std::array<blockSide_t, 6> MeshRenderer::meshSides =
+  { blockSide_t::PX, blockSide_t::PY,
+    blockSide_t::PZ, blockSide_t::NX,
+    blockSide_t::NY, blockSide_t::NZ };
+const std::array<Point3i, 6> MeshRenderer::meshSideDirections =
+  { Point3i{1,0,0}, Point3i{0,1,0}, Point3i{0,0,1},
+    Point3i{-1,0,0}, Point3i{0,-1,0}, Point3i{0,0,-1} };
+
+
+inline int MeshRenderer::getAO(int e1, int e2, int c)
+{
+  if(e1 == 1 && e2 == 1)
+    { return 3; }
+  else
+    { return (e1 + e2 + c); }
+}
+
+int MeshRenderer::getLighting(const PaddedChunk &padded, const Point3i &bp, const Point3f &vp,
+                              blockSide_t side )
+{
+  const int dim = sideDim(side); // dimension of face normal
+  const int dim1 = (dim+1) % 3;  // dimension of edge 1
+  const int dim2 = (dim+2) % 3;  // dimension of edge 2
+
+  const int e1 = bp[dim1] + (int)vp[dim1] * 2 - 1;
+  const int e2 = bp[dim2] + (int)vp[dim2] * 2 - 1;
+  
+  Point3i bi;
+  bi[dim] = bp[dim] + sideSign(side);
+  bi[dim1] = e1;
+  bi[dim2] = e2;
+
+  int lc = (isSimpleBlock(padded.get(bi)) ? 1 : 0);
+  bi[dim1] = bp[dim1];
+  int le1 = (isSimpleBlock(padded.get(bi)) ? 1 : 0);
+  bi[dim1] = e1;
+  bi[dim2] = bp[dim2];
+  int le2 = (isSimpleBlock(padded.get(bi)) ? 1 : 0);
+  return 3 - getAO(le1, le2, lc);
+}
+
+uint32_t MeshRenderer::faceLighting(const PaddedChunk &padded, const Point3i &bp, blockSide_t side)
+{
+  uint32_t key = 0;
+  int vn = 0;
+  for(auto &v : faceVertices[side])
+    { key |= getLighting(padded, bp, v.pos, side) << (2*vn++); }
+  return key;
+}
+
+void MeshRenderer::addQuad(BlockMeshData &mesh, const Point3i &bp, const Vector3i &size, blockSide_t side,
+                           block_t type, uint32_t lighting, int scale )
+{
+  const int face = (int)sideToNormal(side);
+  int vn = 0;
+  int sum0 = 0;
+  int sum1 = 0;
+  const unsigned int numVert = mesh.vertices().size();
+  for(auto &v : faceVertices[side])
+    { // add vertices for each corner
+      const int l = (lighting >> (2*vn)) & 0x3;
+      if(vn < 2)
+        { sum0 += l; }
+      else
+        { sum1 += l; }
+      
+      mesh.vertices().emplace_back((bp + Point3i(v.pos)*size)*scale, face, l, (int)type);
+      vn++;
+    }
+  const std::array<unsigned int, 6> *orientedIndices = (sum1 > sum0 ?
+                                                        &flippedIndices :
+                                                        &faceIndices );
+  for(auto i : *orientedIndices)
+    { mesh.indices().push_back(numVert + i); }
+}
+
+void MeshRenderer::addRect(BlockMeshData &mesh, const ActiveRect &rect, int scale)
+{
+  int normalDim, dim0, dim1;
+  ChunkBounds::rectDims(rect.side, normalDim, dim0, dim1);
+  Point3i bp;
+  bp[normalDim] = rect.depth;
+  bp[dim0] = rect.pos[0];
+  bp[dim1] = rect.pos[1];
+  Vector3i size{1, 1, 1};
+  size[dim0] = rect.size[0];
+  size[dim1] = rect.size[1];
+  // (lighting was the same for all merged faces)
+  addQuad(mesh, bp, size, rect.side, rect.type, rect.key, scale);
+}
@@ -9,63 +9,17 @@
 #include "fluidManager.hpp"
 #include "world.hpp"
 #include "traversalTree.hpp"
+#include "epoch.hpp"
+#include "pointMath.hpp"
 #include <unistd.h>
-
-
-
-// CUBE FACE INDICES
-const std::array<unsigned int, 6> MeshRenderer::faceIndices =
-  { 0, 1, 2, 3, 1, 0 };
-const std::array<unsigned int, 6> MeshRenderer::reverseIndices =
-  { 0, 1, 3, 2, 1, 0 };
-const std::array<unsigned int, 6> MeshRenderer::flippedIndices =
-  { 0, 3, 2, 1, 2, 3 };
-std::unordered_map<blockSide_t, std::array<cSimpleVertex, 4>> MeshRenderer::faceVertices =
-  // CUBE FACE VERTICES
-  {{blockSide_t::PX,
-    {cSimpleVertex(Point3f{1, 0, 0}, Vector3f{1, 0, 0}, Vector2f{0.0f, 0.0f} ),
-     cSimpleVertex(Point3f{1, 1, 1}, Vector3f{1, 0, 0}, Vector2f{1.0f, 1.0f} ),
-     cSimpleVertex(Point3f{1, 0, 1}, Vector3f{1, 0, 0}, Vector2f{0.0f, 1.0f} ),
-     cSimpleVertex(Point3f{1, 1, 0}, Vector3f{1, 0, 0}, Vector2f{1.0f, 0.0f} ) }},
-   {blockSide_t::PY,
-    {cSimpleVertex(Point3f{0, 1, 0}, Vector3f{0, 1, 0}, Vector2f{0.0f, 0.0f} ),
-     cSimpleVertex(Point3f{1, 1, 1}, Vector3f{0, 1, 0}, Vector2f{1.0f, 1.0f} ),
-     cSimpleVertex(Point3f{1, 1, 0}, Vector3f{0, 1, 0}, Vector2f{0.0f, 1.0f} ),
-     cSimpleVertex(Point3f{0, 1, 1}, Vector3f{0, 1, 0}, Vector2f{1.0f, 0.0f} ) }},
-   {blockSide_t::PZ,
-    {cSimpleVertex(Point3f{0, 0, 1}, Vector3f{0, 0, 1}, Vector2f{0.0f, 0.0f} ),
-     cSimpleVertex(Point3f{1, 1, 1}, Vector3f{0, 0, 1}, Vector2f{1.0f, 1.0f} ),
-     cSimpleVertex(Point3f{0, 1, 1}, Vector3f{0, 0, 1}, Vector2f{0.0f, 1.0f} ),
-     cSimpleVertex(Point3f{1, 0, 1}, Vector3f{0, 0, 1}, Vector2f{1.0f, 0.0f} ) }},
-   {blockSide_t::NX,
-    {cSimpleVertex(Point3f{0, 0, 0}, Vector3f{-1, 0, 0}, Vector2f{0.0f, 0.0f} ),
-     cSimpleVertex(Point3f{0, 1, 1}, Vector3f{-1, 0, 0}, Vector2f{1.0f, 1.0f} ),
-     cSimpleVertex(Point3f{0, 1, 0}, Vector3f{-1, 0, 0}, Vector2f{0.0f, 1.0f} ),
-     cSimpleVertex(Point3f{0, 0, 1}, Vector3f{-1, 0, 0}, Vector2f{1.0f, 0.0f} ) }},
-   {blockSide_t::NY,
-    {cSimpleVertex(Point3f{0, 0, 0}, Vector3f{0, -1, 0}, Vector2f{0.0f, 0.0f} ),
-     cSimpleVertex(Point3f{1, 0, 1}, Vector3f{0, -1, 0}, Vector2f{1.0f, 1.0f} ),
-     cSimpleVertex(Point3f{0, 0, 1}, Vector3f{0, -1, 0}, Vector2f{0.0f, 1.0f} ),
-     cSimpleVertex(Point3f{1, 0, 0}, Vector3f{0, -1, 0}, Vector2f{1.0f, 0.0f} ) }},
-   {blockSide_t::NZ,
-    {cSimpleVertex(Point3f{0, 0, 0}, Vector3f{0, 0, -1}, Vector2f{0.0f, 0.0f} ),
-     cSimpleVertex(Point3f{1, 1, 0}, Vector3f{0, 0, -1}, Vector2f{1.0f, 1.0f} ),
-     cSimpleVertex(Point3f{1, 0, 0}, Vector3f{0, 0, -1}, Vector2f{0.0f, 1.0f} ),
-     cSimpleVertex(Point3f{0, 1, 0}, Vector3f{0, 0, -1}, Vector2f{1.0f, 0.0f} ) }} };
-
-const std::array<blockSide_t, 6> MeshRenderer::meshSides =
-  { blockSide_t::PX, blockSide_t::PY,
-    blockSide_t::PZ, blockSide_t::NX,
-    blockSide_t::NY, blockSide_t::NZ };
-const std::array<Point3i, 6> MeshRenderer::meshSideDirections =
-  { Point3i{1,0,0}, Point3i{0,1,0}, Point3i{0,0,1},
-    Point3i{-1,0,0}, Point3i{0,-1,0}, Point3i{0,0,-1} };
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
 
 
 
 MeshRenderer::MeshRenderer()
-  : mMeshPool(1, std::bind(&MeshRenderer::meshWorker, this, std::placeholders::_1),
-              MESH_THREAD_SLEEP_MS*1000)
 {
 
 }
@@ -75,22 +29,27 @@ MeshRenderer::~MeshRenderer()
   
 }
 
-void MeshRenderer::setMeshThreads(int meshThreads)
-{
-  mMeshPool.setThreads(meshThreads);
-}
-
-
 void MeshRenderer::startMeshing()
 {
-  mMeshPool.start();
+  if(!mMeshingActive)
+    {
+      mMeshingActive = true;
+      // submit tasks for chunks queued while stopped
+      int queued = 0;
+      {
+        std::lock_guard<std::mutex> lock(mMeshLock);
+        queued = mMeshQueue.size() + mPriorityMeshQueue.size();
+      }
+      for(int i = 0; i < queued; i++)
+        { submitMesh(); }
+    }
 }
 void MeshRenderer::stopMeshing()
 {
-  mMeshPool.stop(false);
-  mMeshCv.notify_all();
-  mPriorityCv.notify_all();
-  mMeshPool.stop(true);
+  mMeshingActive = false;
+  // wait for mesh tasks in progress
+  std::unique_lock<std::mutex> lock(mMeshLock);
+  mMeshDoneCv.wait(lock, [this]{ return mActiveMeshTasks == 0; });
 }
 
 int MeshRenderer::numMeshed()
@@ -100,6 +59,12 @@ int MeshRenderer::numMeshed()
   return mMeshed.size();
 }
 
+int MeshRenderer::numVisible()
+{
+  std::lock_guard<std::mutex> lock(mRenderLock);
+  return mVisible.size();
+}
+
 bool MeshRenderer::initGL(QObject *qParent)
 {
   if(!mInitialized)
@@ -107,7 +72,7 @@ bool MeshRenderer::initGL(QObject *qParent)
       // load shaders
       mBlockShader = new Shader(qParent);
       if(!mBlockShader->loadProgram("./shaders/simpleBlock.vsh", "./shaders/simpleBlock.fsh",
-                                    {"posAttr", "normalAttr", "texCoordAttr"},
+                                    {"vertexAttr", "chunkPosAttr"},
                                     {"pvm", "camPos", "fogStart", "fogEnd", "uTex", "dirScale"} ))
         {
           LOGE("Simple block shader failed to load!");
@@ -124,6 +89,29 @@ bool MeshRenderer::initGL(QObject *qParent)
           mBlockShader->setUniform("dirScale", mDirScale);
           mBlockShader->release();
         }
+      
+      // fluids (unpacked vertices -- not aligned to the block grid)
+      mFluidShader = new Shader(qParent);
+      if(!mFluidShader->loadProgram("./shaders/fluid.vsh", "./shaders/simpleBlock.fsh",
+                                    {"posAttr", "normalAttr", "texCoordAttr"},
+                                    {"pvm", "camPos", "fogStart", "fogEnd", "uTex", "dirScale"} ))
+        {
+          LOGE("Fluid shader failed to load!");
+          delete mFluidShader;
+          mFluidShader = nullptr;
+          delete mBlockShader;
+          mBlockShader = nullptr;
+          return false;
+        }
+      else
+        {
+          mFluidShader->bind();
+          mFluidShader->setUniform("uTex", 0);
+          mFluidShader->setUniform("fogStart", mFogStart);
+          mFluidShader->setUniform("fogEnd", mFogEnd);
+          mFluidShader->setUniform("dirScale", mDirScale);
+          mFluidShader->release();
+        }
 
       mComplexShader = new Shader(qParent);
       if(!mComplexShader->loadProgram("./shaders/complexBlock.vsh", "./shaders/complexBlock.fsh",
@@ -133,6 +121,8 @@ bool MeshRenderer::initGL(QObject *qParent)
           LOGE("Complex shader failed to load!");
           delete mComplexShader;
           mComplexShader = nullptr;
+          delete mFluidShader;
+          mFluidShader = nullptr;
           delete mBlockShader;
           mBlockShader = nullptr;
           return false;
@@ -175,6 +165,8 @@ bool MeshRenderer::initGL(QObject *qParent)
           // mMiniMapShader = nullptr;
               delete mComplexShader;
               mComplexShader = nullptr;
+              delete mFluidShader;
+              mFluidShader = nullptr;
               delete mBlockShader;
               mBlockShader = nullptr;
               return false;
@@ -191,12 +183,18 @@ bool MeshRenderer::initGL(QObject *qParent)
           // mMiniMapShader = nullptr;
           delete mComplexShader;
           mComplexShader = nullptr;
+          delete mFluidShader;
+          mFluidShader = nullptr;
           delete mBlockShader;
           mBlockShader = nullptr;
           delete mTexAtlas;
           mTexAtlas = nullptr;
           return false;
         }
+
+      if(!mUploadRing.initGL(UPLOAD_RING_SIZE))
+        { LOGW("Upload ring unavailable -- uploading meshes directly."); }
+      mArena.initGL();
       
       mInitialized = true;
     }
@@ -208,6 +206,7 @@ void MeshRenderer::cleanupGL()
   if(mInitialized)
     {
       delete mBlockShader;
+      delete mFluidShader;
       //delete mMiniMapShader;
       mTexAtlas->destroy();
       delete mTexAtlas;
@@ -223,27 +222,27 @@ void MeshRenderer::cleanupGL()
       
       {
         std::lock_guard<std::mutex> lock(mRenderLock);
-        for(auto mesh : mRenderMeshes)
-          {
-            mesh.second->cleanupGL();
-            delete mesh.second;
-          }
-        mRenderMeshes.clear();
+        mArena.cleanupGL();
       }
-      while(mUnusedMeshes.size() > 0)
+      for(auto mesh : mFluidMeshes)
         {
-          ChunkMesh *mesh = mUnusedMeshes.front();
-          mUnusedMeshes.pop();
-          mesh->cleanupGL();
-          delete mesh;
+          mesh.second->cleanupGL();
+          delete mesh.second;
         }
-      std::lock_guard<std::mutex> lock(mUnusedMCLock);
-      while(mUnusedMC.size() > 0)
+      mFluidMeshes.clear();
+      while(mUnusedFluidMeshes.size() > 0)
         {
-          MeshedChunk *mc = mUnusedMC.front();
-          mUnusedMC.pop();
-          delete mc;
+          ChunkMesh *mesh = mUnusedFluidMeshes.front();
+          mUnusedFluidMeshes.pop();
+          mesh->cleanupGL();
+          delete mesh;
         }
+      MeshedChunk *mc;
+      while((mc = nextRender()))
+        { delete mc; }
+      while(mUnusedMC.tryPop(mc))
+        { delete mc; }
+      mUploadRing.cleanupGL();
       mInitialized = false;
     }
 }
@@ -251,35 +250,69 @@ void MeshRenderer::cleanupGL()
 
 void MeshRenderer::addMesh(MeshedChunk *mc)
 {
-  auto iter = mRenderMeshes.find(mc->hash);
-  if(iter != mRenderMeshes.end())
-    {
-      mUnusedMeshes.push(iter->second);
-      mRenderMeshes.erase(iter->first);
-    }
-  else
+  if(!mArena.find(mc->hash))
     {
+      if(mc->sections.mask != Chunk::allSections)
+        { // partial update, but chunk was unloaded since -- needs a full remesh
+          std::lock_guard<std::mutex> lock(mChunkLock);
+          auto iter = mRenderChunks.find(mc->hash);
+          if(iter != mRenderChunks.end())
+            { iter->second->setDirty(true); }
+          recycleMC(mc);
+          return;
+        }
       std::lock_guard<std::mutex> lock(mMeshedLock);
       mMeshed.insert(mc->hash);
-      mMeshed.insert(mc->hash);
     }
   
-  ChunkMesh *mesh;
-  if(mUnusedMeshes.size() > 0)
-    {
-      mesh = mUnusedMeshes.front();
-      mUnusedMeshes.pop();
+  bool added;
+  if(mUploadRing.valid(mc->staged))
+    { // copy from staging on the GPU
+      added = mArena.copy(mc->hash, mc->mesh, mc->sections, mUploadRing.bufferId(), mc->staged.offset);
+      mUploadRing.fence(mc->staged);
     }
   else
+    { added = mArena.upload(mc->hash, mc->mesh, mc->sections); }
+  if(!added)
     {
-      mesh = new ChunkMesh();
-      mesh->initGL(mBlockShader);
+      mArena.remove(mc->hash);
+      std::lock_guard<std::mutex> lock(mMeshedLock);
+      mMeshed.erase(mc->hash);
     }
-  mesh->uploadData(mc->mesh);
-  mRenderMeshes[mc->hash] = mesh;
+  
+  { // (mesh is drawn this frame)
+    std::lock_guard<std::mutex> lock(mEditLock);
+    auto iter = mEditTimes.find(mc->hash);
+    if(iter != mEditTimes.end())
+      {
+        LOGD("Block edit --> mesh visible: %.2f ms (%d/%d sections remeshed)",
+             std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                      iter->second ).count(),
+             __builtin_popcount(mc->sections.mask), Chunk::numSections );
+        mEditTimes.erase(iter);
+      }
+  }
+  recycleMC(mc);
+}
 
-  std::lock_guard<std::mutex> lock(mUnusedMCLock);
-  mUnusedMC.push(mc);
+void MeshRenderer::recycleMC(MeshedChunk *mc)
+{
+  mUploadRing.discard(mc->staged); // (no-op if already fenced)
+  mc->staged = UploadRing::Region();
+  if(!mUnusedMC.tryPush(mc))
+    { delete mc; } // pool full
+}
+
+void MeshRenderer::stageMesh(MeshedChunk *mc)
+{
+  const int vBytes = sizeof(cBlockVertex)*mc->mesh.vertices().size();
+  const int iBytes = sizeof(unsigned int)*mc->mesh.indices().size();
+  char *data = nullptr;
+  if(mUploadRing.reserve(vBytes + iBytes, mc->staged, data))
+    {
+      std::memcpy(data, mc->mesh.vertices().data(), vBytes);
+      std::memcpy(data + vBytes, mc->mesh.indices().data(), iBytes);
+    }
 }
 
 void MeshRenderer::clearMeshes()
@@ -287,42 +320,33 @@ void MeshRenderer::clearMeshes()
   
 }
 
-#define RENDER_LOAD_MESH_PER_FRAME 1
 void MeshRenderer::render(const Matrix4 &pvm, const Point3f &camPos, bool reset)
 {
   if(reset)
     {
       {
         std::lock_guard<std::mutex> lock(mRenderLock);
-        for(auto mesh : mRenderMeshes)
-          {
-            mUnusedMeshes.push(mesh.second);
-            std::lock_guard<std::mutex> lock(mMeshedLock);
-            mMeshed.erase(mesh.first);
-          }
-        mRenderMeshes.clear();
-      }
-      {
-        std::lock_guard<std::mutex> lock(mRenderQueueLock);
-        while(mRenderQueue.size() > 0)
-          {
-            MeshedChunk *mc = mRenderQueue.front();
-            mRenderQueue.pop();
-            std::lock_guard<std::mutex> lock(mUnusedMCLock);
-            mUnusedMC.push(mc);
-          }
+        mArena.clear();
+        std::lock_guard<std::mutex> meshedLock(mMeshedLock);
+        mMeshed.clear();
+        std::lock_guard<std::mutex> lodLock(mLodLock);
+        mLods.clear();
       }
+      MeshedChunk *mc;
+      while((mc = nextRender()))
+        { recycleMC(mc); }
     }
   {
-    std::lock_guard<std::mutex> lock(mRenderQueueLock);
-    int num = 0;
-    while(mRenderQueue.size() > 0)
+    // upload finished meshes until the frame's budget is used up
+    mUploadRing.reclaim();
+    const auto uploadStart = std::chrono::high_resolution_clock::now();
+    const float budget = mUploadBudget;
+    MeshedChunk *mc;
+    while((mc = nextRender()))
       {
-        MeshedChunk *mc = mRenderQueue.front();
-        mRenderQueue.pop();
         addMesh(mc);
-        
-        if(++num >= RENDER_LOAD_MESH_PER_FRAME)
+        if(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                    uploadStart ).count() >= budget )
           { break; }
       }
     // update fluid meshes
@@ -334,22 +358,22 @@ void MeshRenderer::render(const Matrix4 &pvm, const Point3f &camPos, bool reset)
         auto iter2 = mFluidMeshes.find(hash);
         if(iter2 != mFluidMeshes.end())
           {
-            mUnusedMeshes.push(iter2->second);
+            mUnusedFluidMeshes.push(iter2->second);
             mFluidMeshes.erase(iter2->first);
           }
 
         if(data)
           { // null data means to remove mesh.
             ChunkMesh *mesh;
-            if(mUnusedMeshes.size() > 0)
+            if(mUnusedFluidMeshes.size() > 0)
               {
-                mesh = mUnusedMeshes.front();
-                mUnusedMeshes.pop();
+                mesh = mUnusedFluidMeshes.front();
+                mUnusedFluidMeshes.pop();
               }
             else
               {
                 mesh = new ChunkMesh();
-                mesh->initGL(mBlockShader);
+                mesh->initGL(mFluidShader);
               }
             mesh->uploadData(*data);
             delete data;
@@ -361,23 +385,18 @@ void MeshRenderer::render(const Matrix4 &pvm, const Point3f &camPos, bool reset)
     std::lock_guard<std::mutex> lock(mUnloadLock);
     for(auto hash : mUnloadQueue)
       {
-        auto iter = mRenderMeshes.find(hash);
-        if(iter != mRenderMeshes.end())
+        if(mArena.find(hash))
           {
-            ChunkMesh *mesh = iter->second;
-            mesh->detachData();
-            mRenderMeshes.erase(hash);
-            mUnusedMeshes.push(mesh);
-            
+            mArena.remove(hash);
             std::lock_guard<std::mutex> lock(mMeshedLock);
-            mMeshed.erase(iter->first);
+            mMeshed.erase(hash);
           }
         auto fIter = mFluidMeshes.find(hash);
         if(fIter != mFluidMeshes.end())
           {
             ChunkMesh *mesh = fIter->second;
             mFluidMeshes.erase(hash);
-            mUnusedMeshes.push(mesh);
+            mUnusedFluidMeshes.push(mesh);
           }
       }
     mUnloadQueue.clear();
@@ -388,7 +407,8 @@ void MeshRenderer::render(const Matrix4 &pvm, const Point3f &camPos, bool reset)
   mBlockShader->bind();
   mBlockShader->setUniform("pvm", pvm);
   mBlockShader->setUniform("camPos", camPos);
-  if(mFogChanged)
+  const bool fogChanged = mFogChanged;
+  if(fogChanged)
     {
       mBlockShader->setUniform("fogStart", mFogStart);
       mBlockShader->setUniform("fogEnd", mFogEnd);
@@ -397,23 +417,55 @@ void MeshRenderer::render(const Matrix4 &pvm, const Point3f &camPos, bool reset)
     }
 
   Camera *cam = (mFrustumCulling && mFrustumPaused ? &mPausedCamera : mCamera);
-  std::vector<hash_t> visible = mMap->getVisible(mFrustumCulling ?
-                                                 (mFrustumPaused ? &mPausedCamera : mCamera) :
-                                                 nullptr );
+  const auto visibleStart = std::chrono::high_resolution_clock::now();
+  mMap->getVisible((mFrustumCulling ? cam : nullptr), mVisibleHashes);
+  const int numVisible = mVisibleHashes.size();
+  if(mFrustumCulling && mOcclusionCulling)
+    { mMap->cullOccluded(cam, mOcclusion, mVisibleHashes); }
+  mVisibleTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                           visibleStart ).count();
+  mVisibleChunks += mVisibleHashes.size();
+  mOccludedChunks += numVisible - (int)mVisibleHashes.size();
+  if(++mVisibleFrames >= VISIBLE_STATS_INTERVAL)
+    {
+      LOGD("Visibility: %.3f ms/frame, %d chunks/frame (%d occluded)", mVisibleTime / mVisibleFrames,
+           (int)(mVisibleChunks / mVisibleFrames), (int)(mOccludedChunks / mVisibleFrames) );
+      mVisibleTime = 0.0;
+      mVisibleChunks = 0;
+      mOccludedChunks = 0;
+      mVisibleFrames = 0;
+    }
+  
   std::lock_guard<std::mutex> lock(mRenderLock);
   mVisible.clear();
-  for(auto hash : visible)
+  mDrawList.clear();
+  for(auto hash : mVisibleHashes)
     {
-      auto mIter = mRenderMeshes.find(hash);
-      if(mIter != mRenderMeshes.end())
+      const MeshArena::ChunkSections *sections = mArena.find(hash);
+      if(sections)
         {
-          mIter->second->render();
+          // (vertex positions are relative to the chunk)
+          const Point3f chunkPos(Hash::unhash(hash)*Chunk::size);
+          for(auto &mesh : *sections)
+            { mDrawList.add(mesh, chunkPos); }
           mVisible.insert(hash);
         }
     }
+  mArena.render(mDrawList);
+  mBlockShader->release();
+
+  mFluidShader->bind();
+  mFluidShader->setUniform("pvm", pvm);
+  mFluidShader->setUniform("camPos", camPos);
+  if(fogChanged)
+    {
+      mFluidShader->setUniform("fogStart", mFogStart);
+      mFluidShader->setUniform("fogEnd", mFogEnd);
+      mFluidShader->setUniform("dirScale", mDirScale);
+    }
   for(auto &iter : mFluidMeshes)
     { iter.second->render(); }
-  mBlockShader->release();
+  mFluidShader->release();
 
   // render complex models
   mComplexShader->bind();
@@ -457,8 +509,7 @@ void MeshRenderer::render(const Matrix4 &pvm, const Point3f &camPos, bool reset)
   // glViewport(VP_PADDING, VP_PADDING, VP_W, VP_H);
   // glClear(GL_DEPTH_BUFFER_BIT);
   // mMiniMapShader->setUniform("pvm", Matrix4(miniMapP) * Matrix4(miniMapV));
-  // for(auto mesh : mRenderMeshes)
-  //   { mesh.second->render(); }
+  // mArena.render(mDrawList);
   // glViewport(vp[0], vp[1], vp[2], vp[3]);
   // mMiniMapShader->release();
     
@@ -479,6 +530,48 @@ void MeshRenderer::reorderQueue(const Point3i &newCenter)
   mCenter = newCenter;
 }
 
+void MeshRenderer::setCenter(const Point3i &pos)
+{
+  mCenter = pos;
+  std::lock_guard<std::mutex> lock(mLodLock);
+  mLodCenter = pos;
+}
+
+int MeshRenderer::lodLevel(const Point3i &cp, int current) const
+{
+  if(!mLodEnabled)
+    { return 0; }
+  // (distance is the largest offset along any axis)
+  auto levelAt = [](int dist) -> int
+                 {
+                   int level = 0;
+                   while(level < LOD_LEVELS-1 && dist > (LOD_DISTANCE << level))
+                     { level++; }
+                   return level;
+                 };
+  const int dist = (cp - mLodCenter).abs().max();
+  const int level = levelAt(dist);
+  if(current < 0 || level == current)
+    { return level; }
+  // only switch once past the level's distance by LOD_HYSTERESIS
+  else if(level > current)
+    { return (levelAt(dist - LOD_HYSTERESIS) > current ? level : current); }
+  else
+    { return (levelAt(dist + LOD_HYSTERESIS) < current ? level : current); }
+}
+
+std::vector<hash_t> MeshRenderer::lodChanges()
+{
+  std::vector<hash_t> changed;
+  std::lock_guard<std::mutex> lock(mLodLock);
+  for(auto &iter : mLods)
+    {
+      if(lodLevel(Hash::unhash(iter.first), iter.second) != iter.second)
+        { changed.push_back(iter.first); }
+    }
+  return changed;
+}
+
 void MeshRenderer::load(Chunk *chunk, const Point3i &center, bool priority)
 {
   mCenter = center;
@@ -495,15 +588,14 @@ void MeshRenderer::load(Chunk *chunk, const Point3i &center, bool priority)
   
   mMeshing.insert(Hash::hash(chunk->pos()));
   lock.unlock();
-  if(priority)
-    {
-      mPriorityCv.notify_one();
-    }
-  else
-    {
-      mMeshCv.notify_one();
-    }
+  submitMesh();
 }
+void MeshRenderer::blockEdited(hash_t hash)
+{
+  std::lock_guard<std::mutex> lock(mEditLock);
+  mEditTimes.emplace(hash, std::chrono::high_resolution_clock::now());
+}
+
 void MeshRenderer::unload(hash_t hash)
 {
   { // stop meshing chunk
@@ -518,6 +610,10 @@ void MeshRenderer::unload(hash_t hash)
     std::lock_guard<std::mutex> lock(mUnloadLock);
     mUnloadQueue.insert(hash);
   }
+  {
+    std::lock_guard<std::mutex> lock(mLodLock);
+    mLods.erase(hash);
+  }
 }
 
 bool MeshRenderer::isMeshed(hash_t hash)
@@ -536,41 +632,50 @@ bool MeshRenderer::isVisible(hash_t hash)
   std::unique_lock<std::mutex> lock(mRenderLock);
   return mVisible.count(hash) > 0;
 }
-
-void MeshRenderer::meshWorker(int tid)
+bool MeshRenderer::anyVisible(const Point3i &minChunk, const Point3i &maxChunk)
 {
-  if(!mMeshPool.running())
-    { return; }
-  
-  // wait for chunks to mesh
-  std::unique_lock<std::mutex> lock(mMeshLock);
-  mWaitingThreads++;
-  ChunkPtr next = nullptr;
-  mMeshCv.wait(lock, [this]{ return (!mMeshPool.running() ||
-                                     mPriorityMeshQueue.size() > 0 ||
-                                     mMeshQueue.size() > 0 );});
-  if(!mMeshPool.running())
-    { return; }
+  std::unique_lock<std::mutex> lock(mRenderLock);
+  return std::any_of(mVisible.begin(), mVisible.end(),
+                     [&minChunk, &maxChunk](hash_t hash)
+                     { return pointInRange(Hash::unhash(hash), minChunk, maxChunk); });
+}
 
-  if(mPriorityMeshQueue.size() > 0)
+void MeshRenderer::submitMesh()
+{ // each task meshes the next queued chunk when it runs (priority chunks first)
+  if(mMeshingActive && mExecutor)
     {
-      next = mPriorityMeshQueue.front();
-      mPriorityMeshQueue.pop_front();
+      {
+        std::lock_guard<std::mutex> lock(mMeshLock);
+        mActiveMeshTasks++;
+      }
+      mExecutor->submit(std::bind(&MeshRenderer::meshNext, this));
     }
-  else if(mMeshQueue.size() > 0)
+}
+
+void MeshRenderer::meshNext()
+{
+  EpochGuard epoch; // (keeps unloaded chunks from being reused while meshing)
+  std::unique_lock<std::mutex> lock(mMeshLock);
+  ChunkPtr next = nullptr;
+  if(mMeshingActive)
     {
-      next = mMeshQueue.front();
-      mMeshQueue.pop_front();
+      if(mPriorityMeshQueue.size() > 0)
+        {
+          next = mPriorityMeshQueue.front();
+          mPriorityMeshQueue.pop_front();
+        }
+      else if(mMeshQueue.size() > 0)
+        {
+          next = mMeshQueue.front();
+          mMeshQueue.pop_front();
+        }
     }
-    
-  mWaitingThreads--;
   
   // get chunk
-  hash_t cHash = next->hash();
-  if(mMeshing.count(cHash) > 0)
+  if(next && mMeshing.count(next->hash()) > 0)
     { // mesh chunk
+      hash_t cHash = next->hash();
       mMeshing.erase(cHash);
-      //LOGD("MESHING: %d", cHash);
       lock.unlock();
       {
         std::lock_guard<std::mutex> lock(mMeshedLock);
@@ -581,56 +686,15 @@ void MeshRenderer::meshWorker(int tid)
         std::lock_guard<std::mutex> lock(mMeshedLock);
         mMeshingNow.erase(cHash);
       }
+      lock.lock();
     }
+  if(--mActiveMeshTasks == 0)
+    { mMeshDoneCv.notify_all(); }
 }
 
-inline int MeshRenderer::getAO(int e1, int e2, int c)
-{
-  if(e1 == 1 && e2 == 1)
-    { return 3; }
-  else
-    { return (e1 + e2 + c); }
-}
-
-block_t MeshRenderer::getBlock(Chunk *chunk, const Point3i &wp)
-{
-  Point3i diff = World::chunkPos(wp) - chunk->pos();
-  if(diff[0] != 0 || diff[1] != 0 || diff[2] != 0)
-    {
-      Chunk *n = chunk->getNeighbor(getSide(diff));
-      if(n)
-        { return n->getType(Chunk::blockPos(wp)); }
-      else
-        { return block_t::NONE; }
-    }
-  else
-    { return chunk->getType(Chunk::blockPos(wp)); }
-}
-
-int MeshRenderer::getLighting(Chunk *chunk, const Point3i &wp, const Point3f &vp, blockSide_t side)
-{
-  const int dim = sideDim(side); // dimension of face normal
-  const int dim1 = (dim+1) % 3;  // dimension of edge 1
-  const int dim2 = (dim+2) % 3;  // dimension of edge 2
-
-  const int e1 = wp[dim1] + (int)vp[dim1] * 2 - 1;
-  const int e2 = wp[dim2] + (int)vp[dim2] * 2 - 1;
-  
-  Point3i bi;
-  bi[dim] = wp[dim] + sideSign(side);
-  bi[dim1] = e1;
-  bi[dim2] = e2;
-
-  Chunk *nc = nullptr;
-  int lc = (isSimpleBlock(getBlock(chunk, bi)) ? 1 : 0);
-  bi[dim1] = wp[dim1];
-  int le1 = (isSimpleBlock(getBlock(chunk, bi)) ? 1 : 0);
-  bi[dim1] = e1;
-  bi[dim2] = wp[dim2];
-  int le2 = (isSimpleBlock(getBlock(chunk, bi)) ? 1 : 0);
-  return 3 - getAO(le1, le2, lc);
-}
-
+#define MESH_STATS_INTERVAL 256 // chunks meshed between timing logs
+static_assert((1 << (LOD_LEVELS-1)) <= ChunkBounds::sectionHeight,
+              "LOD cells span more than one mesh section" );
 
 // 10ms avg
 void MeshRenderer::updateChunkMesh(Chunk *chunk)
@@ -643,89 +707,190 @@ void MeshRenderer::updateChunkMesh(Chunk *chunk)
       return;
     }
   
-  chunk->calcBounds();
-  ChunkBounds *bounds = chunk->getBounds();
-  bool hasFluids = mFluids->setChunkBoundary(cHash, bounds);
-  
-  MeshedChunk *mc = nullptr;
+  // level of detail (whole mesh is rebuilt if it changed)
+  int lod;
+  bool lodChanged;
   {
-    std::lock_guard<std::mutex> lock(mUnusedMCLock);
-    if(mUnusedMC.size() > 0)
-      {
-        mc = mUnusedMC.front();
-        mUnusedMC.pop();
-      }
+    std::lock_guard<std::mutex> lock(mLodLock);
+    auto iter = mLods.find(cHash);
+    const int current = (iter != mLods.end() ? iter->second : -1);
+    lod = lodLevel(cPos, current);
+    lodChanged = (lod != current);
+    mLods[cHash] = lod;
   }
-  if(!mc)
-    { mc = new MeshedChunk({cHash, MeshData()}); }
+  
+  // snapshot of the chunk and its border (mesh is built from this alone)
+  static thread_local PaddedChunk padded;
+  padded.capture(chunk, [this](const Point3i &cp) { return (*mMap)[cp]; });
+  // (full resolution contents -- level is part of the key)
+  const uint64_t contentHash = padded.contentHash() ^ (uint64_t)lod;
+  const bool greedy = mGreedyMeshing;
+  
+  MeshedChunk *mc = nullptr;
+  if(!mUnusedMC.tryPop(mc))
+    { mc = new MeshedChunk({cHash, BlockMeshData()}); }
   else
     {
       mc->hash = cHash;
       mc->mesh.swap();
     }
 
-  const Point3i minP({cPos[0]*Chunk::sizeX,
-                      cPos[1]*Chunk::sizeY,
-                      cPos[2]*Chunk::sizeZ} );
+  // only remesh the sections that changed (unless the chunk isn't meshed yet)
+  uint32_t sectionMask = chunk->takeDirtySections();
+  if(!sectionMask || lodChanged || !isMeshed(cHash))
+    { sectionMask = Chunk::allSections; }
 
-  bounds->lock();
-  std::unordered_map<hash_t, ActiveBlock> &chunkBounds = bounds->getBounds();
-  for(auto &iter : chunkBounds)
+  // LOD cells are downsampled from the snapshot (captured from Chunk::blocks(), or the uniform type)
+  //  (chunk keeps full resolution bounds for fluids -- faces on the cell grid are only for the mesh)
+  static thread_local ChunkBounds lodBounds;
+  ChunkBounds *bounds = (lod > 0 ? &lodBounds : chunk->getBounds());
+  
+  // reuse the last mesh built from the same blocks, if it's still cached
+  //  (full resolution faces are cached with LOD meshes, so a hit skips both calcBounds)
+  static thread_local std::vector<ActiveBlock> cachedFaces;
+  static thread_local std::vector<ActiveBlock> cachedChunkFaces;
+  const bool cached = mMeshCache.get(cHash, contentHash, greedy, mc->mesh, mc->sections, cachedFaces,
+                                     (lod > 0 ? &cachedChunkFaces : nullptr) );
+  if(cached)
+    {
+      bounds->setFaces(cachedFaces);
+      if(lod > 0)
+        { chunk->getBounds()->setFaces(cachedChunkFaces); }
+    }
+  else
     {
-      const hash_t hash = iter.first;
-      const ActiveBlock &block = iter.second;
-          
-      const Point3i bp = Hash::unhash(hash);
-      const Point3i vOffset = minP + bp;
-          
-      for(int i = 0; i < 6; i++)
+      chunk->calcBounds(padded);
+      if(lod > 0)
         {
-          if((block.sides & meshSides[i]) != blockSide_t::NONE)
-            {
-              int vn = 0;
-              int sum0 = 0;
-              int sum1 = 0;
-              const unsigned int numVert = mc->mesh.vertices().size();
-              for(auto &v : faceVertices[meshSides[i]])
-                { // add vertices for this face
-                  const int lighting = getLighting(chunk, vOffset, v.pos, meshSides[i]);
-                  if(vn < 2)
-                    { sum0 += lighting; }
-                  else
-                    { sum1 += lighting; }
-                      
-                  mc->mesh.vertices().emplace_back(vOffset + v.pos,
-                                                   v.normal,
-                                                   v.texcoord,
-                                                   (int)block.block - 1,
-                                                   (float)lighting / (float)4 );
-                  vn++;
-                }
-              const std::array<unsigned int, 6> *orientedIndices = (sum1 > sum0 ?
-                                                                    &flippedIndices :
-                                                                    &faceIndices );
-              for(auto i : *orientedIndices)
-                { mc->mesh.indices().push_back(numVert + i); }
-            }
+          padded.downsample(1 << lod);
+          lodBounds.calcBounds(padded);
+        }
+    }
+  bool hasFluids = mFluids->setChunkBoundary(cHash, chunk->getBounds());
+
+  if(!cached)
+    {
+      buildMesh(mc->mesh, mc->sections, sectionMask, padded, bounds, greedy, lod);
+      if(sectionMask == Chunk::allSections)
+        {
+          ChunkBounds *chunkBounds = chunk->getBounds();
+          chunkBounds->lock(); // (LOD bounds are thread local)
+          mMeshCache.put(cHash, contentHash, greedy, mc->mesh, mc->sections, bounds->getFaces(),
+                         (lod > 0 ? &chunkBounds->getFaces() : nullptr) );
+          chunkBounds->unlock();
         }
     }
-  bounds->unlock();
   {
     std::lock_guard<std::mutex> lock(mRenderLock);
     mComplexBlocks.erase(cHash);
     mComplexBlocks.emplace(cHash, chunk->getComplex());
   }
   // pass to render thread
+  stageMesh(mc);
+  queueRender(mc);
+}
+
+void MeshRenderer::buildMesh(BlockMeshData &mesh, MeshSections &sections, uint32_t sectionMask,
+                             const PaddedChunk &padded, ChunkBounds *bounds, bool greedy, int lod )
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  const int scale = 1 << lod; // (faces are on the cell grid -- quads are scaled up when emitted)
+  // faces are only merged if all four vertices have the same lighting
+  auto faceKey = [&padded](const Point3i &bp, blockSide_t side) { return faceLighting(padded, bp, side); };
+  
+  sections.mask = sectionMask;
+  bounds->lock();
+  for(int s = 0; s < Chunk::numSections; s++)
+    {
+      sections.vertices[s] = mesh.vertices().size();
+      sections.indices[s] = mesh.indices().size();
+      if(!(sectionMask & (1 << s)))
+        { continue; }
+      
+      if(greedy)
+        {
+          for(auto &rect : bounds->simplifyGreedy(faceKey, s, scale))
+            { addRect(mesh, rect, scale); }
+        }
+      else
+        {
+          std::vector<ActiveBlock> &faces = bounds->getFaces();
+          int first, last;
+          bounds->sectionFaces(s, first, last, scale);
+          for(int f = first; f < last; f++)
+            {
+              const Point3i bp = ChunkBounds::blockPos(faces[f]);
+              for(int i = 0; i < 6; i++)
+                {
+                  if((faces[f].sides & meshSides[i]) != blockSide_t::NONE)
+                    {
+                      addQuad(mesh, bp, Vector3i{1, 1, 1}, meshSides[i], faces[f].block,
+                              faceLighting(padded, bp, meshSides[i]), scale );
+                    }
+                }
+            }
+        }
+    }
+  sections.vertices[Chunk::numSections] = mesh.vertices().size();
+  sections.indices[Chunk::numSections] = mesh.indices().size();
+  bounds->unlock();
   {
-    std::lock_guard<std::mutex> lock(mRenderQueueLock);
-    mRenderQueue.push(mc);
+    std::lock_guard<std::mutex> lock(mTimingLock);
+    mMeshTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                          start ).count();
+    mMeshVertices += mesh.vertices().size();
+    mMeshLods[lod]++;
+    if(++mMeshNum >= MESH_STATS_INTERVAL)
+      {
+        const long hits = mMeshCache.hits();
+        const long total = hits + mMeshCache.misses();
+        std::ostringstream lods; // (chunks meshed at each level)
+        for(int l = 0; l < LOD_LEVELS; l++)
+          { lods << (l > 0 ? "/" : "") << mMeshLods[l]; }
+        LOGD("Meshing (%s): %.3f ms/chunk, %d vertices/chunk (cache: %.1f%% hits, %.1f MB, LOD: %s)",
+             (greedy ? "greedy" : "naive"), mMeshTime / mMeshNum, (int)(mMeshVertices / mMeshNum),
+             (total > 0 ? 100.0*hits/total : 0.0), mMeshCache.bytes()/(1024.0*1024.0),
+             lods.str().c_str() );
+        mMeshTime = 0.0;
+        mMeshVertices = 0;
+        mMeshNum = 0;
+        mMeshLods.fill(0);
+      }
   }
 }
 
+void MeshRenderer::queueRender(MeshedChunk *mc)
+{
+  // once anything has overflowed, keep using the overflow queue until it's drained (preserves order)
+  if(mNumOverflow > 0 || !mRenderQueue.tryPush(mc))
+    {
+      std::lock_guard<std::mutex> lock(mOverflowLock);
+      mRenderOverflow.push(mc);
+      mNumOverflow++;
+    }
+}
+MeshRenderer::MeshedChunk* MeshRenderer::nextRender()
+{
+  MeshedChunk *mc = nullptr;
+  if(!mRenderQueue.tryPop(mc) && mNumOverflow > 0)
+    {
+      std::lock_guard<std::mutex> lock(mOverflowLock);
+      if(mRenderOverflow.size() > 0)
+        {
+          mc = mRenderOverflow.front();
+          mRenderOverflow.pop();
+          mNumOverflow--;
+        }
+    }
+  return mc;
+}
+
 void MeshRenderer::setCamera(Camera *camera)
 { mCamera = camera; }
 void MeshRenderer::setFrustumCulling(bool on)
 { mFrustumCulling = on; }
+void MeshRenderer::setOcclusionCulling(bool on)
+{ mOcclusionCulling = on; }
 void MeshRenderer::pauseFrustumCulling()
 {
   if(mFrustumCulling)
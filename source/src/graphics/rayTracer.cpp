@@ -202,13 +202,23 @@ void RayTracer::pauseFrustum()
   if(mFrustumPaused)
     {
       mFrustumRender.clear();
-      int num = 0;
+      // (culled in one batch)
+      std::vector<hash_t> hashes;
+      Frustum::BoxList boxes;
+      hashes.reserve(mChunks.size());
+      boxes.reserve(mChunks.size());
       for(auto &iter : mChunks)
         {
-          if(mCamera->cubeInFrustum(Hash::unhash(iter.first)*Chunk::size, Chunk::size))
-            { mFrustumRender.insert(iter.first); num++; }
-          else
-            { mFrustumRender.erase(iter.first); }
+          const Point3f minP = Hash::unhash(iter.first)*Chunk::size;
+          hashes.push_back(iter.first);
+          boxes.add(minP, minP + Vector3f(Chunk::size));
+        }
+      std::vector<uint64_t> mask;
+      mCamera->getFrustum().cull(boxes, mask);
+      for(int i = 0; i < (int)hashes.size(); i++)
+        {
+          if((mask[i / 64] >> (i % 64)) & 1)
+            { mFrustumRender.insert(hashes[i]); }
         }
       mFrustumPaused = false;
     }
@@ -256,8 +266,9 @@ bool RayTracer::prepareChunkData(hash_t hash)
   auto iter = mChunkData.find(hash);
   iter->second.clear();
 
-  for(auto &b : chunk->data())
-    { iter->second.push_back((int)b-1); }
+  const block_t *blocks = chunk->blocks();
+  for(int bi = 0; bi < Chunk::totalSize; bi++)
+    { iter->second.push_back((int)(blocks ? blocks[bi] : chunk->uniformType())-1); }
   
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, bid);
   glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(int)*Chunk::totalSize,
@@ -0,0 +1,144 @@
+#include "uploadRing.hpp"
+
+#include "logging.hpp"
+
+UploadRing::UploadRing()
+{ }
+
+UploadRing::~UploadRing()
+{ }
+
+bool UploadRing::initGL(int size)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  if(mData)
+    { return false; }
+  initializeOpenGLFunctions();
+
+  const GLbitfield flags = (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+  glGenBuffers(1, &mBuffer);
+  glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+  glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, flags);
+  mData = (char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  if(!mData)
+    {
+      LOGE("Failed to map upload ring buffer!");
+      glDeleteBuffers(1, &mBuffer);
+      mBuffer = 0;
+      return false;
+    }
+  mSize = size;
+  mHead = 0;
+  return true;
+}
+
+void UploadRing::cleanupGL()
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  if(!mData)
+    { return; }
+  for(auto &e : mEntries)
+    {
+      if(e.sync)
+        { glDeleteSync(e.sync); }
+    }
+  mEntries.clear();
+  
+  glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+  glUnmapBuffer(GL_COPY_READ_BUFFER);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glDeleteBuffers(1, &mBuffer);
+  mBuffer = 0;
+  mData = nullptr;
+  mSize = 0;
+  mHead = 0;
+}
+
+bool UploadRing::reserve(int size, Region &regionOut, char* &dataOut)
+{
+  size = (size + 3) & ~3; // (keep regions 4-byte aligned)
+  std::lock_guard<std::mutex> lock(mLock);
+  if(!mData || size <= 0 || size > mSize)
+    { return false; }
+  
+  int start = -1;
+  if(mEntries.size() == 0)
+    { // empty -- start over at the beginning
+      mHead = 0;
+      start = 0;
+    }
+  else
+    {
+      const int tail = mEntries.front().start;
+      if(mHead >= tail)
+        { // free space is [head, size) and [0, tail)
+          if(mHead + size <= mSize)
+            { start = mHead; }
+          else if(size < tail)
+            { start = 0; }  // wrap (end of buffer is skipped)
+        }
+      else if(mHead + size < tail)
+        { start = mHead; }  // free space is [head, tail)
+    }
+  if(start < 0)
+    { return false; }
+
+  mHead = start + size;
+  mEntries.push_back(Entry{mNextId++, start, mHead});
+  regionOut = Region{mEntries.back().id, start, size};
+  dataOut = mData + start;
+  return true;
+}
+
+UploadRing::Entry* UploadRing::findEntry(uint64_t id)
+{
+  for(auto &e : mEntries)
+    {
+      if(e.id == id)
+        { return &e; }
+    }
+  return nullptr;
+}
+
+bool UploadRing::valid(const Region &region)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  return (region.id != 0 && findEntry(region.id));
+}
+
+void UploadRing::fence(const Region &region)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  Entry *e = findEntry(region.id);
+  if(e && !e->done)
+    {
+      e->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      e->done = true;
+    }
+}
+
+void UploadRing::discard(const Region &region)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  Entry *e = findEntry(region.id);
+  if(e)
+    { e->done = true; }
+}
+
+void UploadRing::reclaim()
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  while(mEntries.size() > 0 && mEntries.front().done)
+    {
+      Entry &e = mEntries.front();
+      if(e.sync)
+        {
+          const GLenum result = glClientWaitSync(e.sync, 0, 0);
+          if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            { break; } // GPU is still reading
+          glDeleteSync(e.sync);
+        }
+      mEntries.pop_front();
+    }
+}
@@ -7,6 +7,7 @@
 #include <QHBoxLayout>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QCheckBox>
 #include <QString>
 #include <QPushButton>
 #include <QListWidget>
@@ -89,6 +90,13 @@ WorldLoad::WorldLoad(World *world, QWidget *parent)
   QWidget *mtWidget = new QWidget(this);
   mtWidget->setLayout(mt);
 
+  QCheckBox *greedyCb = new QCheckBox("Greedy Meshing");
+  greedyCb->setChecked(mOptions.greedyMesh);
+  connect(greedyCb, SIGNAL(stateChanged(int)), this, SLOT(setGreedyMesh(int)));
+  QCheckBox *cacheCb = new QCheckBox("Save Meshes With World");
+  cacheCb->setChecked(mOptions.persistMeshCache);
+  connect(cacheCb, SIGNAL(stateChanged(int)), this, SLOT(setPersistMeshCache(int)));
+
   QHBoxLayout *btnLayout = new QHBoxLayout();
   Button *backButton = new Button("Back");
   connect(backButton, SIGNAL(clicked()), this, SIGNAL(back()));
@@ -111,6 +119,8 @@ WorldLoad::WorldLoad(World *world, QWidget *parent)
   innerLayout->addWidget(radWidget);
   innerLayout->addWidget(ltWidget);
   innerLayout->addWidget(mtWidget);
+  innerLayout->addWidget(greedyCb);
+  innerLayout->addWidget(cacheCb);
   innerLayout->addLayout(btnLayout);
   
   QFrame *innerFrame = new QFrame();
@@ -161,6 +171,16 @@ void WorldLoad::setMeshThreads(int threads)
   mOptions.meshThreads = threads;
   update();
 }
+void WorldLoad::setGreedyMesh(int on)
+{
+  mOptions.greedyMesh = (on != 0);
+  update();
+}
+void WorldLoad::setPersistMeshCache(int on)
+{
+  mOptions.persistMeshCache = (on != 0);
+  update();
+}
 
 void WorldLoad::loadWorld()
 { emit loaded(mOptions); }
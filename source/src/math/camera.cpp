@@ -121,6 +121,15 @@ void Camera::calcPlanes()
   // // back (far)
   // mPlanes[5] = { fbr, fbl, ftr, ftl,
   //                crossProduct((fbl - fbr), (ftr - fbr)).normalized() };
+
+  // culling planes face inward (side plane normals above face outward)
+  for(int i = 0; i < 4; i++)
+    {
+      mFrustum.setPlane((Frustum::planeIndex_t)i, Frustum::Plane{-mPlanes[i].normal,
+                                                                 mPlanes[i].normal.dot(mPlanes[i].center) });
+    }
+  mFrustum.setPlane(Frustum::FRONT, Frustum::Plane{mEye, -mEye.dot(nearCenter)});
+  mFrustum.setPlane(Frustum::BACK, Frustum::Plane{-mEye, mEye.dot(farCenter)});
 }
 
 bool Camera::sphereInFrustum(const Point3f &center, float radius)
@@ -145,20 +154,7 @@ bool Camera::pointInFrustum(const Point3f &p, const Camera::Plane &plane)
 
 bool Camera::cubeInFrustum(const Point3f &pos, const Vector3f &size)
 {
-  const Point3f maxP = pos + size;
-  for(int i = 0; i < 4; i++) // don't need to check near/far planes
-    { // check if all corners are outside plane
-      if(!pointInFrustum(pos, mPlanes[i]) &&
-         !pointInFrustum({maxP[0], pos[1], pos[2]}, mPlanes[i]) &&
-         !pointInFrustum({pos[0], maxP[1], pos[2]}, mPlanes[i]) &&
-         !pointInFrustum({maxP[0], maxP[1], pos[2]}, mPlanes[i]) &&
-         !pointInFrustum({pos[0], pos[1], maxP[2]}, mPlanes[i]) &&
-         !pointInFrustum({maxP[0], pos[1], maxP[2]}, mPlanes[i]) &&
-         !pointInFrustum({pos[0], maxP[1], maxP[2]}, mPlanes[i]) &&
-         !pointInFrustum(maxP, mPlanes[i]) )
-        { return false; }
-    }
-  return true;
+  return mFrustum.boxInside(pos, pos + size);
 }
 
 void Camera::makePlaneMesh(int planeIndex, const Vector3f &color, MeshData &mesh)
@@ -0,0 +1,230 @@
+#include "frustum.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_X86
+#include <immintrin.h>
+#endif
+
+// NOTE: The SIMD paths do the same operations in the same order as the scalar path
+//       (no fused multiply-add), so every path gives the same mask.
+
+Frustum::simd_t Frustum::supported()
+{
+#ifdef FRUSTUM_X86
+  static const simd_t simd = (__builtin_cpu_supports("avx") ? simd_t::AVX :
+                              (__builtin_cpu_supports("sse") ? simd_t::SSE : simd_t::SCALAR));
+  return simd;
+#else
+  return simd_t::SCALAR;
+#endif
+}
+
+const char* Frustum::toString(simd_t simd)
+{
+  switch(simd)
+    {
+    case simd_t::SCALAR: return "scalar";
+    case simd_t::SSE:    return "SSE";
+    case simd_t::AVX:    return "AVX";
+    }
+  return "";
+}
+
+
+void Frustum::BoxList::clear()
+{
+  minX.clear();
+  minY.clear();
+  minZ.clear();
+  maxX.clear();
+  maxY.clear();
+  maxZ.clear();
+}
+
+void Frustum::BoxList::reserve(int n)
+{
+  minX.reserve(n);
+  minY.reserve(n);
+  minZ.reserve(n);
+  maxX.reserve(n);
+  maxY.reserve(n);
+  maxZ.reserve(n);
+}
+
+void Frustum::BoxList::add(const Point3f &minP, const Point3f &maxP)
+{
+  minX.push_back(minP[0]);
+  minY.push_back(minP[1]);
+  minZ.push_back(minP[2]);
+  maxX.push_back(maxP[0]);
+  maxY.push_back(maxP[1]);
+  maxZ.push_back(maxP[2]);
+}
+
+
+Frustum::Frustum()
+{
+  // (everything inside until planes are set)
+  for(int i = 0; i < NUM_PLANES; i++)
+    { mPlanes[i] = Plane{Vector3f{0.0f, 0.0f, 0.0f}, 1.0f}; }
+  setSimd(simd_t::AVX);
+}
+
+void Frustum::setPlane(planeIndex_t index, const Plane &plane)
+{
+  mPlanes[index] = plane;
+}
+
+void Frustum::setSimd(simd_t simd)
+{
+  mSimd = std::min(simd, supported());
+}
+
+bool Frustum::pointInside(const Point3f &p) const
+{
+  for(int i = 0; i < NUM_PLANES; i++)
+    {
+      const Plane &pl = mPlanes[i];
+      if(pl.normal[0]*p[0] + pl.normal[1]*p[1] + pl.normal[2]*p[2] + pl.d < 0.0f)
+        { return false; }
+    }
+  return true;
+}
+
+bool Frustum::boxInside(const Point3f &minP, const Point3f &maxP) const
+{
+  for(int i = 0; i < NUM_PLANES; i++)
+    {
+      const Plane &pl = mPlanes[i];
+      const Point3f pv{(pl.normal[0] >= 0.0f ? maxP[0] : minP[0]),
+                       (pl.normal[1] >= 0.0f ? maxP[1] : minP[1]),
+                       (pl.normal[2] >= 0.0f ? maxP[2] : minP[2]) };
+      if(pl.normal[0]*pv[0] + pl.normal[1]*pv[1] + pl.normal[2]*pv[2] + pl.d < 0.0f)
+        { return false; }
+    }
+  return true;
+}
+
+void Frustum::selectVertices(const float *const minP[3], const float *const maxP[3],
+                             PlaneArrays arrays[NUM_PLANES] ) const
+{
+  for(int i = 0; i < NUM_PLANES; i++)
+    for(int a = 0; a < 3; a++)
+      { arrays[i].p[a] = (mPlanes[i].normal[a] >= 0.0f ? maxP[a] : minP[a]); }
+}
+
+void Frustum::cull(const float *minX, const float *minY, const float *minZ,
+                   const float *maxX, const float *maxY, const float *maxZ,
+                   int n, uint64_t *maskOut ) const
+{
+  const float *const minP[3] = {minX, minY, minZ};
+  const float *const maxP[3] = {maxX, maxY, maxZ};
+  PlaneArrays arrays[NUM_PLANES];
+  selectVertices(minP, maxP, arrays);
+
+  for(int w = 0; w < (n + 63) / 64; w++)
+    { maskOut[w] = 0; }
+  int done = 0;
+#ifdef FRUSTUM_X86
+  if(mSimd == simd_t::AVX)
+    { done = cullAVX(arrays, n, maskOut); }
+  else if(mSimd == simd_t::SSE)
+    { done = cullSSE(arrays, n, maskOut); }
+#endif
+  cullScalar(arrays, done, n, maskOut);
+}
+
+void Frustum::cull(const BoxList &boxes, std::vector<uint64_t> &maskOut) const
+{
+  maskOut.resize((boxes.size() + 63) / 64);
+  cull(boxes.minX.data(), boxes.minY.data(), boxes.minZ.data(),
+       boxes.maxX.data(), boxes.maxY.data(), boxes.maxZ.data(), boxes.size(), maskOut.data());
+}
+
+void Frustum::cullScalar(const PlaneArrays arrays[NUM_PLANES], int start, int end,
+                         uint64_t *maskOut ) const
+{
+  for(int i = start; i < end; i++)
+    {
+      bool inside = true;
+      for(int j = 0; j < NUM_PLANES && inside; j++)
+        {
+          const Vector3f &n = mPlanes[j].normal;
+          const float dist = n[0]*arrays[j].p[0][i] + n[1]*arrays[j].p[1][i] + n[2]*arrays[j].p[2][i];
+          inside = (dist + mPlanes[j].d >= 0.0f);
+        }
+      maskOut[i / 64] |= (uint64_t)inside << (i % 64);
+    }
+}
+
+
+#ifdef FRUSTUM_X86
+
+__attribute__((target("sse")))
+int Frustum::cullSSE(const PlaneArrays arrays[NUM_PLANES], int n, uint64_t *maskOut) const
+{
+  __m128 nx[NUM_PLANES], ny[NUM_PLANES], nz[NUM_PLANES], d[NUM_PLANES];
+  for(int j = 0; j < NUM_PLANES; j++)
+    {
+      nx[j] = _mm_set1_ps(mPlanes[j].normal[0]);
+      ny[j] = _mm_set1_ps(mPlanes[j].normal[1]);
+      nz[j] = _mm_set1_ps(mPlanes[j].normal[2]);
+      d[j]  = _mm_set1_ps(mPlanes[j].d);
+    }
+  const __m128 zero = _mm_setzero_ps();
+
+  int i = 0;
+  for(; i + 4 <= n; i += 4)
+    {
+      __m128 inside = _mm_cmpeq_ps(zero, zero); // (all set)
+      for(int j = 0; j < NUM_PLANES; j++)
+        {
+          __m128 dist = _mm_add_ps(_mm_mul_ps(nx[j], _mm_loadu_ps(arrays[j].p[0] + i)),
+                                   _mm_mul_ps(ny[j], _mm_loadu_ps(arrays[j].p[1] + i)) );
+          dist = _mm_add_ps(dist, _mm_mul_ps(nz[j], _mm_loadu_ps(arrays[j].p[2] + i)));
+          inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, d[j]), zero));
+        }
+      maskOut[i / 64] |= (uint64_t)_mm_movemask_ps(inside) << (i % 64);
+    }
+  return i;
+}
+
+__attribute__((target("avx")))
+int Frustum::cullAVX(const PlaneArrays arrays[NUM_PLANES], int n, uint64_t *maskOut) const
+{
+  __m256 nx[NUM_PLANES], ny[NUM_PLANES], nz[NUM_PLANES], d[NUM_PLANES];
+  for(int j = 0; j < NUM_PLANES; j++)
+    {
+      nx[j] = _mm256_set1_ps(mPlanes[j].normal[0]);
+      ny[j] = _mm256_set1_ps(mPlanes[j].normal[1]);
+      nz[j] = _mm256_set1_ps(mPlanes[j].normal[2]);
+      d[j]  = _mm256_set1_ps(mPlanes[j].d);
+    }
+  const __m256 zero = _mm256_setzero_ps();
+
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+    {
+      __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ); // (all set)
+      for(int j = 0; j < NUM_PLANES; j++)
+        {
+          __m256 dist = _mm256_add_ps(_mm256_mul_ps(nx[j], _mm256_loadu_ps(arrays[j].p[0] + i)),
+                                      _mm256_mul_ps(ny[j], _mm256_loadu_ps(arrays[j].p[1] + i)) );
+          dist = _mm256_add_ps(dist, _mm256_mul_ps(nz[j], _mm256_loadu_ps(arrays[j].p[2] + i)));
+          inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, d[j]), zero, _CMP_GE_OQ));
+        }
+      maskOut[i / 64] |= (uint64_t)_mm256_movemask_ps(inside) << (i % 64);
+    }
+  return i;
+}
+
+#else
+
+int Frustum::cullSSE(const PlaneArrays arrays[NUM_PLANES], int n, uint64_t *maskOut) const
+{ return 0; }
+int Frustum::cullAVX(const PlaneArrays arrays[NUM_PLANES], int n, uint64_t *maskOut) const
+{ return 0; }
+
+#endif // FRUSTUM_X86
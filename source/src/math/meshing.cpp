@@ -2,162 +2,317 @@
 #include "world.hpp"
 #include "chunk.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 ChunkBounds::ChunkBounds()
 {
 
 }
-ChunkBounds::ChunkBounds(Chunk *chunk)
+ChunkBounds::ChunkBounds(const PaddedChunk &padded)
 {
-  calcBounds(chunk);
+  calcBounds(padded);
 }
 ChunkBounds::~ChunkBounds()
 {
 
 }
 
-block_t ChunkBounds::getBlock(Chunk *chunk, const Point3i &wp, blockSide_t side)
+std::vector<ActiveBlock>& ChunkBounds::getFaces()
 {
-  Chunk *n = chunk->getNeighbor(side);
-  if(n)
-    { return n->getType(Chunk::blockPos(wp)); }
-  else
-    { return block_t::NONE; }
+  return mFaces;
+}
+
+void ChunkBounds::setFaces(const std::vector<ActiveBlock> &faces)
+{
+  lock();
+  mFaces = faces;
+  mNumFaces = 0;
+  for(auto &block : mFaces)
+    { mNumFaces += __builtin_popcount((unsigned int)block.sides); }
+  unlock();
 }
 
-std::unordered_map<hash_t, ActiveBlock>& ChunkBounds::getBounds()
+Point3i ChunkBounds::blockPos(const ActiveBlock &block)
 {
-  return mBounds;
+  return Point3i{ block.index & Chunk::maskX,
+                  block.index >> (Chunk::shiftX + Chunk::shiftZ),
+                  (block.index >> Chunk::shiftX) & Chunk::maskZ };
 }
 
-ActiveBlock* ChunkBounds::getBlock(hash_t hash)
+const ActiveBlock* ChunkBounds::find(const std::vector<ActiveBlock> &faces, const Point3i &bp)
 {
-  auto iter = mBounds.find(hash);
-  if(iter == mBounds.end())
+  if(bp[0] < 0 || bp[0] >= Chunk::sizeX ||
+     bp[1] < 0 || bp[1] >= Chunk::sizeY ||
+     bp[2] < 0 || bp[2] >= Chunk::sizeZ )
+    { return nullptr; }
+  const int bi = bp[0] + Chunk::sizeX*(bp[2] + Chunk::sizeZ*bp[1]);
+  auto iter = std::lower_bound(faces.begin(), faces.end(), bi,
+                               [](const ActiveBlock &b, int i) { return b.index < i; } );
+  if(iter == faces.end() || iter->index != bi)
     { return nullptr; }
   else
-    { return &iter->second; }
+    { return &(*iter); }
+}
+
+ActiveBlock* ChunkBounds::getBlock(const Point3i &bp)
+{
+  return const_cast<ActiveBlock*>(find(mFaces, bp));
 }
  
 static const std::array<blockSide_t, 6> sides {{ blockSide_t::PX, blockSide_t::PY,
                                                     blockSide_t::PZ, blockSide_t::NX,
                                                     blockSide_t::NY, blockSide_t::NZ }};
-static const std::array<Point3i, 6> sideDirections {{ Point3i{1,0,0}, Point3i{0,1,0},
-                                                      Point3i{0,0,1}, Point3i{-1,0,0},
-                                                      Point3i{0,-1,0}, Point3i{0,0,-1} }}; 
-bool ChunkBounds::calcBounds(Chunk *chunk)
+
+static_assert(PaddedChunk::size == Chunk::sizeX + 2 &&
+              PaddedChunk::size == Chunk::sizeY + 2 &&
+              PaddedChunk::size == Chunk::sizeZ + 2, "PaddedChunk size doesn't match Chunk size");
+
+void PaddedChunk::capture(Chunk *chunk, const chunkLookup_t &getChunk)
 {
-  lock();
-  mBounds.clear();
-  if(chunk->isEmpty())
-    { return false; }
-  
-  // iterate over the chunk's blocks and compile all active faces.
-  Point3i bp;
-  Point3i cPos = chunk->pos();
-  const Point3i minP{cPos[0]*Chunk::sizeX,
-                     cPos[1]*Chunk::sizeY,
-                     cPos[2]*Chunk::sizeZ };
-  const Point3i maxP = minP + Chunk::size;
-  int bi = 0;
-  for(bp[1] = 0; bp[1] < Chunk::size[1]; bp[1]++)
-    for(bp[2] = 0; bp[2] < Chunk::size[2]; bp[2]++)
-      for(bp[0] = 0; bp[0] < Chunk::size[0]; bp[0]++, bi++)
-	{
-          block_t bt = *chunk->at(bi);
-          if(isSimpleBlock(bt))// != block_t::NONE)
-            { // block is not empty
-              blockSide_t activeSides = blockSide_t::NONE;
-              bool blockActive = false;
-              Point3i p = minP + bp;
-              for(int i = 0; i < 6; i++)
-                {
-                  Point3i np = bp + sideDirections[i];
-                  if(!isSimpleBlock(((Chunk::chunkEdge(bp) & sides[i]) != blockSide_t::NONE) ?
-                                    getBlock(chunk, np, sides[i]) : chunk->getType(np)))
-                    { // block on side i is empty (face is active)
-                      blockActive = true;
-                      activeSides |= sides[i];
-                      mNumFaces++;
-                    }
-                }
-              
-              if(blockActive)
-                { mBounds.emplace(Hash::hash(bp), ActiveBlock{bt, activeSides}); }
-            }
+  const Point3i cp = chunk->pos();
+  // padded range and source range along each dimension for neighbor offset -1, 0, 1
+  const int padStart[3] = { -1, 0, Chunk::sizeX };
+  const int srcStart[3] = { Chunk::sizeX-1, 0, 0 };
+  const int length[3]   = { 1, Chunk::sizeX, 1 };
+  for(int dy = -1; dy <= 1; dy++)
+    for(int dz = -1; dz <= 1; dz++)
+      for(int dx = -1; dx <= 1; dx++)
+        {
+          Chunk *src = ((dx == 0 && dy == 0 && dz == 0) ? chunk : getChunk(cp + Point3i{dx, dy, dz}));
+          const block_t *srcData = (src ? src->blocks() : nullptr);
+          // (missing neighbors are empty, uniform chunks have no data)
+          const block_t fillType = ((src && !srcData) ? src->uniformType() : block_t::NONE);
+          for(int y = 0; y < length[dy+1]; y++)
+            for(int z = 0; z < length[dz+1]; z++)
+              {
+                block_t *dst = &mBlocks[index(padStart[dx+1], padStart[dy+1] + y, padStart[dz+1] + z)];
+                if(srcData)
+                  {
+                    std::memcpy(dst, &srcData[srcStart[dx+1] + Chunk::sizeX*((srcStart[dz+1] + z) +
+                                                                            Chunk::sizeZ*(srcStart[dy+1] + y))],
+                                length[dx+1]*sizeof(block_t) );
+                  }
+                else
+                  { std::fill(dst, dst + length[dx+1], fillType); }
+              }
         }
+}
 
-  unlock();
-  return mBounds.size() > 0;
+uint64_t PaddedChunk::contentHash() const
+{ // (multiply-rotate over 8 blocks at a time)
+  static_assert(totalSize*sizeof(block_t) % sizeof(uint64_t) == 0, "PaddedChunk size not a multiple of 8 bytes");
+  const char *bytes = reinterpret_cast<const char*>(mBlocks.data());
+  uint64_t h = 0x9E3779B97F4A7C15ULL;
+  for(int i = 0; i < totalSize*(int)sizeof(block_t); i += sizeof(uint64_t))
+    {
+      uint64_t w;
+      std::memcpy(&w, bytes + i, sizeof(w));
+      h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+      h ^= h >> 32;
+    }
+  return h;
 }
 
-bool lessThan(const ActiveRect &r1, const ActiveRect &r2)
+void PaddedChunk::downsample(int scale)
 {
-  if(r1.pos[1] != r2.pos[1]) return r1.pos[1] < r2.pos[1];
-  if(r1.pos[0] != r2.pos[0]) return r1.pos[0] < r2.pos[0];
-  if(r1.size[0] != r2.size[0]) return r1.size[0] > r2.size[0];
-  return r1.size[1] >= r2.size[1];
+  // solid count and highest solid type of each cell (z is up -- keeps surface types on top)
+  const int shift = __builtin_ctz(scale); // (scale is a power of 2)
+  const int cells = Chunk::sizeX >> shift;
+  static thread_local std::vector<int> counts;
+  static thread_local std::vector<block_t> types;
+  counts.assign(cells*cells*cells, 0);
+  types.assign(cells*cells*cells, block_t::NONE);
+  for(int z = 0; z < Chunk::sizeZ; z++)
+    for(int y = 0; y < Chunk::sizeY; y++)
+      {
+        const block_t *row = &mBlocks[index(0, y, z)];
+        const int c = cells*((z >> shift) + cells*(y >> shift));
+        for(int x = 0; x < Chunk::sizeX; x++)
+          {
+            if(isSimpleBlock(row[x]))
+              {
+                counts[c + (x >> shift)]++;
+                types[c + (x >> shift)] = row[x];
+              }
+          }
+      }
+  // (cells at least half solid are filled)
+  const int half = scale*scale*scale / 2;
+  for(int c = 0; c < cells*cells*cells; c++)
+    {
+      if(counts[c] < half)
+        { types[c] = block_t::NONE; }
+    }
+  // (cells packed at the low corner -- everything else is empty, including the border)
+  std::fill(mBlocks.begin(), mBlocks.end(), block_t::NONE);
+  for(int y = 0; y < cells; y++)
+    for(int z = 0; z < cells; z++)
+      { std::copy_n(&types[cells*(z + cells*y)], cells, &mBlocks[index(0, y, z)]); }
 }
 
-ActiveRect blockToRect(block_t type, const Point3i &bp, blockSide_t side)
+// bit x+1 set if block x in the row is solid (bits 0 and 33 are the neighbors' border blocks)
+static inline uint64_t occupancy(const block_t *row)
 {
-  switch(side)
-    {
-    case blockSide_t::PX:
-      return {type, Point2i{bp[1], bp[2]}, Vector2i{1, 1}};
-    case blockSide_t::PY:
-      return {type, Point2i{bp[0], bp[2]}, Vector2i{1, 1}};
-    case blockSide_t::PZ:
-      return {type, Point2i{bp[0], bp[1]}, Vector2i{1, 1}};
-    case blockSide_t::NX:
-      return {type, Point2i{bp[1], bp[2]}, Vector2i{1, 1}};
-    case blockSide_t::NY:
-      return {type, Point2i{bp[0], bp[2]}, Vector2i{1, 1}};
-    case blockSide_t::NZ:
-      return {type, Point2i{bp[0], bp[1]}, Vector2i{1, 1}};
-    };
-}
-
-void ChunkBounds::simplifyGreedy()
+  uint64_t bits = 0;
+  for(int x = 0; x < PaddedChunk::size; x++)
+    { bits |= (uint64_t)isSimpleBlock(row[x]) << x; }
+  return bits;
+}
+
+bool ChunkBounds::calcBounds(const PaddedChunk &padded)
 {
-  std::array<std::unordered_map<block_t, std::vector<ActiveRect>>, 6> sideRects;
+  lock();
+  mFaces.clear();
+  mNumFaces = 0;
+
+  // occupancy rows, including the border
+  static thread_local std::array<std::array<uint64_t, PaddedChunk::size>, PaddedChunk::size> rows;
+  for(int y = -1; y <= Chunk::sizeY; y++)
+    for(int z = -1; z <= Chunk::sizeZ; z++)
+      { rows[y+1][z+1] = occupancy(&padded.data()[PaddedChunk::index(-1, y, z)]); }
 
-  for(int s = 0; s < 6; s++)
+  // a face is active where a solid block's neighbor in that direction is not solid
+  //  (emitted in index order -- mFaces stays sorted)
+  const uint64_t inner = ((1ULL << Chunk::sizeX) - 1) << 1;
+  for(int y = 0; y < Chunk::sizeY; y++)
+    for(int z = 0; z < Chunk::sizeZ; z++)
+      {
+        const uint64_t row = rows[y+1][z+1] & inner;
+        if(!row)
+          { continue; }
+        const uint64_t full = rows[y+1][z+1];
+        const uint64_t px = row & ~(full >> 1);
+        const uint64_t nx = row & ~(full << 1);
+        const uint64_t py = row & ~rows[y+2][z+1];
+        const uint64_t ny = row & ~rows[y][z+1];
+        const uint64_t pz = row & ~rows[y+1][z+2];
+        const uint64_t nz = row & ~rows[y+1][z];
+        mNumFaces += (__builtin_popcountll(px) + __builtin_popcountll(py) + __builtin_popcountll(pz) +
+                      __builtin_popcountll(nx) + __builtin_popcountll(ny) + __builtin_popcountll(nz) );
+        
+        const int bi = Chunk::sizeX*(z + Chunk::sizeZ*y);
+        for(uint64_t active = (px | py | pz | nx | ny | nz); active; active &= active - 1)
+          {
+            const int b = __builtin_ctzll(active);
+            // (bit order matches blockSide_t -- PX, PY, PZ, NX, NY, NZ)
+            const uint8_t activeSides = (((px >> b) & 1)      | (((py >> b) & 1) << 1) |
+                                         (((pz >> b) & 1) << 2) | (((nx >> b) & 1) << 3) |
+                                         (((ny >> b) & 1) << 4) | (((nz >> b) & 1) << 5) );
+            mFaces.push_back(ActiveBlock{padded.get(b-1, y, z), (blockSide_t)activeSides,
+                                         (uint16_t)(bi + b-1) });
+          }
+      }
+
+  unlock();
+  return mFaces.size() > 0;
+}
+
+void ChunkBounds::rectDims(blockSide_t side, int &normalDim, int &dim0, int &dim1)
+{
+  normalDim = sideDim(side);
+  dim0 = (normalDim == 0 ? 1 : 0);
+  dim1 = (normalDim == 2 ? 1 : 2);
+}
+
+// (mask values -- 0 means no face)
+static inline uint32_t faceMask(block_t type, uint32_t key)
+{ return (key << 8) | (uint32_t)type; }
+
+static_assert(ChunkBounds::sectionHeight*ChunkBounds::numSections == Chunk::sizeY,
+              "Chunk sections don't cover chunk");
+
+void ChunkBounds::sectionFaces(int section, int &startOut, int &endOut, int scale)
+{
+  const int sectionSize = Chunk::sizeX*Chunk::sizeZ*(sectionHeight / scale);
+  auto byIndex = [](const ActiveBlock &block, int index) { return block.index < index; };
+  startOut = std::lower_bound(mFaces.begin(), mFaces.end(), section*sectionSize, byIndex) - mFaces.begin();
+  endOut = std::lower_bound(mFaces.begin() + startOut, mFaces.end(), (section+1)*sectionSize,
+                            byIndex ) - mFaces.begin();
+}
+
+std::vector<ActiveRect>& ChunkBounds::simplifyGreedy(const faceKey_t &faceKey, int section, int scale)
+{
+  mSimplified.clear();
+  
+  // one 2D mask per slice along each side's normal
+  //  (every face set is cleared again when merged, so masks are all zero between calls)
+  static thread_local std::array<std::vector<uint32_t>, 6> masks;
+  for(auto &m : masks)
     {
-      for(int i = 1; i < (int)block_t::COUNT; i++)
-        {
-          sideRects[s].emplace((block_t)i, std::vector<ActiveRect>{});
-        }
+      if(m.size() != Chunk::totalSize)
+        { m.assign(Chunk::totalSize, 0); }
     }
-  
-  for(auto iter : mBounds)
+
+  std::array<int, 6> normalDims;
+  std::array<int, 6> dims0;
+  std::array<int, 6> dims1;
+  for(int i = 0; i < 6; i++)
+    { rectDims(sides[i], normalDims[i], dims0[i], dims1[i]); }
+  // block (or cell) range of section
+  Point3i minP{0, section*sectionHeight / scale, 0};
+  Point3i maxP{Chunk::sizeX / scale, (section+1)*sectionHeight / scale, Chunk::sizeZ / scale};
+
+  int start, end;
+  sectionFaces(section, start, end, scale);
+  for(int f = start; f < end; f++)
     {
-      Point3i bp =  Hash::unhash(iter.first);
+      const ActiveBlock &block = mFaces[f];
+      const Point3i bp = blockPos(block);
       for(int i = 0; i < 6; i++)
         {
-          if((bool)(iter.second.sides & sides[i]))
+          if((bool)(block.sides & sides[i]))
             {
-              sideRects[i][iter.second.block].push_back(blockToRect(iter.second.block, bp, sides[i]));
+              const int w = Chunk::size[dims0[i]];
+              const int h = Chunk::size[dims1[i]];
+              masks[i][bp[dims0[i]] + w*(bp[dims1[i]] + h*bp[normalDims[i]])] =
+                faceMask(block.block, faceKey(bp, sides[i]));
             }
         }
     }
   
-  // combine active rectangles
+  // combine active faces
   for(int i = 0; i < 6; i++)
     {
-      for(auto &iter : sideRects[i])
+      const int w = Chunk::size[dims0[i]];
+      const int h = Chunk::size[dims1[i]];
+      const int maxX = maxP[dims0[i]];
+      const int maxY = maxP[dims1[i]];
+      for(int d = minP[normalDims[i]]; d < maxP[normalDims[i]]; d++)
         {
-          std::vector<ActiveRect> &rects = iter.second;
-          std::sort(rects.begin(),rects.end(),
-                    [=](const ActiveRect &r1, const ActiveRect &r2)
-                    { return lessThan(r1, r2); });
-          /*
-          int ri = 0;
-          while(ri < rects.size())
-            {
-              
-            }
-          */
+          uint32_t *mask = &masks[i][w*h*d];
+          for(int y = minP[dims1[i]]; y < maxY; y++)
+            for(int x = minP[dims0[i]]; x < maxX; )
+              {
+                const uint32_t m = mask[x + w*y];
+                if(!m)
+                  {
+                    x++;
+                    continue;
+                  }
+                // extend along dim0, then along dim1 while the whole row matches
+                int rw = 1;
+                while(x + rw < maxX && mask[x + rw + w*y] == m)
+                  { rw++; }
+                int rh = 1;
+                for(; y + rh < maxY; rh++)
+                  {
+                    bool match = true;
+                    for(int rx = 0; rx < rw && match; rx++)
+                      { match = (mask[x + rx + w*(y + rh)] == m); }
+                    if(!match)
+                      { break; }
+                  }
+                for(int ry = 0; ry < rh; ry++)
+                  {
+                    for(int rx = 0; rx < rw; rx++)
+                      { mask[x + rx + w*(y + ry)] = 0; }
+                  }
+                mSimplified.push_back(ActiveRect{(block_t)(m & 0xFF), Point2i{x, y}, Point2i{rw, rh},
+                                                 sides[i], d, (m >> 8) });
+                x += rw;
+              }
         }
     }
-  
+  return mSimplified;
 }
@@ -0,0 +1,256 @@
+#include "occlusionBuffer.hpp"
+
+#include "camera.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OCCLUSION_X86
+#include <immintrin.h>
+#endif
+
+static const float gFarDepth = std::numeric_limits<float>::infinity();
+
+// pixel containing screen coordinate v, within [-1, size] (far off screen points can overflow int)
+static inline int pixel(float v, int size)
+{ return (int)std::floor(std::min(std::max(v, -1.0f), (float)size)); }
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+  : mWidth((width + 3) & ~3), mHeight(height)
+{
+  // pyramid down to 1x1 (each level halves, rounding up)
+  int w = mWidth;
+  int h = mHeight;
+  while(true)
+    {
+      mLevels.push_back(Level{w, h, std::vector<float>(w*h, gFarDepth)});
+      if(w == 1 && h == 1)
+        { break; }
+      w = (w + 1) / 2;
+      h = (h + 1) / 2;
+    }
+#ifdef OCCLUSION_X86
+  mSSE = __builtin_cpu_supports("sse2");
+#endif
+}
+
+void OcclusionBuffer::begin(const Camera &cam)
+{
+  std::fill(mLevels[0].depth.begin(), mLevels[0].depth.end(), gFarDepth);
+  mNumOccluders = 0;
+
+  mPos = cam.getPos();
+  mEye = cam.getEye();
+  mRight = cam.getRight();
+  mUp = cam.getUp();
+  mNearZ = cam.getNearZ();
+  mScaleX = 0.5f*mWidth / std::tan(cam.getFovX() / 2.0f);
+  mScaleY = 0.5f*mHeight / std::tan(cam.getFovY() / 2.0f);
+}
+
+Point3f OcclusionBuffer::project(const Point3f &p) const
+{
+  const Vector3f d = p - mPos;
+  const float z = d.dot(mEye);
+  return Point3f{0.5f*mWidth + mScaleX*d.dot(mRight)/z,
+                 0.5f*mHeight + mScaleY*d.dot(mUp)/z,
+                 z };
+}
+
+void OcclusionBuffer::addOccluder(const Point3f corners[4])
+{
+  Point3f sp[4];
+  float depth = 0.0f;
+  for(int i = 0; i < 4; i++)
+    {
+      sp[i] = project(corners[i]);
+      if(sp[i][2] < mNearZ)
+        { return; } // (would need clipping)
+      depth = std::max(depth, sp[i][2]);
+    }
+  
+  // edge functions (a*x + b*y + c >= 0 inside -- projected quad is convex)
+  float a[4];
+  float b[4];
+  float c[4];
+  float area = 0.0f;
+  for(int i = 0; i < 4; i++)
+    {
+      const Point3f &p0 = sp[i];
+      const Point3f &p1 = sp[(i+1) % 4];
+      a[i] = p0[1] - p1[1];
+      b[i] = p1[0] - p0[0];
+      c[i] = p0[0]*p1[1] - p0[1]*p1[0];
+      area += c[i];
+    }
+  if(std::abs(area) < 0.001f)
+    { return; } // (edge-on)
+  else if(area < 0.0f)
+    { // (wound the other way)
+      for(int i = 0; i < 4; i++)
+        {
+          a[i] = -a[i];
+          b[i] = -b[i];
+          c[i] = -c[i];
+        }
+    }
+
+  // rows with pixel centers inside the quad
+  float minY = sp[0][1];
+  float maxY = sp[0][1];
+  for(int i = 1; i < 4; i++)
+    {
+      minY = std::min(minY, sp[i][1]);
+      maxY = std::max(maxY, sp[i][1]);
+    }
+  const int y0 = std::max(0, pixel(minY, mHeight));
+  const int y1 = std::min(mHeight - 1, pixel(maxY, mHeight));
+  
+  float *depthBuffer = mLevels[0].depth.data();
+  for(int y = y0; y <= y1; y++)
+    {
+      // span of x inside every edge
+      const float py = y + 0.5f;
+      float xl = -1.0f;
+      float xr = (float)mWidth;
+      for(int i = 0; i < 4; i++)
+        {
+          const float e = b[i]*py + c[i];
+          if(a[i] > 0.0f)
+            { xl = std::max(xl, -e / a[i]); }
+          else if(a[i] < 0.0f)
+            { xr = std::min(xr, -e / a[i]); }
+          else if(e < 0.0f)
+            { xr = -1.0f; } // (row outside edge)
+        }
+      // (pixels with centers in [xl, xr])
+      const int x0 = std::max(0, pixel(xl - 0.5f, mWidth) + 1);
+      const int x1 = std::min(mWidth - 1, pixel(xr - 0.5f, mWidth));
+      if(x0 <= x1)
+        {
+          if(mSSE)
+            { drawSpanSSE(&depthBuffer[y*mWidth], x0, x1, depth); }
+          else
+            { drawSpanScalar(&depthBuffer[y*mWidth], x0, x1, depth); }
+        }
+    }
+  mNumOccluders++;
+}
+
+void OcclusionBuffer::drawSpanScalar(float *row, int x0, int x1, float depth)
+{
+  for(int x = x0; x <= x1; x++)
+    { row[x] = std::min(row[x], depth); }
+}
+
+#ifdef OCCLUSION_X86
+__attribute__((target("sse2")))
+void OcclusionBuffer::drawSpanSSE(float *row, int x0, int x1, float depth)
+{
+  const __m128 d = _mm_set1_ps(depth);
+  const __m128 farDepth = _mm_set1_ps(gFarDepth);
+  const __m128i lane = _mm_set_epi32(3, 2, 1, 0);
+  const __m128i first = _mm_set1_epi32(x0 - 1);
+  const __m128i last = _mm_set1_epi32(x1 + 1);
+  // (4 pixels at a time from x0 rounded down -- rows are a multiple of 4 wide)
+  for(int x = (x0 & ~3); x <= x1; x += 4)
+    {
+      const __m128i px = _mm_add_epi32(_mm_set1_epi32(x), lane);
+      const __m128 inside = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(px, first),
+                                                           _mm_cmplt_epi32(px, last) ));
+      const __m128 src = _mm_or_ps(_mm_and_ps(inside, d), _mm_andnot_ps(inside, farDepth));
+      _mm_storeu_ps(row + x, _mm_min_ps(_mm_loadu_ps(row + x), src));
+    }
+}
+#else
+void OcclusionBuffer::drawSpanSSE(float *row, int x0, int x1, float depth)
+{ drawSpanScalar(row, x0, x1, depth); }
+#endif // OCCLUSION_X86
+
+void OcclusionBuffer::finish()
+{
+  for(int l = 1; l < (int)mLevels.size(); l++)
+    {
+      const Level &src = mLevels[l-1];
+      Level &dst = mLevels[l];
+      for(int y = 0; y < dst.height; y++)
+        for(int x = 0; x < dst.width; x++)
+          {
+            // (edge texels of odd sized levels only cover one column/row)
+            const int sx0 = 2*x;
+            const int sy0 = 2*y;
+            const int sx1 = std::min(sx0 + 1, src.width - 1);
+            const int sy1 = std::min(sy0 + 1, src.height - 1);
+            dst.depth[x + y*dst.width] = std::max(std::max(src.depth[sx0 + sy0*src.width],
+                                                           src.depth[sx1 + sy0*src.width] ),
+                                                  std::max(src.depth[sx0 + sy1*src.width],
+                                                           src.depth[sx1 + sy1*src.width] ));
+          }
+    }
+}
+
+bool OcclusionBuffer::boxVisible(const Point3f &minP, const Point3f &maxP) const
+{
+  if(mNumOccluders == 0)
+    { return true; }
+
+  // screen bounds and nearest depth of the corners
+  //  (view space coordinates are linear -- corners are the min corner plus size along each axis)
+  const Vector3f d = minP - mPos;
+  const Vector3f size = maxP - minP;
+  const float base[3] = {d.dot(mRight), d.dot(mUp), d.dot(mEye)};
+  float step[3][3]; // (view space offset of size along each world axis)
+  for(int a = 0; a < 3; a++)
+    {
+      step[a][0] = size[a]*mRight[a];
+      step[a][1] = size[a]*mUp[a];
+      step[a][2] = size[a]*mEye[a];
+    }
+  float minX = gFarDepth;
+  float minY = gFarDepth;
+  float maxX = -gFarDepth;
+  float maxY = -gFarDepth;
+  float minZ = gFarDepth;
+  for(int i = 0; i < 8; i++)
+    {
+      float v[3] = {base[0], base[1], base[2]};
+      for(int a = 0; a < 3; a++)
+        {
+          if(i & (1 << a))
+            {
+              v[0] += step[a][0];
+              v[1] += step[a][1];
+              v[2] += step[a][2];
+            }
+        }
+      if(v[2] < mNearZ)
+        { return true; } // (crosses near plane)
+      const float x = 0.5f*mWidth + mScaleX*v[0]/v[2];
+      const float y = 0.5f*mHeight + mScaleY*v[1]/v[2];
+      minX = std::min(minX, x);
+      maxX = std::max(maxX, x);
+      minY = std::min(minY, y);
+      maxY = std::max(maxY, y);
+      minZ = std::min(minZ, v[2]);
+    }
+  // (covering pixels, grown by one for pixels only partly covered by occluders)
+  const int x0 = std::max(0, pixel(minX, mWidth) - 1);
+  const int x1 = std::min(mWidth - 1, pixel(maxX, mWidth) + 1);
+  const int y0 = std::max(0, pixel(minY, mHeight) - 1);
+  const int y1 = std::min(mHeight - 1, pixel(maxY, mHeight) + 1);
+  if(x0 > x1 || y0 > y1)
+    { return true; } // (off screen -- left to frustum culling)
+
+  // smallest level where the bounds span at most 2x2 texels
+  int l = 0;
+  while(l < (int)mLevels.size() - 1 && ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1))
+    { l++; }
+  const Level &level = mLevels[l];
+  float maxDepth = 0.0f;
+  for(int y = (y0 >> l); y <= (y1 >> l); y++)
+    for(int x = (x0 >> l); x <= (x1 >> l); x++)
+      { maxDepth = std::max(maxDepth, level.depth[x + y*level.width]); }
+  return (minZ <= maxDepth);
+}
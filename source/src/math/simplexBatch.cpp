@@ -0,0 +1,355 @@
+#include "simplexBatch.hpp"
+
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLEX_X86
+#include <immintrin.h>
+#endif
+
+// NOTE: Every operation below mirrors FastNoise::SingleSimplex (same order, same float
+//       precision, no fused multiply-add) so results are bit-identical to FastNoise.
+
+static const float F3 = 1 / float(3);
+static const float G3 = 1 / float(6);
+
+static const float GRAD_X[12] = { 1, -1, 1, -1, 1, -1, 1, -1, 0,  0, 0,  0 };
+static const float GRAD_Y[12] = { 1, 1, -1, -1, 0,  0, 0,  0, 1, -1, 1, -1 };
+static const float GRAD_Z[12] = { 0, 0,  0,  0, 1,  1, -1, -1, 1, 1, -1, -1 };
+
+static inline int fastFloor(float f)
+{ return (f >= 0 ? (int)f : (int)f - 1); }
+
+static inline float gradCoord(const int32_t *perm, const int32_t *perm12,
+                              int x, int y, int z, float xd, float yd, float zd)
+{
+  const int lut = perm12[(x & 0xff) + perm[(y & 0xff) + perm[(z & 0xff)]]];
+  return xd*GRAD_X[lut] + yd*GRAD_Y[lut] + zd*GRAD_Z[lut];
+}
+
+static inline float simplex(const int32_t *perm, const int32_t *perm12, float x, float y, float z)
+{
+  float t = (x + y + z) * F3;
+  const int i = fastFloor(x + t);
+  const int j = fastFloor(y + t);
+  const int k = fastFloor(z + t);
+
+  t = (i + j + k) * G3;
+  const float x0 = x - (i - t);
+  const float y0 = y - (j - t);
+  const float z0 = z - (k - t);
+
+  // rank of the offsets determines which simplex the point is in
+  const bool xy = (x0 >= y0);
+  const bool yz = (y0 >= z0);
+  const bool xz = (x0 >= z0);
+  const int i1 = (xy && xz);
+  const int j1 = (!xy && yz);
+  const int k1 = (!xz && !yz);
+  const int i2 = (xy || xz);
+  const int j2 = (!xy || yz);
+  const int k2 = !(xz && yz);
+
+  const float x1 = x0 - i1 + G3;
+  const float y1 = y0 - j1 + G3;
+  const float z1 = z0 - k1 + G3;
+  const float x2 = x0 - i2 + 2*G3;
+  const float y2 = y0 - j2 + 2*G3;
+  const float z2 = z0 - k2 + 2*G3;
+  const float x3 = x0 - 1 + 3*G3;
+  const float y3 = y0 - 1 + 3*G3;
+  const float z3 = z0 - 1 + 3*G3;
+
+  float n0, n1, n2, n3;
+  t = float(0.6) - x0*x0 - y0*y0 - z0*z0;
+  if(t < 0) { n0 = 0; }
+  else      { t *= t; n0 = t*t*gradCoord(perm, perm12, i, j, k, x0, y0, z0); }
+  t = float(0.6) - x1*x1 - y1*y1 - z1*z1;
+  if(t < 0) { n1 = 0; }
+  else      { t *= t; n1 = t*t*gradCoord(perm, perm12, i + i1, j + j1, k + k1, x1, y1, z1); }
+  t = float(0.6) - x2*x2 - y2*y2 - z2*z2;
+  if(t < 0) { n2 = 0; }
+  else      { t *= t; n2 = t*t*gradCoord(perm, perm12, i + i2, j + j2, k + k2, x2, y2, z2); }
+  t = float(0.6) - x3*x3 - y3*y3 - z3*z3;
+  if(t < 0) { n3 = 0; }
+  else      { t *= t; n3 = t*t*gradCoord(perm, perm12, i + 1, j + 1, k + 1, x3, y3, z3); }
+
+  return 32 * (n0 + n1 + n2 + n3);
+}
+
+
+SimplexBatch::simd_t SimplexBatch::supported()
+{
+#ifdef SIMPLEX_X86
+  static const simd_t simd = (__builtin_cpu_supports("avx2") ? simd_t::AVX2 :
+                              (__builtin_cpu_supports("sse2") ? simd_t::SSE2 : simd_t::SCALAR));
+  return simd;
+#else
+  return simd_t::SCALAR;
+#endif
+}
+
+const char* SimplexBatch::toString(simd_t simd)
+{
+  switch(simd)
+    {
+    case simd_t::SCALAR: return "scalar";
+    case simd_t::SSE2:   return "SSE2";
+    case simd_t::AVX2:   return "AVX2";
+    }
+  return "";
+}
+
+SimplexBatch::SimplexBatch(int seed)
+  : mSimd(supported())
+{ setSeed(seed); }
+
+void SimplexBatch::setSeed(int seed)
+{ // (same shuffle as FastNoise::SetSeed)
+  mSeed = seed;
+  std::mt19937_64 gen(seed);
+  for(int i = 0; i < 256; i++)
+    { mPerm[i] = i; }
+  for(int j = 0; j < 256; j++)
+    {
+      const int k = (int)(gen() % (256 - j)) + j;
+      const int l = mPerm[j];
+      mPerm[j] = mPerm[j + 256] = mPerm[k];
+      mPerm[k] = l;
+      mPerm12[j] = mPerm12[j + 256] = mPerm[j] % 12;
+    }
+}
+
+void SimplexBatch::setSimd(simd_t simd)
+{ mSimd = ((int)simd > (int)supported() ? supported() : simd); }
+
+float SimplexBatch::eval(float x, float y, float z) const
+{ return simplex(mPerm, mPerm12, x, y, z); }
+
+void SimplexBatch::eval(const float *x, const float *y, const float *z, float *out, int n) const
+{
+  switch(mSimd)
+    {
+    case simd_t::AVX2: evalAVX2(x, y, z, out, n);   break;
+    case simd_t::SSE2: evalSSE2(x, y, z, out, n);   break;
+    default:           evalScalar(x, y, z, out, n); break;
+    }
+}
+
+void SimplexBatch::evalScalar(const float *x, const float *y, const float *z, float *out, int n) const
+{
+  for(int p = 0; p < n; p++)
+    { out[p] = simplex(mPerm, mPerm12, x[p], y[p], z[p]); }
+}
+
+
+#ifdef SIMPLEX_X86
+
+__attribute__((target("sse2")))
+static inline __m128i floorSSE2(__m128 f)
+{ // (int)f, minus one if f < 0
+  return _mm_add_epi32(_mm_cvttps_epi32(f), _mm_castps_si128(_mm_cmplt_ps(f, _mm_setzero_ps())));
+}
+
+// no gathers in SSE2 -- look up each lane separately
+__attribute__((target("sse2")))
+static inline __m128 gradSSE2(const int32_t *perm, const int32_t *perm12,
+                              __m128i i, __m128i j, __m128i k, __m128 xd, __m128 yd, __m128 zd)
+{
+  alignas(16) int32_t ii[4], jj[4], kk[4];
+  _mm_store_si128((__m128i*)ii, i);
+  _mm_store_si128((__m128i*)jj, j);
+  _mm_store_si128((__m128i*)kk, k);
+  alignas(16) float gx[4], gy[4], gz[4];
+  for(int l = 0; l < 4; l++)
+    {
+      const int lut = perm12[(ii[l] & 0xff) + perm[(jj[l] & 0xff) + perm[(kk[l] & 0xff)]]];
+      gx[l] = GRAD_X[lut];
+      gy[l] = GRAD_Y[lut];
+      gz[l] = GRAD_Z[lut];
+    }
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(xd, _mm_load_ps(gx)), _mm_mul_ps(yd, _mm_load_ps(gy))),
+                    _mm_mul_ps(zd, _mm_load_ps(gz)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 cornerSSE2(const int32_t *perm, const int32_t *perm12,
+                                __m128i i, __m128i j, __m128i k, __m128 x, __m128 y, __m128 z)
+{
+  __m128 t = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.6f), _mm_mul_ps(x, x)),
+                                   _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+  const __m128 inside = _mm_cmpge_ps(t, _mm_setzero_ps());
+  t = _mm_mul_ps(t, t);
+  const __m128 n = _mm_mul_ps(_mm_mul_ps(t, t), gradSSE2(perm, perm12, i, j, k, x, y, z));
+  return _mm_and_ps(inside, n);
+}
+
+__attribute__((target("sse2")))
+void SimplexBatch::evalSSE2(const float *x, const float *y, const float *z, float *out, int n) const
+{
+  const __m128 f3   = _mm_set1_ps(F3);
+  const __m128 g3   = _mm_set1_ps(G3);
+  const __m128 g3_2 = _mm_set1_ps(2*G3);
+  const __m128 g3_3 = _mm_set1_ps(3*G3);
+  const __m128 one  = _mm_set1_ps(1.0f);
+  const __m128i ione = _mm_set1_epi32(1);
+
+  int p = 0;
+  for(; p + 4 <= n; p += 4)
+    {
+      const __m128 xv = _mm_loadu_ps(x + p);
+      const __m128 yv = _mm_loadu_ps(y + p);
+      const __m128 zv = _mm_loadu_ps(z + p);
+
+      __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(xv, yv), zv), f3);
+      const __m128i i = floorSSE2(_mm_add_ps(xv, t));
+      const __m128i j = floorSSE2(_mm_add_ps(yv, t));
+      const __m128i k = floorSSE2(_mm_add_ps(zv, t));
+
+      t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), g3);
+      const __m128 x0 = _mm_sub_ps(xv, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+      const __m128 y0 = _mm_sub_ps(yv, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+      const __m128 z0 = _mm_sub_ps(zv, _mm_sub_ps(_mm_cvtepi32_ps(k), t));
+
+      const __m128 xy = _mm_cmpge_ps(x0, y0);
+      const __m128 yz = _mm_cmpge_ps(y0, z0);
+      const __m128 xz = _mm_cmpge_ps(x0, z0);
+      const __m128 i1 = _mm_and_ps(xy, xz);
+      const __m128 j1 = _mm_andnot_ps(xy, yz);
+      const __m128 k1 = _mm_andnot_ps(_mm_or_ps(xz, yz), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+      const __m128 i2 = _mm_or_ps(xy, xz);
+      const __m128 j2 = _mm_or_ps(_mm_andnot_ps(xy, _mm_castsi128_ps(_mm_set1_epi32(-1))), yz);
+      const __m128 k2 = _mm_andnot_ps(_mm_and_ps(xz, yz), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+      // (masks are all ones where set -- subtracting adds one)
+      const __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i1, one)), g3);
+      const __m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j1, one)), g3);
+      const __m128 z1 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k1, one)), g3);
+      const __m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i2, one)), g3_2);
+      const __m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j2, one)), g3_2);
+      const __m128 z2 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k2, one)), g3_2);
+      const __m128 x3 = _mm_add_ps(_mm_sub_ps(x0, one), g3_3);
+      const __m128 y3 = _mm_add_ps(_mm_sub_ps(y0, one), g3_3);
+      const __m128 z3 = _mm_add_ps(_mm_sub_ps(z0, one), g3_3);
+
+      const __m128 n0 = cornerSSE2(mPerm, mPerm12, i, j, k, x0, y0, z0);
+      const __m128 n1 = cornerSSE2(mPerm, mPerm12,
+                                   _mm_sub_epi32(i, _mm_castps_si128(i1)),
+                                   _mm_sub_epi32(j, _mm_castps_si128(j1)),
+                                   _mm_sub_epi32(k, _mm_castps_si128(k1)), x1, y1, z1);
+      const __m128 n2 = cornerSSE2(mPerm, mPerm12,
+                                   _mm_sub_epi32(i, _mm_castps_si128(i2)),
+                                   _mm_sub_epi32(j, _mm_castps_si128(j2)),
+                                   _mm_sub_epi32(k, _mm_castps_si128(k2)), x2, y2, z2);
+      const __m128 n3 = cornerSSE2(mPerm, mPerm12, _mm_add_epi32(i, ione), _mm_add_epi32(j, ione),
+                                   _mm_add_epi32(k, ione), x3, y3, z3);
+
+      const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(n0, n1), n2), n3);
+      _mm_storeu_ps(out + p, _mm_mul_ps(_mm_set1_ps(32.0f), sum));
+    }
+  for(; p < n; p++)
+    { out[p] = simplex(mPerm, mPerm12, x[p], y[p], z[p]); }
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i floorAVX2(__m256 f)
+{
+  return _mm256_add_epi32(_mm256_cvttps_epi32(f),
+                          _mm256_castps_si256(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_LT_OQ)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 cornerAVX2(const int32_t *perm, const int32_t *perm12,
+                                __m256i i, __m256i j, __m256i k, __m256 x, __m256 y, __m256 z)
+{
+  __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.6f), _mm256_mul_ps(x, x)),
+                                         _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+  const __m256 inside = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ);
+  t = _mm256_mul_ps(t, t);
+
+  const __m256i byte = _mm256_set1_epi32(0xff);
+  __m256i lut = _mm256_i32gather_epi32(perm, _mm256_and_si256(k, byte), 4);
+  lut = _mm256_i32gather_epi32(perm, _mm256_add_epi32(_mm256_and_si256(j, byte), lut), 4);
+  lut = _mm256_i32gather_epi32(perm12, _mm256_add_epi32(_mm256_and_si256(i, byte), lut), 4);
+  const __m256 grad = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_i32gather_ps(GRAD_X, lut, 4)),
+                                                  _mm256_mul_ps(y, _mm256_i32gather_ps(GRAD_Y, lut, 4))),
+                                    _mm256_mul_ps(z, _mm256_i32gather_ps(GRAD_Z, lut, 4)));
+  return _mm256_and_ps(inside, _mm256_mul_ps(_mm256_mul_ps(t, t), grad));
+}
+
+__attribute__((target("avx2")))
+void SimplexBatch::evalAVX2(const float *x, const float *y, const float *z, float *out, int n) const
+{
+  const __m256 f3   = _mm256_set1_ps(F3);
+  const __m256 g3   = _mm256_set1_ps(G3);
+  const __m256 g3_2 = _mm256_set1_ps(2*G3);
+  const __m256 g3_3 = _mm256_set1_ps(3*G3);
+  const __m256 one  = _mm256_set1_ps(1.0f);
+  const __m256 ones = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  const __m256i ione = _mm256_set1_epi32(1);
+
+  int p = 0;
+  for(; p + 8 <= n; p += 8)
+    {
+      const __m256 xv = _mm256_loadu_ps(x + p);
+      const __m256 yv = _mm256_loadu_ps(y + p);
+      const __m256 zv = _mm256_loadu_ps(z + p);
+
+      __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(xv, yv), zv), f3);
+      const __m256i i = floorAVX2(_mm256_add_ps(xv, t));
+      const __m256i j = floorAVX2(_mm256_add_ps(yv, t));
+      const __m256i k = floorAVX2(_mm256_add_ps(zv, t));
+
+      t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)), g3);
+      const __m256 x0 = _mm256_sub_ps(xv, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+      const __m256 y0 = _mm256_sub_ps(yv, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+      const __m256 z0 = _mm256_sub_ps(zv, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+
+      const __m256 xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+      const __m256 yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+      const __m256 xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+      const __m256 i1 = _mm256_and_ps(xy, xz);
+      const __m256 j1 = _mm256_andnot_ps(xy, yz);
+      const __m256 k1 = _mm256_andnot_ps(_mm256_or_ps(xz, yz), ones);
+      const __m256 i2 = _mm256_or_ps(xy, xz);
+      const __m256 j2 = _mm256_or_ps(_mm256_andnot_ps(xy, ones), yz);
+      const __m256 k2 = _mm256_andnot_ps(_mm256_and_ps(xz, yz), ones);
+
+      const __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(i1, one)), g3);
+      const __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_and_ps(j1, one)), g3);
+      const __m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_and_ps(k1, one)), g3);
+      const __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(i2, one)), g3_2);
+      const __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_and_ps(j2, one)), g3_2);
+      const __m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_and_ps(k2, one)), g3_2);
+      const __m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, one), g3_3);
+      const __m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, one), g3_3);
+      const __m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, one), g3_3);
+
+      const __m256 n0 = cornerAVX2(mPerm, mPerm12, i, j, k, x0, y0, z0);
+      const __m256 n1 = cornerAVX2(mPerm, mPerm12,
+                                   _mm256_sub_epi32(i, _mm256_castps_si256(i1)),
+                                   _mm256_sub_epi32(j, _mm256_castps_si256(j1)),
+                                   _mm256_sub_epi32(k, _mm256_castps_si256(k1)), x1, y1, z1);
+      const __m256 n2 = cornerAVX2(mPerm, mPerm12,
+                                   _mm256_sub_epi32(i, _mm256_castps_si256(i2)),
+                                   _mm256_sub_epi32(j, _mm256_castps_si256(j2)),
+                                   _mm256_sub_epi32(k, _mm256_castps_si256(k2)), x2, y2, z2);
+      const __m256 n3 = cornerAVX2(mPerm, mPerm12, _mm256_add_epi32(i, ione), _mm256_add_epi32(j, ione),
+                                   _mm256_add_epi32(k, ione), x3, y3, z3);
+
+      const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), n3);
+      _mm256_storeu_ps(out + p, _mm256_mul_ps(_mm256_set1_ps(32.0f), sum));
+    }
+  for(; p < n; p++)
+    { out[p] = simplex(mPerm, mPerm12, x[p], y[p], z[p]); }
+}
+
+#else // SIMPLEX_X86
+
+void SimplexBatch::evalSSE2(const float *x, const float *y, const float *z, float *out, int n) const
+{ evalScalar(x, y, z, out, n); }
+void SimplexBatch::evalAVX2(const float *x, const float *y, const float *z, float *out, int n) const
+{ evalScalar(x, y, z, out, n); }
+
+#endif // SIMPLEX_X86
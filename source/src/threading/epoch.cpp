@@ -0,0 +1,85 @@
+#include "epoch.hpp"
+
+#include "logging.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#define EPOCH_INACTIVE UINT64_MAX
+
+namespace Epoch
+{
+  static std::atomic<uint64_t> gEpoch = 1;
+  struct alignas(64) Slot
+  {
+    std::atomic<uint64_t> epoch = EPOCH_INACTIVE;
+    std::atomic<bool> claimed = false;
+  };
+  static Slot gSlots[EPOCH_MAX_THREADS];
+  static std::atomic<int> gNumSlots = 0; // (slots ever claimed -- minActive() only checks these)
+
+  // each thread claims a free slot the first time it enters, and gives it back when it exits
+  struct ThreadSlot
+  {
+    int index = -1;
+    ~ThreadSlot()
+    {
+      if(index >= 0)
+        {
+          gSlots[index].epoch.store(EPOCH_INACTIVE);
+          gSlots[index].claimed.store(false);
+        }
+    }
+  };
+  static thread_local ThreadSlot tSlot;
+  static thread_local int tDepth = 0;
+
+  static int claimSlot()
+  {
+    for(int i = 0; i < EPOCH_MAX_THREADS; i++)
+      {
+        bool claimed = false;
+        if(gSlots[i].claimed.compare_exchange_strong(claimed, true))
+          {
+            int numSlots = gNumSlots.load();
+            while(numSlots <= i && !gNumSlots.compare_exchange_weak(numSlots, i+1));
+            return i;
+          }
+      }
+    // (sharing a slot would let one thread's exit() hide another's reads)
+    LOGE("Too many threads for epoch reclamation! (max %d)", EPOCH_MAX_THREADS);
+    std::abort();
+  }
+
+  uint64_t retire()
+  { return gEpoch.fetch_add(1); }
+
+  uint64_t minActive()
+  {
+    uint64_t minEpoch = gEpoch.load();
+    const int numSlots = gNumSlots.load();
+    for(int i = 0; i < numSlots; i++)
+      {
+        const uint64_t e = gSlots[i].epoch.load();
+        if(e < minEpoch)
+          { minEpoch = e; }
+      }
+    return minEpoch;
+  }
+
+  void enter()
+  {
+    if(tDepth++ > 0)
+      { return; } // (nested)
+    if(tSlot.index < 0)
+      { tSlot.index = claimSlot(); }
+    // (seq_cst -- the slot must be visible before this thread reads any shared pointers)
+    gSlots[tSlot.index].epoch.store(gEpoch.load());
+  }
+
+  void exit()
+  {
+    if(--tDepth == 0)
+      { gSlots[tSlot.index].epoch.store(EPOCH_INACTIVE); }
+  }
+};
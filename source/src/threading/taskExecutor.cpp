@@ -0,0 +1,196 @@
+#include "taskExecutor.hpp"
+
+#include "logging.hpp"
+
+// worker id of the current thread (for pushing to own deque)
+static thread_local TaskExecutor *tExecutor = nullptr;
+static thread_local int tWorkerId = -1;
+
+TaskExecutor::TaskExecutor(int numThreads)
+  : mNumThreads(numThreads > 0 ? numThreads : 1)
+{
+  for(int i = 0; i < mNumThreads; i++)
+    { mWorkers.emplace_back(new Worker()); }
+}
+TaskExecutor::~TaskExecutor()
+{ stop(); }
+
+void TaskExecutor::setThreads(int numThreads)
+{
+  if(mRunning)
+    {
+      LOGW("Can't change executor thread count while running!");
+      return;
+    }
+  // move any queued tasks to first worker
+  std::deque<task_t> tasks;
+  for(auto &w : mWorkers)
+    { tasks.insert(tasks.end(), w->tasks.begin(), w->tasks.end()); }
+
+  mNumThreads = (numThreads > 0 ? numThreads : 1);
+  mWorkers.clear();
+  for(int i = 0; i < mNumThreads; i++)
+    { mWorkers.emplace_back(new Worker()); }
+  mWorkers[0]->tasks.swap(tasks);
+}
+
+void TaskExecutor::start()
+{
+  if(!mRunning)
+    {
+      mRunning = true;
+      mLastSample = clock_t::now();
+      for(int i = 0; i < (int)mWorkers.size(); i++)
+        {
+          mWorkers[i]->busyNs = 0;
+          mWorkers[i]->thread = std::thread(&TaskExecutor::workerLoop, this, i);
+        }
+    }
+}
+
+void TaskExecutor::stop()
+{
+  if(mRunning)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mWaitLock);
+        mRunning = false;
+      }
+      mWaitCv.notify_all();
+      for(auto &w : mWorkers)
+        { w->thread.join(); }
+    }
+  // finish remaining tasks
+  while(runOne());
+}
+
+void TaskExecutor::submit(const task_t &task)
+{
+  // push to own deque if called from a worker, otherwise distribute round robin
+  const int id = (tExecutor == this ? tWorkerId : (mNextWorker++ % mWorkers.size()));
+  {
+    std::lock_guard<std::mutex> lock(mWorkers[id]->lock);
+    mWorkers[id]->tasks.push_back(task);
+  }
+  mNumTasks++;
+  { // (empty lock so a worker can't miss the wakeup between checking and waiting)
+    std::lock_guard<std::mutex> lock(mWaitLock);
+  }
+  mWaitCv.notify_one();
+}
+
+bool TaskExecutor::popTask(int id, task_t &task)
+{
+  // take from own deque first, then steal from others
+  for(int i = 0; i < (int)mWorkers.size(); i++)
+    {
+      Worker *w = mWorkers[(id + i) % mWorkers.size()].get();
+      std::lock_guard<std::mutex> lock(w->lock);
+      if(w->tasks.size() > 0)
+        {
+          if(i == 0)
+            {
+              task = std::move(w->tasks.front());
+              w->tasks.pop_front();
+            }
+          else
+            { // steal from back of victim's deque (owner takes from front)
+              task = std::move(w->tasks.back());
+              w->tasks.pop_back();
+            }
+          mNumTasks--;
+          return true;
+        }
+    }
+  return false;
+}
+
+bool TaskExecutor::runOne()
+{
+  task_t task;
+  if(popTask(tExecutor == this ? tWorkerId : 0, task))
+    {
+      task();
+      return true;
+    }
+  return false;
+}
+
+void TaskExecutor::workerLoop(int id)
+{
+  tExecutor = this;
+  tWorkerId = id;
+  Worker *worker = mWorkers[id].get();
+  task_t task;
+  while(mRunning)
+    {
+      if(popTask(id, task))
+        {
+          auto start = clock_t::now();
+          task();
+          worker->busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - start).count();
+        }
+      else
+        {
+          std::unique_lock<std::mutex> lock(mWaitLock);
+          mWaitCv.wait(lock, [this]{ return (!mRunning || mNumTasks > 0); });
+        }
+    }
+  tExecutor = nullptr;
+  tWorkerId = -1;
+}
+
+std::vector<float> TaskExecutor::utilization()
+{
+  const auto now = clock_t::now();
+  const double elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mLastSample).count();
+  mLastSample = now;
+
+  std::vector<float> util;
+  for(auto &w : mWorkers)
+    { util.push_back(elapsed > 0.0 ? w->busyNs.exchange(0) / elapsed : 0.0f); }
+  return util;
+}
+
+
+void TaskGroup::submit(const TaskExecutor::task_t &task)
+{
+  if(!mExecutor || !mExecutor->running())
+    { // no executor -- run in calling thread
+      task();
+      return;
+    }
+  {
+    std::lock_guard<std::mutex> lock(mState->lock);
+    mState->tasks.push_back(task);
+    mState->remaining++;
+  }
+  // (each executor task runs whichever group task is next -- does nothing if wait() already ran them all)
+  std::shared_ptr<State> state = mState;
+  mExecutor->submit([state]() { runNext(state); });
+}
+
+bool TaskGroup::runNext(const std::shared_ptr<State> &state)
+{
+  TaskExecutor::task_t task;
+  {
+    std::lock_guard<std::mutex> lock(state->lock);
+    if(state->tasks.size() == 0)
+      { return false; }
+    task = std::move(state->tasks.front());
+    state->tasks.pop_front();
+  }
+  task();
+  std::lock_guard<std::mutex> lock(state->lock);
+  if(--state->remaining == 0)
+    { state->doneCv.notify_all(); }
+  return true;
+}
+
+void TaskGroup::wait()
+{
+  // help with this group's queued tasks, then wait for any still running
+  while(runNext(mState));
+  std::unique_lock<std::mutex> lock(mState->lock);
+  mState->doneCv.wait(lock, [this]{ return mState->remaining == 0; });
+}
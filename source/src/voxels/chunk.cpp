@@ -1,5 +1,7 @@
 #include "chunk.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 const Indexer<Chunk::sizeX, Chunk::sizeY, Chunk::sizeZ> Chunk::mIndexer;
 const Point3i Chunk::size{sizeX, sizeY, sizeZ};
@@ -12,8 +14,12 @@ Chunk::Chunk(const Point3i &worldPos)
       mNeighbors.emplace(side, nullptr);
       mNeighborHashes.emplace(side, Hash::hash(worldPos + sideDirection(side)));
     }
+  std::memset(&mSolidLayers, noLayer, sizeof(mSolidLayers));
 }
 
+Chunk::~Chunk()
+{ freeStorage(); }
+
 void Chunk::setWorldPos(const Point3i &pos)
 {
   mWorldPos = pos;
@@ -47,25 +53,74 @@ void Chunk::unsetNeighbor(blockSide_t side)
 }
 
 
+Chunk::BlockArray* Chunk::storage()
+{
+  BlockArray *blocks = mBlocks.load();
+  if(!blocks)
+    {
+      blocks = new BlockArray;
+      mBlocks.store(blocks, std::memory_order_release);
+    }
+  return blocks;
+}
+
+Chunk::BlockArray* Chunk::expand()
+{
+  BlockArray *blocks = mBlocks.load();
+  if(!blocks)
+    { // (filled before it's visible to readers)
+      blocks = new BlockArray;
+      blocks->fill(mUniform);
+      mBlocks.store(blocks, std::memory_order_release);
+    }
+  return blocks;
+}
+
+void Chunk::freeStorage()
+{
+  delete mBlocks.exchange(nullptr);
+}
+
+void Chunk::setUniform(block_t type)
+{
+  reset();
+  freeStorage();
+  mUniform = type;
+  mNumBlocks = (type == block_t::NONE ? 0 : totalSize);
+  mDirty = true;
+  updateConnected();
+}
+
 block_t* Chunk::at(int bi)
-{ return &mBlocks[bi]; }
+{ return &(*expand())[bi]; }
 block_t* Chunk::at(int bx, int by, int bz)
-{ return &mBlocks[mIndexer.index(bx, by, bz)]; }
+{ return &(*expand())[mIndexer.index(bx, by, bz)]; }
 block_t* Chunk::at(const Point3i &bp)
-{ return &mBlocks[mIndexer.index(bp)]; }
+{ return &(*expand())[mIndexer.index(bp)]; }
 block_t Chunk::getType(int bx, int by, int bz) const
-{ return mBlocks[mIndexer.index(bx, by, bz)]; }
+{ return get(mIndexer.index(bx, by, bz)); }
 block_t Chunk::getType(const Point3i &bp) const
-{ return mBlocks[mIndexer.index(bp[0], bp[1], bp[2])]; }
-std::array<block_t, Chunk::totalSize>& Chunk::data()
-{ return mBlocks; }
-const std::array<block_t, Chunk::totalSize>& Chunk::data() const
-{ return mBlocks; }
+{ return get(mIndexer.index(bp[0], bp[1], bp[2])); }
+const block_t* Chunk::blocks() const
+{
+  const BlockArray *blocks = mBlocks.load(std::memory_order_acquire);
+  return (blocks ? blocks->data() : nullptr);
+}
+
+bool Chunk::calcBounds(const PaddedChunk &padded)
+{
+  if(isUniform() && !isSimpleBlock(mUniform))
+    { // no solid blocks -- no faces
+      mBounds.setFaces({});
+      return false;
+    }
+  return mBounds.calcBounds(padded);
+}
 
 bool Chunk::setBlock(int bx, int by, int bz, block_t type)
 {
   const int bi = mIndexer.index(bx, by, bz);
-  block_t &b = mBlocks[bi];
+  const block_t b = get(bi);
   if((type != block_t::NONE) != (b != block_t::NONE))
     {
       if(b != block_t::NONE)
@@ -74,7 +129,7 @@ bool Chunk::setBlock(int bx, int by, int bz, block_t type)
         { mNumBlocks++; }
       if(isComplexBlock(b))
         { mComplex.erase(bi); }
-      b = type;
+      (*expand())[bi] = type;
       return true;
     }
   else
@@ -88,7 +143,7 @@ bool Chunk::setBlock(const Point3i &bp, block_t type)
 bool Chunk::setComplex(int bx, int by, int bz, CompleteBlock block)
 {
   const int bi = mIndexer.index(bx, by, bz);
-  block_t &b = mBlocks[bi];
+  const block_t b = get(bi);
   if((b != block_t::NONE) != (block.type != block_t::NONE))
     {
       if(block.type == block_t::NONE)
@@ -104,7 +159,7 @@ bool Chunk::setComplex(int bx, int by, int bz, CompleteBlock block)
       else // invalid data
         { return false; }
         
-      b = block.type;
+      (*expand())[bi] = block.type;
       if(block.data)
         {
           auto iterPX = mComplex.find(mIndexer.index(bx+1, by, bz));
@@ -248,7 +303,7 @@ void Chunk::floodFill(std::queue<Point3i> &points,
       if(!traversed[bi])
         {
           traversed[bi] = true;
-          if(mBlocks[bi] == block_t::NONE)
+          if(get(bi) == block_t::NONE)
             {
               if(bp[0] < sizeX-1)
                 { points.push({bp[0]+1, bp[1],   bp[2]  }); }
@@ -279,8 +334,90 @@ void Chunk::floodFill(std::queue<Point3i> &points,
     }
 }
 
+// connected edge flags for every combination of open sides
+static std::array<uint16_t, 64> makeEdgeTable()
+{
+  std::array<uint16_t, 64> table;
+  for(int sides = 0; sides < 64; sides++)
+    {
+      table[sides] = NO_EDGE;
+      for(int i = 0; i < 6; i++)
+        for(int j = i+1; j < 6; j++)
+          {
+            const int c = (1 << i) | (1 << j);
+            if((sides & c) == c)
+              { table[sides] |= edgeFlag((blockSide_t)(1 << i), (blockSide_t)(1 << j)); }
+          }
+    }
+  return table;
+}
+static const std::array<uint16_t, 64> gEdgeTable = makeEdgeTable();
+
+// Flood fills empty space in rows of blocks along x (one 32-bit word per row, indexed z + sizeZ*y)
+//  - a visited bitset replaces hash sets, and each stack entry expands a whole run of a row
+//  - every entry marks at least one new block, so the stack never holds more than 4 per block
+namespace
+{
+  static_assert(Chunk::sizeX == 32, "Connectivity rows assume 32 blocks along x");
+  
+  struct RowFill
+  {
+    static const int numRows = Chunk::sizeY * Chunk::sizeZ;
+    struct Entry
+    {
+      uint16_t row;
+      uint32_t bits;
+    };
+    std::array<uint32_t, numRows> open;    // (empty and not yet visited)
+    std::vector<Entry> stack = std::vector<Entry>(4*Chunk::totalSize + 1);
+
+    // visits the empty space connected to the given blocks, returning the chunk sides it touches
+    int fill(int row, uint32_t bits)
+    {
+      int sides = 0;
+      int top = 0;
+      stack[top++] = Entry{(uint16_t)row, bits};
+      while(top > 0)
+        {
+          const Entry e = stack[--top];
+          uint32_t run = e.bits & open[e.row];
+          if(!run)
+            { continue; }
+          // expand along the row
+          for(uint32_t grown = run; ; run = grown)
+            {
+              grown = (run | (run << 1) | (run >> 1)) & open[e.row];
+              if(grown == run)
+                { break; }
+            }
+          open[e.row] &= ~run;
+          
+          const int y = e.row / Chunk::sizeZ;
+          const int z = e.row % Chunk::sizeZ;
+          sides |= (((run & 1)                 ? (int)blockSide_t::NX : 0) |
+                    ((run >> (Chunk::sizeX-1)) ? (int)blockSide_t::PX : 0) |
+                    (y == 0                    ? (int)blockSide_t::NY : 0) |
+                    (y == Chunk::sizeY-1       ? (int)blockSide_t::PY : 0) |
+                    (z == 0                    ? (int)blockSide_t::NZ : 0) |
+                    (z == Chunk::sizeZ-1       ? (int)blockSide_t::PZ : 0) );
+          // (only push neighbor rows with open blocks next to this run)
+          if(y > 0 && (run & open[e.row - Chunk::sizeZ]))
+            { stack[top++] = Entry{(uint16_t)(e.row - Chunk::sizeZ), run}; }
+          if(y < Chunk::sizeY-1 && (run & open[e.row + Chunk::sizeZ]))
+            { stack[top++] = Entry{(uint16_t)(e.row + Chunk::sizeZ), run}; }
+          if(z > 0 && (run & open[e.row - 1]))
+            { stack[top++] = Entry{(uint16_t)(e.row - 1), run}; }
+          if(z < Chunk::sizeZ-1 && (run & open[e.row + 1]))
+            { stack[top++] = Entry{(uint16_t)(e.row + 1), run}; }
+        }
+      return sides;
+    }
+  };
+}
+
 void Chunk::updateConnected()
 {
+  std::memset(&mSolidLayers, noLayer, sizeof(mSolidLayers));
   if(isEmpty())
     {
       mConnectedEdges = ALL_EDGES;
@@ -288,70 +425,82 @@ void Chunk::updateConnected()
     }
   else
     { mConnectedEdges = NO_EDGE; }
-
-  std::unordered_set<int> untraversed;
-  std::unordered_set<int> edges;
-  for(int bi = 0; bi < totalSize; bi++)
-    {
-      if(mBlocks[bi] == block_t::NONE)
+  const BlockArray *blocks = mBlocks.load(std::memory_order_acquire);
+  if(!blocks)
+    { // (uniform and filled)
+      if(isSimpleBlock(mUniform))
         {
-          untraversed.insert(bi);
-          if(chunkEdge(mIndexer.unindex(bi)) != blockSide_t::NONE)
-            { edges.insert(bi); }
+          std::memset(&mSolidLayers.lowest, 0, sizeof(mSolidLayers.lowest));
+          std::memset(&mSolidLayers.highest, sizeX-1, sizeof(mSolidLayers.highest));
         }
+      return;
     }
 
-  while(edges.size() > 0 && untraversed.size() > 0)
+  static thread_local RowFill rows;
+  // solid blocks (and'ed) across the rows in each tile of each layer
+  const int tileSize = sizeX / occluderTiles;
+  uint32_t xSolid[occluderTiles*occluderTiles];  // (by y/z tile)
+  uint32_t ySolid[sizeY][occluderTiles];         // (by z tile)
+  uint32_t zSolid[sizeZ][occluderTiles];         // (by y tile)
+  std::fill(&xSolid[0], &xSolid[0] + occluderTiles*occluderTiles, ~0u);
+  std::fill(&ySolid[0][0], &ySolid[0][0] + sizeY*occluderTiles, ~0u);
+  std::fill(&zSolid[0][0], &zSolid[0][0] + sizeZ*occluderTiles, ~0u);
+  for(int r = 0; r < RowFill::numRows; r++)
     {
-      int bi = *edges.begin();
-      edges.erase(bi);
-      
-      std::queue<int> blocks;
-      blocks.push(bi);
-
-      // flood fill empty space
-      blockSide_t openSides = blockSide_t::NONE;
-      while(blocks.size() > 0)
+      const block_t *row = &(*blocks)[r*sizeX];
+      uint32_t bits = 0;
+      uint32_t solid = 0;
+      for(int x = 0; x < sizeX; x++)
         {
-          int bi = blocks.front();
-          blocks.pop();
-          
-          if(untraversed.count(bi) > 0)
-            { // block not traversed yet
-              untraversed.erase(bi);
-              Point3i p = mIndexer.unindex(bi);
-
-              openSides |= (p[0] == sizeX-1 ? blockSide_t::PX : blockSide_t::NONE);
-              openSides |= (p[1] == sizeY-1 ? blockSide_t::PY : blockSide_t::NONE);
-              openSides |= (p[2] == sizeZ-1 ? blockSide_t::PZ : blockSide_t::NONE);
-              openSides |= (p[0] == 0 ? blockSide_t::NX : blockSide_t::NONE);
-              openSides |= (p[1] == 0 ? blockSide_t::NY : blockSide_t::NONE);
-              openSides |= (p[2] == 0 ? blockSide_t::NZ : blockSide_t::NONE);
-              if(p[0] > 0)
-                { blocks.push(shiftNX(bi)); }
-              if(p[0] < sizeX-1)
-                { blocks.push(shiftPX(bi)); }
-              if(p[1] > 0)
-                { blocks.push(shiftPY(bi)); }
-              if(p[1] < sizeY-1)
-                { blocks.push(shiftNY(bi)); }
-              if(p[2] > 0)
-                { blocks.push(shiftPZ(bi)); }
-              if(p[2] < sizeZ-1)
-                { blocks.push(shiftNZ(bi)); }
-            }
+          bits |= (uint32_t)(row[x] == block_t::NONE) << x;
+          solid |= (uint32_t)isSimpleBlock(row[x]) << x;
         }
-      for(int i = 0; i < 6; i++)
+      rows.open[r] = bits;
+
+      const int y = r / sizeZ;
+      const int z = r % sizeZ;
+      xSolid[y/tileSize + occluderTiles*(z/tileSize)] &= solid;
+      ySolid[y][z/tileSize] &= solid;
+      zSolid[z][y/tileSize] &= solid;
+    }
+  
+  // solid layers along each axis (bit i set if layer i is solid across the tile)
+  //  (tile t = t1 + occluderTiles*t2, over axes (a+1)%3 and (a+2)%3)
+  auto xTile = [tileSize](int tx) -> uint32_t
+               { return (tileSize == 32 ? ~0u : ((1u << tileSize) - 1) << (tx*tileSize)); };
+  for(int t1 = 0; t1 < occluderTiles; t1++)
+    for(int t2 = 0; t2 < occluderTiles; t2++)
+      {
+        const int t = t1 + occluderTiles*t2;
+        uint32_t layers[3] = {xSolid[t], 0, 0};
+        for(int i = 0; i < sizeX; i++)
+          {
+            layers[1] |= (uint32_t)((ySolid[i][t1] & xTile(t2)) == xTile(t2)) << i; // (z, x)
+            layers[2] |= (uint32_t)((zSolid[i][t2] & xTile(t1)) == xTile(t1)) << i; // (x, y)
+          }
+        for(int a = 0; a < 3; a++)
+          {
+            if(layers[a])
+              {
+                mSolidLayers.lowest[a][t] = __builtin_ctz(layers[a]);
+                mSolidLayers.highest[a][t] = 31 - __builtin_clz(layers[a]);
+              }
+          }
+      }
+
+  // flood from every open block on the chunk's surface
+  const uint32_t edgeBits = (1u | (1u << (sizeX-1)));
+  for(int r = 0; r < RowFill::numRows; r++)
+    {
+      const int y = r / sizeZ;
+      const int z = r % sizeZ;
+      const bool edgeRow = (y == 0 || y == sizeY-1 || z == 0 || z == sizeZ-1);
+      for(uint32_t start = rows.open[r] & (edgeRow ? ~0u : edgeBits); start; start = rows.open[r] & (edgeRow ? ~0u : edgeBits))
         {
-          for(int j = i+1; j < 6; j++)
-            {
-              int c = (1 << i) | (1 << j);
-              if(((int)openSides & c) == c)
-                { mConnectedEdges |= edgeFlag((blockSide_t)(1 << i), (blockSide_t)(1 << j)); }
-            }
+          const uint32_t bit = start & (~start + 1);
+          mConnectedEdges |= gEdgeTable[rows.fill(r, bit)];
         }
     }
-  
 }
 
 bool Chunk::sideOpen(blockSide_t side)
@@ -395,55 +544,173 @@ void Chunk::reset()
   mNumBlocks = 0;
   mComplex.clear();
   mConnectedEdges = 0;
+  std::memset(&mSolidLayers, noLayer, sizeof(mSolidLayers));
   // for(auto &b : mBlocks)
   //   { b = block_t::NONE; }
 }
 
-// TODO: Run length encoding
+// SERIALIZED FORMAT
+//  - legacy:  raw block data, exactly (totalSize * Block::dataSize) bytes, no header
+//  - tagged:  first byte is a format_t, followed by:
+//      RAW     --> raw block data (totalSize bytes)
+//      RLE     --> runs of [type (1 byte) | length-1 (2 bytes, little endian)], in index (Y-Z-X) order
+//      PALETTE --> [palette size (1 byte) | palette types | indices bit-packed to 1/2/4 bits per block]
+//      UNIFORM --> type of every block (1 byte)
+//  (a tagged chunk is never exactly totalSize bytes, so legacy data is detected by size)
 int Chunk::serialize(std::vector<uint8_t> &dataOut) const
 {
-  dataOut.resize(totalSize * sizeof(block_t));//mNumBytes);
-  int offset = 0;
+  const BlockArray *blocks = mBlocks.load(std::memory_order_acquire);
+  return (blocks ? serializeBlocks(*blocks, dataOut) : serializeUniform(mUniform, dataOut));
+}
+
+int Chunk::serializeUniform(block_t type, std::vector<uint8_t> &dataOut)
+{
+  dataOut.resize(2);
+  dataOut[0] = (uint8_t)format_t::UNIFORM;
+  dataOut[1] = (uint8_t)type;
+  return 2;
+}
+
+int Chunk::serializeBlocks(const std::array<block_t, totalSize> &blocks, std::vector<uint8_t> &dataOut)
+{
+  // count runs and build palette
+  std::array<int, 256> paletteIndex;
+  paletteIndex.fill(-1);
+  std::vector<block_t> palette;
+  int numRuns = 0;
   for(int bi = 0; bi < totalSize; bi++)
     {
-      std::memcpy((void*)&dataOut[offset], (void*)&mBlocks[bi], Block::dataSize);
-      offset += Block::dataSize;
-      
-      /*
-      if(isFluidBlock(block.type))
+      const block_t type = blocks[bi];
+      if(bi == 0 || type != blocks[bi-1] || (bi % RLE_MAX_RUN) == 0)
+        { numRuns++; }
+      if(paletteIndex[(int)type] < 0)
         {
-          auto iter = mFluids.find(bi);
-          if(iter != mFluids.end())
-            {
-              offset += reinterpret_cast<FluidData*>(iter->second)->serialize(&dataOut[offset]);
-            }
+          paletteIndex[(int)type] = palette.size();
+          palette.push_back(type);
         }
-      */
     }
-  return offset;
+  if(palette.size() == 1)
+    { return serializeUniform(palette[0], dataOut); }
+  
+  const int paletteBits = (palette.size() <= 2 ? 1 : (palette.size() <= 4 ? 2 : (palette.size() <= 16 ? 4 : 8)));
+  const int rleBytes = 1 + numRuns * 3;
+  const int paletteBytes = (paletteBits < 8 ? 2 + palette.size() + totalSize * paletteBits / 8 : totalSize + 2);
+  const int rawBytes = 1 + totalSize;
+
+  if(rleBytes <= paletteBytes && rleBytes < rawBytes)
+    { // run length encoding
+      dataOut.resize(rleBytes);
+      dataOut[0] = (uint8_t)format_t::RLE;
+      int offset = 1;
+      int bi = 0;
+      while(bi < totalSize)
+        {
+          const block_t type = blocks[bi];
+          int len = 1;
+          while(bi + len < totalSize && len < RLE_MAX_RUN && blocks[bi + len] == type)
+            { len++; }
+          dataOut[offset]   = (uint8_t)type;
+          dataOut[offset+1] = (uint8_t)((len - 1) & 0xFF);
+          dataOut[offset+2] = (uint8_t)((len - 1) >> 8);
+          offset += 3;
+          bi += len;
+        }
+      return offset;
+    }
+  else if(paletteBytes < rawBytes)
+    { // palette + bit-packed indices
+      dataOut.assign(paletteBytes, 0);
+      dataOut[0] = (uint8_t)format_t::PALETTE;
+      dataOut[1] = (uint8_t)palette.size();
+      std::memcpy((void*)&dataOut[2], (void*)palette.data(), palette.size());
+      uint8_t *indices = &dataOut[2 + palette.size()];
+      const int perByte = 8 / paletteBits;
+      for(int bi = 0; bi < totalSize; bi++)
+        {
+          indices[bi / perByte] |= (paletteIndex[(int)blocks[bi]] << ((bi % perByte) * paletteBits));
+        }
+      return paletteBytes;
+    }
+  else
+    { // raw (tagged)
+      dataOut.resize(rawBytes);
+      dataOut[0] = (uint8_t)format_t::RAW;
+      std::memcpy((void*)&dataOut[1], (void*)blocks.data(), totalSize);
+      return rawBytes;
+    }
 }
-void Chunk::deserialize(const std::vector<uint8_t> &dataIn)
+
+// NOTE: The chunk must not be visible to other threads (block storage may be freed).
+bool Chunk::deserialize(const std::vector<uint8_t> &dataIn)
 {
   reset();
+
+  if(isUniformData(dataIn))
+    { // (also used by terrain generation)
+      setUniform((block_t)dataIn[1]);
+      return true;
+    }
   
-  int offset = 0;
-  for(int bi = 0; bi < totalSize; bi++)
+  BlockArray &blocks = *storage();
+  if(dataIn.size() == totalSize * Block::dataSize)
+    { // legacy raw data (also used by terrain generation)
+      std::memcpy((void*)blocks.data(), (void*)dataIn.data(), totalSize);
+    }
+  else if(dataIn.size() > 1 && dataIn[0] == (uint8_t)format_t::RAW && dataIn.size() == totalSize + 1)
     {
-      std::memcpy((void*)&mBlocks[bi], (void*)&dataIn[offset], sizeof(block_t));
-      if(mBlocks[bi] != block_t::NONE)
-        { mNumBlocks++; }
-      offset += Block::dataSize;
-
-      /*
-      if(isFluidBlock(block))
+      std::memcpy((void*)blocks.data(), (void*)&dataIn[1], totalSize);
+    }
+  else if(dataIn.size() > 1 && dataIn[0] == (uint8_t)format_t::RLE)
+    {
+      int bi = 0;
+      for(int offset = 1; offset + 2 < dataIn.size(); offset += 3)
         {
-          FluidData *data = new FluidData(&dataIn[offset]);
-          mNumBytes += data->dataSize();
-          offset += data->dataSize();
-          mFluids.emplace(bi, data);
+          const int len = (dataIn[offset+1] | (dataIn[offset+2] << 8)) + 1;
+          if(bi + len > totalSize)
+            { break; }
+          std::fill(blocks.begin() + bi, blocks.begin() + bi + len, (block_t)dataIn[offset]);
+          bi += len;
+        }
+      if(bi != totalSize)
+        {
+          LOGE("Corrupt chunk data (RLE runs cover %d / %d blocks)!", bi, totalSize);
+          return false;
         }
-      */
     }
+  else if(dataIn.size() > 2 && dataIn[0] == (uint8_t)format_t::PALETTE)
+    {
+      const int paletteSize = dataIn[1];
+      const int paletteBits = (paletteSize <= 2 ? 1 : (paletteSize <= 4 ? 2 : 4));
+      const int perByte = 8 / paletteBits;
+      const int mask = (1 << paletteBits) - 1;
+      if(dataIn.size() != 2 + paletteSize + totalSize * paletteBits / 8)
+        {
+          LOGE("Corrupt chunk data (palette data is %d bytes)!", (int)dataIn.size());
+          return false;
+        }
+      const uint8_t *palette = &dataIn[2];
+      const uint8_t *indices = &dataIn[2 + paletteSize];
+      for(int bi = 0; bi < totalSize; bi++)
+        {
+          const int pi = (indices[bi / perByte] >> ((bi % perByte) * paletteBits)) & mask;
+          blocks[bi] = (block_t)(pi < paletteSize ? palette[pi] : 0);
+        }
+    }
+  else
+    {
+      LOGE("Unrecognized chunk data format (%d bytes)!", (int)dataIn.size());
+      return false;
+    }
+
+  const block_t first = blocks[0];
+  if(std::all_of(blocks.begin(), blocks.end(), [first](block_t b) { return b == first; }))
+    { // every block is the same -- drop storage
+      setUniform(first);
+      return true;
+    }
+  
+  mNumBlocks = totalSize - std::count(blocks.begin(), blocks.end(), block_t::NONE);
   mDirty = true;
   updateConnected();
+  return true;
 }
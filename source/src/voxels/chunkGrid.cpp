@@ -0,0 +1,107 @@
+#include "chunkGrid.hpp"
+
+#include "chunk.hpp"
+#include "epoch.hpp"
+
+ChunkGrid::ChunkGrid()
+{ }
+
+ChunkGrid::~ChunkGrid()
+{
+  delete mGrid.load();
+  for(auto &retired : mRetiredGrids)
+    { delete retired.second; }
+}
+
+bool ChunkGrid::setWindow(const Point3i &minChunk, const Point3i &maxChunk)
+{
+  // free old grids no reader can still be using
+  for(auto iter = mRetiredGrids.begin(); iter != mRetiredGrids.end(); )
+    {
+      if(Epoch::safe(iter->first))
+        {
+          delete iter->second;
+          iter = mRetiredGrids.erase(iter);
+        }
+      else
+        { iter++; }
+    }
+
+  for(int i = 0; i < 3; i++)
+    {
+      mMin[i] = minChunk[i];
+      mMax[i] = maxChunk[i];
+    }
+
+  const Point3i dim = maxChunk - minChunk + 1;
+  Grid *grid = mGrid.load();
+  if(!grid || grid->dim != dim)
+    { // window size changed -- reallocate
+      mGrid = new Grid(dim);
+      if(grid)
+        { mRetiredGrids.emplace_back(Epoch::retire(), grid); }
+      return true;
+    }
+  return false;
+}
+
+bool ChunkGrid::inWindow(const Point3i &cp) const
+{
+  return (cp[0] >= mMin[0] && cp[0] <= mMax[0] &&
+          cp[1] >= mMin[1] && cp[1] <= mMax[1] &&
+          cp[2] >= mMin[2] && cp[2] <= mMax[2] );
+}
+
+void ChunkGrid::getWindow(Point3i &minOut, Point3i &maxOut) const
+{
+  for(int i = 0; i < 3; i++)
+    {
+      minOut[i] = mMin[i];
+      maxOut[i] = mMax[i];
+    }
+}
+
+int ChunkGrid::index(const Grid *grid, const Point3i &cp)
+{
+  const int x = ((cp[0] % grid->dim[0]) + grid->dim[0]) % grid->dim[0];
+  const int y = ((cp[1] % grid->dim[1]) + grid->dim[1]) % grid->dim[1];
+  const int z = ((cp[2] % grid->dim[2]) + grid->dim[2]) % grid->dim[2];
+  return x + grid->dim[0]*(z + grid->dim[2]*y);
+}
+
+ChunkPtr ChunkGrid::at(const Point3i &cp) const
+{
+  const Grid *grid = mGrid.load(std::memory_order_acquire);
+  if(!grid || !inWindow(cp))
+    { return nullptr; }
+  // (slot may still hold a chunk from the last time the window wrapped over it)
+  ChunkPtr chunk = grid->chunks[index(grid, cp)].load(std::memory_order_acquire);
+  return ((chunk && chunk->pos() == cp) ? chunk : nullptr);
+}
+
+void ChunkGrid::set(const Point3i &cp, ChunkPtr chunk)
+{
+  Grid *grid = mGrid.load();
+  if(grid && inWindow(cp))
+    { grid->chunks[index(grid, cp)].store(chunk, std::memory_order_release); }
+}
+
+void ChunkGrid::unset(const Point3i &cp, ChunkPtr chunk)
+{
+  Grid *grid = mGrid.load();
+  if(grid)
+    {
+      ChunkPtr expected = chunk;
+      grid->chunks[index(grid, cp)].compare_exchange_strong(expected, nullptr);
+    }
+}
+
+void ChunkGrid::clear()
+{
+  Grid *grid = mGrid.load();
+  if(grid)
+    {
+      for(auto &slot : grid->chunks)
+        { slot.store(nullptr); }
+    }
+}
@@ -2,9 +2,13 @@
 #include "logging.hpp"
 #include "hashing.hpp"
 #include "regionFile.hpp"
+#include "pointMath.hpp"
 #include <iostream>
 #include <filesystem>
 #include <stddef.h>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
 
 #define WORLD_DIR "worlds/"
 
@@ -28,13 +32,16 @@ bool ChunkLoader::checkVersion(const Vector<uint8_t, 4> &version) const
 }
 
 
-#define LOAD_SLEEP_US 10000
+#define REGION_COMPACT_RATIO 4 // compact regions that are more than 1/N free space
+#define SAVE_QUEUE_SIZE 256     // max number of chunk snapshots waiting to be written
+#define SAVE_SLEEP_US 1000
+#define SAVE_RETRY_MS 1000      // wait before retrying snapshots that couldn't be written
 
 
-ChunkLoader::ChunkLoader(int loadThreads, const loadCallback_t &loadCallback)
-  : mLoadPool(loadThreads, std::bind(&ChunkLoader::loadWorker, this,
-                                     std::placeholders::_1 ), LOAD_SLEEP_US ),
-    mLoadCallback(loadCallback), mTerrainGen(0)
+ChunkLoader::ChunkLoader(const loadCallback_t &loadCallback)
+  : mLoadCallback(loadCallback),
+    mSavePool(1, std::bind(&ChunkLoader::saveWorker, this, std::placeholders::_1), SAVE_SLEEP_US),
+    mTerrainGen(0)
 { }
 
 ChunkLoader::~ChunkLoader()
@@ -43,18 +50,64 @@ ChunkLoader::~ChunkLoader()
   for(auto rFile : mRegionLookup)
     { delete rFile.second; }
   mRegionLookup.clear();
+  for(auto s : mUnusedSaves)
+    { delete s; }
+  mUnusedSaves.clear();
+  for(auto &region : mPendingSaves)
+    {
+      for(auto &c : region.second)
+        { delete c.second; }
+    }
+  mPendingSaves.clear();
 }
 
 void ChunkLoader::start()
 {
-  mLoadPool.start();
+  if(!mRunning)
+    {
+      mRunning = true;
+      // submit tasks for chunks queued while stopped
+      int queued = numQueued();
+      for(int i = 0; i < queued; i++)
+        { submitLoad(); }
+    }
+  {
+    std::lock_guard<std::mutex> lock(mSaveLock);
+    mSaving = true;
+  }
+  mSavePool.start();
 }
 void ChunkLoader::stop()
 {
-  flush();
-  mLoadPool.stop();
+  mRunning = false;
+  if(!flush())
+    { LOGE("Failed to write %d chunk snapshots -- edits in those chunks are not saved!", numPendingSaves()); }
+  { // wait for load tasks in progress
+    std::unique_lock<std::mutex> lock(mLoadLock);
+    mLoadDoneCv.wait(lock, [this]{ return mActiveLoads == 0; });
+  }
+  mSavePool.stop(false);
+  { // (set under the lock so the save thread can't miss the notify between check and wait)
+    std::lock_guard<std::mutex> lock(mSaveLock);
+    mSaving = false;
+    mSaveCv.notify_all();
+  }
+  mSavePool.stop(true);
+  compactRegions();
+}
+void ChunkLoader::compactRegions()
+{
+  std::lock_guard<std::mutex> rlock(mRegionLock);
+  for(auto &r : mRegionLookup)
+    {
+      if(r.second->freeBytes() > (size_t)r.second->size() / REGION_COMPACT_RATIO)
+        {
+          const size_t freed = r.second->compact();
+          LOGI("Compacted region file (%d bytes freed)", (int)freed);
+        }
+    }
 }
-void ChunkLoader::flush()
+bool ChunkLoader::flush()
 {
   while(true)
     {
@@ -63,8 +116,9 @@ void ChunkLoader::flush()
         std::lock_guard<std::mutex> lock(mLoadLock);
         if(mLoadQueue.size() > 0)
           {
-            chunk = mLoadQueue.front();
-            mLoadQueue.pop();
+            std::pop_heap(mLoadQueue.begin(), mLoadQueue.end());
+            chunk = mLoadQueue.back().chunk;
+            mLoadQueue.pop_back();
           }
         else
           { break; }
@@ -72,6 +126,31 @@ void ChunkLoader::flush()
       if(chunk)
         { mLoadCallback(chunk); }
     }
+
+  // wait for pending saves to be written
+  std::unique_lock<std::mutex> lock(mSaveLock);
+  if(mSaving)
+    {
+      // (the next batch the save thread takes includes everything pending now)
+      const int batch = mSaveBatch + 1;
+      mSaveCv.notify_all();
+      mSaveDoneCv.wait(lock, [this, batch]
+                             { return ((mNumPendingSaves == 0 && mNumWriting == 0) || mSavedBatch >= batch); });
+      return ((mNumPendingSaves == 0 && mNumWriting == 0) || mFailedSaves == 0);
+    }
+  else if(mNumPendingSaves > 0)
+    { // no save thread -- write in calling thread
+      std::swap(mWritingSaves, mPendingSaves);
+      mNumWriting = mNumPendingSaves;
+      mNumPendingSaves = 0;
+      lock.unlock();
+      const int failed = writeSaves(mWritingSaves);
+      lock.lock();
+      mWritingSaves.clear();
+      mNumWriting = 0;
+      return (failed == 0);
+    }
+  return true;
 }
 bool ChunkLoader::checkWorldDir()
 { // create global world directory if needed
@@ -139,6 +218,11 @@ std::vector<std::string> ChunkLoader::listWorlds()
     }
   return worlds;
 }
+std::string ChunkLoader::getWorldDir() const
+{
+  return WORLD_DIR + mWorldName + "/";
+}
+
 std::vector<std::string> ChunkLoader::listRegions(const std::string &worldDir)
 {
   std::vector<std::string> regions;
@@ -261,20 +345,62 @@ bool ChunkLoader::deleteWorld(const std::string &worldName)
 }
 
 
-void ChunkLoader::load(Chunk* chunk)
+void ChunkLoader::load(Chunk* chunk, int priority)
 {
+  {
+    std::lock_guard<std::mutex> lock(mLoadLock);
+    mLoadQueue.push_back(LoadRequest{priority, chunk});
+    std::push_heap(mLoadQueue.begin(), mLoadQueue.end());
+  }
+  submitLoad();
+}
+void ChunkLoader::submitLoad()
+{ // each task loads the highest priority chunk queued when it runs
+  if(mRunning && mExecutor)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mLoadLock);
+        mActiveLoads++;
+      }
+      mExecutor->submit(std::bind(&ChunkLoader::loadNext, this));
+    }
+}
+void ChunkLoader::reprioritize(const std::function<int(const Point3i&)> &priority)
+{
+  std::lock_guard<std::mutex> lock(mLoadLock);
+  for(auto &r : mLoadQueue)
+    { r.priority = priority(r.chunk->pos()); }
+  std::make_heap(mLoadQueue.begin(), mLoadQueue.end());
+}
+std::vector<Chunk*> ChunkLoader::cancelOutside(const Point3i &minChunk, const Point3i &maxChunk)
+{
+  std::vector<Chunk*> cancelled;
   std::lock_guard<std::mutex> lock(mLoadLock);
-  mLoadQueue.push(chunk);
+  auto last = std::partition(mLoadQueue.begin(), mLoadQueue.end(),
+                             [&minChunk, &maxChunk](const LoadRequest &r)
+                             { return pointInRange(r.chunk->pos(), minChunk, maxChunk); });
+  for(auto iter = last; iter != mLoadQueue.end(); iter++)
+    { cancelled.push_back(iter->chunk); }
+  mLoadQueue.erase(last, mLoadQueue.end());
+  std::make_heap(mLoadQueue.begin(), mLoadQueue.end());
+  return cancelled;
 }
-void ChunkLoader::loadWorker(int tid)
+int ChunkLoader::numQueued()
+{
+  std::lock_guard<std::mutex> lock(mLoadLock);
+  return mLoadQueue.size();
+}
+
+void ChunkLoader::loadNext()
 {
   Chunk* chunk = nullptr;
   {
     std::lock_guard<std::mutex> lock(mLoadLock);
     if(mLoadQueue.size() > 0)
       {
-        chunk = mLoadQueue.front();
-        mLoadQueue.pop();
+        std::pop_heap(mLoadQueue.begin(), mLoadQueue.end());
+        chunk = mLoadQueue.back().chunk;
+        mLoadQueue.pop_back();
       }
   }
   
@@ -283,25 +409,19 @@ void ChunkLoader::loadWorker(int tid)
       loadDirect(chunk);
       mLoadCallback(chunk);
     }
+
+  std::lock_guard<std::mutex> lock(mLoadLock);
+  if(--mActiveLoads == 0)
+    { mLoadDoneCv.notify_all(); }
 }
 
 void ChunkLoader::loadDirect(Chunk* chunk)
 {
-  const Point3i cPos = chunk->pos();
-  const Point3i rPos({ cPos[0] >> 4,
-                       cPos[1] >> 4,
-                       cPos[2] >> 4 });
-  
-  RegionFile *rFile = nullptr;
-  {
-    std::lock_guard<std::mutex> rlock(mRegionLock);
-    auto iter = mRegionLookup.find(Hash::hash(rPos));
-    if(iter != mRegionLookup.end())
-      {
-        rFile = iter->second;
-      }
-  }
+  if(loadSaved(chunk))
+    { return; } // (region file may not have the latest blocks yet)
   
+  const Point3i cPos = chunk->pos();
+  RegionFile *rFile = getRegion(Point3i({ cPos[0] >> 4, cPos[1] >> 4, cPos[2] >> 4 }), false);
   if(!rFile || !rFile->readChunk(chunk))
     { // chunk not in file -- needs to be generated.
       std::vector<uint8_t> chunkData;
@@ -310,37 +430,226 @@ void ChunkLoader::loadDirect(Chunk* chunk)
     }
 }
 
-void ChunkLoader::save(Chunk* chunk)
+int ChunkLoader::prefetch(const Point3i &minChunk, const Point3i &maxChunk,
+                          const Point3i &skipMin, const Point3i &skipMax )
+{
+  // group chunk indices by region
+  std::unordered_map<RegionFile*, std::vector<int>> regions;
+  Point3i p;
+  for(p[0] = minChunk[0]; p[0] <= maxChunk[0]; p[0]++)
+    for(p[1] = minChunk[1]; p[1] <= maxChunk[1]; p[1]++)
+      for(p[2] = minChunk[2]; p[2] <= maxChunk[2]; p[2]++)
+        {
+          if(p[0] >= skipMin[0] && p[0] <= skipMax[0] &&
+             p[1] >= skipMin[1] && p[1] <= skipMax[1] &&
+             p[2] >= skipMin[2] && p[2] <= skipMax[2] )
+            { continue; }
+          RegionFile *rFile = getRegion(Point3i({ p[0] >> 4, p[1] >> 4, p[2] >> 4 }), false);
+          if(rFile)
+            { regions[rFile].push_back(RegionFile::chunkIndex(Point3i{p[0] & 15, p[1] & 15, p[2] & 15})); }
+        }
+  
+  int num = 0;
+  for(auto &r : regions)
+    { num += r.first->prefetch(r.second); }
+  return num;
+}
+int ChunkLoader::prefetchHits()
+{
+  int hits = 0;
+  std::lock_guard<std::mutex> rlock(mRegionLock);
+  for(auto &r : mRegionLookup)
+    { hits += r.second->prefetchHits(); }
+  return hits;
+}
+int ChunkLoader::prefetchMisses()
+{
+  int misses = 0;
+  std::lock_guard<std::mutex> rlock(mRegionLock);
+  for(auto &r : mRegionLookup)
+    { misses += r.second->prefetchMisses(); }
+  return misses;
+}
+
+RegionFile* ChunkLoader::getRegion(const Point3i &regionPos, bool create)
+{
+  std::lock_guard<std::mutex> rlock(mRegionLock);
+  auto iter = mRegionLookup.find(Hash::hash(regionPos));
+  if(iter != mRegionLookup.end())
+    { return iter->second; }
+  else if(!create)
+    { return nullptr; }
+  
+  // create new region file
+  RegionFile *rFile = new RegionFile(WORLD_DIR + mWorldName + "/" + RegionFile::regionFileName(regionPos),
+                                     mHeader.version, true );
+  if(!(*rFile))
+    {
+      LOGE("Failed to create new region file!!");
+      delete rFile;
+      return nullptr;
+    }
+  mRegionLookup[Hash::hash(regionPos)] = rFile;
+  return rFile;
+}
+
+bool ChunkLoader::save(Chunk* chunk)
 {
   const Point3i cPos = chunk->pos();
-  const Point3i rPos({ cPos[0] >> 4,
-                       cPos[1] >> 4,
-                       cPos[2] >> 4 });
-      
-  RegionFile *rFile = nullptr;
+  const hash_t rHash = Hash::hash(Point3i({ cPos[0] >> 4, cPos[1] >> 4, cPos[2] >> 4 }));
+  
+  std::lock_guard<std::mutex> lock(mSaveLock);
+  auto &region = mPendingSaves[rHash];
+  auto iter = region.find(chunk->hash());
+  SaveEntry *entry = nullptr;
+  if(iter != region.end())
+    { // already waiting -- replace snapshot
+      entry = iter->second;
+    }
+  else if(mNumPendingSaves >= SAVE_QUEUE_SIZE)
+    { // queue full
+      return false;
+    }
+  else
+    {
+      if(mUnusedSaves.size() > 0)
+        {
+          entry = mUnusedSaves.back();
+          mUnusedSaves.pop_back();
+        }
+      else
+        { entry = new SaveEntry(); }
+      region.emplace(chunk->hash(), entry);
+      mNumPendingSaves++;
+    }
+  entry->pos = cPos;
+  const block_t *blocks = chunk->blocks();
+  entry->uniform = !blocks;
+  if(blocks)
+    { std::memcpy((void*)entry->blocks.data(), (void*)blocks, sizeof(entry->blocks)); }
+  else
+    { entry->type = chunk->uniformType(); }
+  mSaveCv.notify_one();
+  return true;
+}
+
+bool ChunkLoader::loadSaved(Chunk *chunk)
+{
+  const Point3i cPos = chunk->pos();
+  const hash_t rHash = Hash::hash(Point3i({ cPos[0] >> 4, cPos[1] >> 4, cPos[2] >> 4 }));
+  auto findSave = [rHash, chunk](const saveBatch_t &saves) -> const SaveEntry*
+                  {
+                    auto rIter = saves.find(rHash);
+                    if(rIter == saves.end())
+                      { return nullptr; }
+                    auto cIter = rIter->second.find(chunk->hash());
+                    return (cIter != rIter->second.end() ? cIter->second : nullptr);
+                  };
+  
+  std::vector<uint8_t> chunkData;
   {
-    std::lock_guard<std::mutex> rlock(mRegionLock);
-    auto iter = mRegionLookup.find(Hash::hash(rPos));
-    if(iter != mRegionLookup.end())
-      { rFile = iter->second; }
+    std::lock_guard<std::mutex> lock(mSaveLock);
+    // (pending snapshots are newer than the batch being written)
+    const SaveEntry *entry = findSave(mPendingSaves);
+    if(!entry)
+      { entry = findSave(mWritingSaves); }
+    if(!entry)
+      { return false; }
+    
+    if(entry->uniform)
+      { Chunk::serializeUniform(entry->type, chunkData); }
+    else
+      { Chunk::serializeBlocks(entry->blocks, chunkData); }
   }
+  return chunk->deserialize(chunkData);
+}
 
-  if(!rFile)
-    { // create new region file
-      rFile = new RegionFile(WORLD_DIR + mWorldName + "/" + RegionFile::regionFileName(rPos),
-                              mHeader.version, true );
-      if(!(*rFile))
+int ChunkLoader::numPendingSaves()
+{
+  std::lock_guard<std::mutex> lock(mSaveLock);
+  return mNumPendingSaves + mNumWriting;
+}
+
+void ChunkLoader::saveWorker(int tid)
+{
+  {
+    std::unique_lock<std::mutex> lock(mSaveLock);
+    if(mFailedSaves > 0)
+      { // (snapshots the last batch couldn't write are pending again -- don't retry right away)
+        mSaveCv.wait_for(lock, std::chrono::milliseconds(SAVE_RETRY_MS), [this]{ return !mSaving; });
+      }
+    mSaveCv.wait(lock, [this]{ return (!mSaving || mNumPendingSaves > 0); });
+    std::swap(mWritingSaves, mPendingSaves);
+    mNumWriting = mNumPendingSaves;
+    mNumPendingSaves = 0;
+    mSaveBatch++;
+  }
+  // (only this thread changes mWritingSaves until it's cleared -- loads just read it under mSaveLock)
+  const int failed = (mWritingSaves.size() > 0 ? writeSaves(mWritingSaves) : 0);
+  
+  std::lock_guard<std::mutex> lock(mSaveLock);
+  mWritingSaves.clear();
+  mNumWriting = 0;
+  mFailedSaves = failed;
+  mSavedBatch = mSaveBatch;
+  mSaveDoneCv.notify_all();
+}
+
+int ChunkLoader::writeSaves(saveBatch_t &saves)
+{
+  int failed = 0;
+  std::vector<std::pair<Point3i, std::vector<uint8_t>>> batch;
+  std::vector<hash_t> hashes;
+  std::vector<int> failedChunks;
+  for(auto &region : saves)
+    {
+      if(region.second.size() == 0)
+        { continue; }
+      
+      // serialize all chunks in region
+      batch.resize(region.second.size());
+      hashes.resize(region.second.size());
+      int i = 0;
+      for(auto &c : region.second)
         {
-          LOGE("Failed to create new region file!!");
-          exit(1);
+          hashes[i] = c.first;
+          batch[i].first = c.second->pos;
+          if(c.second->uniform)
+            { Chunk::serializeUniform(c.second->type, batch[i].second); }
+          else
+            { Chunk::serializeBlocks(c.second->blocks, batch[i].second); }
+          i++;
         }
-      std::lock_guard<std::mutex> rlock(mRegionLock);
-      mRegionLookup[Hash::hash(rPos)] = rFile;
-    }
+      
+      const Point3i cPos = batch[0].first;
+      RegionFile *rFile = getRegion(Point3i({ cPos[0] >> 4, cPos[1] >> 4, cPos[2] >> 4 }), true);
+      failedChunks.clear();
+      if(rFile)
+        { rFile->writeChunks(batch, &failedChunks); }
+      else
+        {
+          for(int f = 0; f < (int)batch.size(); f++)
+            { failedChunks.push_back(f); }
+        }
+      if(failedChunks.size() > 0)
+        { LOGE("Failed to save %d chunks to region file! (will retry)", (int)failedChunks.size()); }
 
-  if(!rFile->writeChunk(chunk))
-    {
-      LOGE("FAILED TO SAVE CHUNK TO REGION FILE!!!");
-      exit(1); // TODO: Skip failed once this is all stable.
+      std::lock_guard<std::mutex> lock(mSaveLock);
+      // failed snapshots are pending again (unless a newer one is already waiting)
+      for(auto f : failedChunks)
+        {
+          auto iter = region.second.find(hashes[f]);
+          if(mPendingSaves[region.first].emplace(hashes[f], iter->second).second)
+            {
+              region.second.erase(iter);
+              mNumPendingSaves++;
+              failed++;
+            }
+        }
+      // (written -- loads read the region file from now on)
+      for(auto &c : region.second)
+        { mUnusedSaves.push_back(c.second); }
+      region.second.clear();
     }
+  return failed;
 }
@@ -4,6 +4,9 @@
 #include "camera.hpp"
 #include "world.hpp"
 #include "pointMath.hpp"
+#include "epoch.hpp"
+#include "occlusionBuffer.hpp"
+#include "chunkOcclusion.hpp"
 
 #include <chrono>
 
@@ -17,6 +20,9 @@ ChunkMap::~ChunkMap()
 {
   clear();
   std::lock_guard<std::mutex> lock(mChunkLock);
+  for(auto &retired : mRetiredChunks)
+    { delete retired.second; }
+  mRetiredChunks.clear();
   while(mUnusedChunks.size() > 0)
     {
       delete mUnusedChunks.front();
@@ -41,38 +47,14 @@ void ChunkMap::unlock()
 {
   mChunkLock.unlock();
 }
-std::unordered_map<hash_t, ChunkPtr>& ChunkMap::getChunks()
+ThreadMap<ChunkPtr>& ChunkMap::getChunks()
 {
   return mChunks;
 }
 
 void ChunkMap::load(const Point3i &cp)
 {
-  //mLoadOrder.push_back(cp);
-  Vector3f camPos = mCamera->getPos();
-  mCamPos = World::chunkPos(Vector3i{camPos[0], camPos[1], camPos[2]});
-  Vector3f diff = mCamPos - cp;
-  //int newPriority = chunkPriority(cp);
-  int newPriority = diff.dot(diff);
-  std::lock_guard<std::mutex> lock(mLoadLock);
-  if(newPriority < 0 || mLoadOrder.size() == 0)
-    {
-      mLoadOrder.push_back(cp);
-      return;
-    }
-  else
-    {
-      for(auto iter = mLoadOrder.begin(); iter != mLoadOrder.end(); ++iter)
-        {
-          diff = mCamPos - (*iter);
-          int priority = diff.dot(diff);
-          if(newPriority < priority)
-            {
-              mLoadOrder.insert(iter, cp);
-              break;
-            }
-        }
-    }
+  loadChunk(Hash::hash(cp), chunkPriority(cp));
 }
 void ChunkMap::unload(const Point3i &cp)
 {
@@ -83,9 +65,15 @@ void ChunkMap::unload(const Point3i &cp)
 void ChunkMap::clear()
 {
   std::lock_guard<std::mutex> lock(mChunkLock);
+  ChunkPtr chunk;
+  while(mLoadedQueue.tryPop(chunk))
+    { mUnusedChunks.push(chunk); }
+  mChunks.lock();
   for(auto iter : mChunks)
-    { mUnusedChunks.push(iter.second); }
-  mChunks.clear();
+    { retireChunk(iter.second); }
+  mChunks.lockedClear();
+  mChunks.unlock();
+  mGrid.clear();
   mLoadingChunks.clear();
   mChunkNeighbors.clear();
 
@@ -97,22 +85,13 @@ void ChunkMap::clear()
 Point3i ChunkMap::getPos() const
 { return (mCamera ? World::chunkPos(mCamera->getPos()) : Point3i()); }
 
-TreeNode ChunkMap::getTree()
-{
-  std::lock_guard<std::mutex> lock(mChunkLock);
-  return mVisibleTree;
-}
-
 bool ChunkMap::isLoading(const Point3i &cp)
 {
   std::lock_guard<std::mutex> lock(mChunkLock);
   return (mLoadingChunks.count(Hash::hash(cp)) > 0);
 }
 bool ChunkMap::isLoaded(const Point3i &cp)
-{
-  std::lock_guard<std::mutex> lock(mChunkLock);
-  return (mChunks.find(Hash::hash(cp)) != mChunks.end());
-}
+{ return findChunk(cp) != nullptr; }
 bool ChunkMap::isReady(const Point3i &cp)
 {
   std::lock_guard<std::mutex> lock(mChunkLock);
@@ -180,16 +159,47 @@ void ChunkMap::updateAdjacent(const Point3i &cp, blockSide_t edges)
     for(p[1] = minP[1]; p[1] <= maxP[1]; p[1]++)
       for(p[2] = minP[2]; p[2] <= maxP[2]; p[2]++)
         {
-          auto iter = mChunks.find(Hash::hash(p));
-          if(iter != mChunks.end())
-            { iter->second->setDirty(true); }
+          ChunkPtr chunk = findChunk(p);
+          if(chunk)
+            { chunk->setDirty(true); }
         }
 }
 
+void ChunkMap::updateBlock(const Point3i &wp)
+{ // (the block affects faces and lighting of blocks up to one away)
+  const Point3i minC = World::chunkPos(wp - 1);
+  const Point3i maxC = World::chunkPos(wp + 1);
+  Point3i p;
+  std::lock_guard<std::mutex> lock(mChunkLock);
+  for(p[0] = minC[0]; p[0] <= maxC[0]; p[0]++)
+    for(p[1] = minC[1]; p[1] <= maxC[1]; p[1]++)
+      for(p[2] = minC[2]; p[2] <= maxC[2]; p[2]++)
+        {
+          ChunkPtr chunk = findChunk(p);
+          if(chunk)
+            {
+              const int by = wp[1] - p[1]*Chunk::sizeY;
+              chunk->setDirtySections(Chunk::sectionMask(by-1, by+1));
+            }
+        }
+}
 
 void ChunkMap::chunkFinishedLoading(Chunk *chunk)
+{ // (called from loader threads) -- hand off to update() so loaders don't contend for the map lock
+  if(!mLoadedQueue.tryPush(chunk))
+    { // queue full -- add directly
+      std::lock_guard<std::mutex> lock(mChunkLock);
+      addLoadedChunk(chunk);
+    }
+}
+
+// (mChunkLock must be locked)
+void ChunkMap::retireChunk(ChunkPtr chunk)
+{ mRetiredChunks.emplace_back(Epoch::retire(), chunk); }
+
+// (mChunkLock must be locked)
+void ChunkMap::addLoadedChunk(Chunk *chunk)
 {
-  std::lock_guard<std::mutex> lock(mChunkLock);
   const hash_t hash = Hash::hash(chunk->pos());
   {
     if(mLoadingChunks.count(hash) == 0)
@@ -210,12 +220,7 @@ void ChunkMap::chunkFinishedLoading(Chunk *chunk)
     {
       hash_t nHash = chunk->neighborHash(side);
 
-      ChunkPtr nChunk = nullptr;
-      {
-        auto nIter = mChunks.find(nHash);
-        if(nIter != mChunks.end())
-          { nChunk = nIter->second; }
-      }
+      ChunkPtr nChunk = findChunk(chunk->pos() + sideDirection(side));
       if(nChunk)
         {
           chunk->setNeighbor(side, nChunk);
@@ -249,39 +254,37 @@ void ChunkMap::chunkFinishedLoading(Chunk *chunk)
   
   // add chunk
   mChunks.emplace(hash, chunk);
+  mGrid.set(chunk->pos(), chunk);
   mChunkNeighbors.emplace(hash, neighbors);
   mNumLoading--;
   mNumLoaded++;
 }
 
 ChunkPtr ChunkMap::operator[](const Point3i &cp)
-{
-  std::lock_guard<std::mutex> lock(mChunkLock);
-  const hash_t hash = Hash::hash(cp);
-  auto iter = mChunks.find(hash);
-  if(iter != mChunks.end())
-    { return iter->second; }
-  else
-    { return nullptr; }
-}
+{ return findChunk(cp); }
 ChunkPtr ChunkMap::operator[](hash_t hash)
-{
-  std::lock_guard<std::mutex> lock(mChunkLock);
-  auto iter = mChunks.find(hash);
-  if(iter != mChunks.end())
-    { return iter->second; }
+{ return findChunk(Hash::unhash(hash)); }
+
+ChunkPtr ChunkMap::findChunk(const Point3i &cp)
+{ // grid covers the loaded window -- only chunks outside it need a hash lookup
+  if(mGrid.inWindow(cp))
+    { return mGrid.at(cp); }
   else
-    { return nullptr; }
+    { return mChunks.at(Hash::hash(cp)); }
 }
 
-void ChunkMap::loadChunk(hash_t hash)
+void ChunkMap::loadChunk(hash_t hash, int priority)
 {
   std::lock_guard<std::mutex> lock(mChunkLock);
-  {
-    auto iter = mChunks.find(hash);
-    if(iter != mChunks.end() || mLoadingChunks.count(hash) > 0)
-      { return; }
-  }
+  if(mChunks.contains(hash) || mLoadingChunks.count(hash) > 0)
+    { return; }
+  
+  // reuse unloaded chunks once no other threads can be reading them
+  while(mRetiredChunks.size() > 0 && Epoch::safe(mRetiredChunks.front().first))
+    {
+      mUnusedChunks.push(mRetiredChunks.front().second);
+      mRetiredChunks.pop_front();
+    }
   const Point3i p = Hash::unhash(hash);
   ChunkPtr chunk;
   if(mUnusedChunks.size() > 0)
@@ -301,25 +304,14 @@ void ChunkMap::loadChunk(hash_t hash)
   
   mLoadingChunks.insert(hash);
   mNumLoading++;
-  mLoader->load(chunk);
+  mLoader->load(chunk, priority);
 }
 
 void ChunkMap::unloadChunk(hash_t hash)
 {
-  Point3i p = Hash::unhash(hash);
-  {
-    std::lock_guard<std::mutex> lock(mLoadLock);
-    mLoadOrder.remove(p);
-  }
-
   std::lock_guard<std::mutex> lock(mChunkLock);
-  ChunkPtr chunk = nullptr;
-  {  
-    //mLoadingChunks.erase(hash);
-    auto iter = mChunks.find(hash);
-    if(iter != mChunks.end())
-      { chunk = iter->second; }
-  }
+  //mLoadingChunks.erase(hash);
+  ChunkPtr chunk = mChunks.at(hash);
 
   if(chunk)
     {
@@ -341,10 +333,10 @@ void ChunkMap::unloadChunk(hash_t hash)
                 {
                   //std::lock_guard<std::mutex> lock(mChunkLock);
                   //mUnloadedChunks.insert(nHash);
-                  auto ncIter = mChunks.find(nHash);
-                  ncIter->second->setDirty(true);
-                  ncIter->second->setReady(false);
-                  ncIter->second->setUnloaded(true);
+                  ChunkPtr nChunk = mChunks.at(nHash);
+                  nChunk->setDirty(true);
+                  nChunk->setReady(false);
+                  nChunk->setUnloaded(true);
                 }
             }
         }
@@ -353,22 +345,17 @@ void ChunkMap::unloadChunk(hash_t hash)
       //mUnloadedChunks.insert(hash);
       chunk->setReady(false);
       chunk->setUnloaded(true);
-      mUnusedChunks.push(chunk);
       mChunks.erase(hash);
+      mGrid.unset(chunk->pos(), chunk);
+      retireChunk(chunk);
       mNumLoaded--;
     }
   else
     {
       if(mLoadingChunks.count(hash) > 0)
         { // stop loading
-          {
-            mLoadingChunks.erase(hash);
-            mNumLoading--;
-          }
-          {
-            std::lock_guard<std::mutex> lock(mLoadLock);
-            mLoadOrder.remove(p);
-          }
+          mLoadingChunks.erase(hash);
+          mNumLoading--;
         }
       else
         {
@@ -383,12 +370,12 @@ static const std::vector<blockSide_t> stepSides { blockSide_t::PX,
                                                    blockSide_t::NX,
                                                    blockSide_t::NY,
                                                    blockSide_t::NZ };
-static const std::vector<Vector3f> stepDirs { sideDirection(stepSides[0]),
-                                              sideDirection(stepSides[1]),
-                                              sideDirection(stepSides[2]),
-                                              sideDirection(stepSides[3]),
-                                              sideDirection(stepSides[4]),
-                                              sideDirection(stepSides[5]) };
+static const std::array<Point3i, 6> stepDirs { sideDirection(stepSides[0]),
+                                               sideDirection(stepSides[1]),
+                                               sideDirection(stepSides[2]),
+                                               sideDirection(stepSides[3]),
+                                               sideDirection(stepSides[4]),
+                                               sideDirection(stepSides[5]) };
 
 std::vector<hash_t> ChunkMap::updateTree()
 {
@@ -431,13 +418,7 @@ std::vector<hash_t> ChunkMap::updateTree()
       
       const hash_t hash = order.hash;
 
-      ChunkPtr chunk = nullptr;
-      {
-        std::lock_guard<std::mutex> lock(mChunkLock);
-        auto cIter = mChunks.find(hash);
-        if(cIter != mChunks.end())
-          { chunk = cIter->second; }
-      }
+      ChunkPtr chunk = mChunks.at(hash);
       
       if(chunk)
         {
@@ -488,108 +469,124 @@ std::vector<hash_t> ChunkMap::updateTree()
 std::vector<hash_t> ChunkMap::getVisible(Camera *cam)
 {
   std::vector<hash_t> visible;
+  getVisible(cam, visible);
+  return visible;
+}
+
+void ChunkMap::getVisible(Camera *cam, std::vector<hash_t> &visibleOut)
+{
+  EpochGuard epoch; // (called from render thread)
+  visibleOut.clear();
   if(!cam)
     { // add all loaded chunks
-      std::lock_guard<std::mutex> lock(mChunkLock);
-      visible.reserve(mChunks.size());
+      std::lock_guard<std::mutex> lock(mChunkLock); // (map only changes with mChunkLock held)
+      visibleOut.reserve(mChunks.size());
       for(auto &iter : mChunks)
-        { visible.push_back(iter.first); }
-      
-      return visible;
+        { visibleOut.push_back(iter.first); }
+      return;
     }
+  std::lock_guard<std::mutex> lock(mVisibleLock);
   Point3f camPos = cam->getPos();
   Point3i iCamPos = World::chunkPos(Point3i{camPos[0], camPos[1], camPos[2]});
-  mVisibleTree.pos = iCamPos;
-
-  const hash_t cHash = Hash::hash(iCamPos);
-  visible.push_back(cHash);
-  
-  std::unordered_set<hash_t> traversed;
-  std::queue<std::pair<OrderNode, blockSide_t>> steps; // (index of mRenderOrder, and direction)
-
-  ChunkPtr chunk = nullptr;
-  {
-    std::lock_guard<std::mutex> lock(mChunkLock);
-    auto iter = mChunks.find(cHash);
-    if(iter != mChunks.end())
-      {
-        chunk = iter->second;
-      }
-  }
-  
-  // TODO:
-  //  - stop propogating if already behind other chunks
-  //    (see minecraft cave culling example)
-  //     **like reverse of world raycast, with more of a range**
-  //  - more filters
-  
-  mVisibleTree = TreeNode(chunk, nullptr, 0, true);
-  steps.push({{cHash, &mVisibleTree}, blockSide_t::NONE});
+  visibleOut.push_back(Hash::hash(iCamPos));
+
+  // snapshot of the loaded window (chunk lookups through mGrid are lock-free)
+  Point3i minChunk;
+  Point3i maxChunk;
+  mGrid.getWindow(minChunk, maxChunk);
+  const Point3i dim = maxChunk - minChunk + 1;
+  if(dim[0] <= 0 || dim[1] <= 0 || dim[2] <= 0 || !pointInRange(iCamPos, minChunk, maxChunk))
+    { return; }
+  const int numChunks = dim[0]*dim[1]*dim[2];
+  if((int)mVisitStamps.size() != numChunks)
+    {
+      mVisitStamps.assign(numChunks, 0);
+      mVisibleSteps.resize(numChunks);
+      mFrustumBoxes.reserve(numChunks);
+      mVisitStamp = 0;
+    }
+  if(++mVisitStamp == 0)
+    { // (stamp wrapped)
+      std::fill(mVisitStamps.begin(), mVisitStamps.end(), 0);
+      mVisitStamp = 1;
+    }
+  auto visitIndex = [&minChunk, &dim](const Point3i &cp)
+                    {
+                      const Point3i p = cp - minChunk;
+                      return p[0] + dim[0]*(p[2] + dim[2]*p[1]);
+                    };
+
+  // cull every chunk in the window against the frustum at once
+  if(mFrustumBoxes.size() != numChunks || minChunk != mFrustumWindow)
+    { // (chunk bounds only change with the window)
+      mFrustumBoxes.clear();
+      mFrustumWindow = minChunk;
+      Point3i cp;
+      for(cp[1] = minChunk[1]; cp[1] <= maxChunk[1]; cp[1]++)
+        for(cp[2] = minChunk[2]; cp[2] <= maxChunk[2]; cp[2]++)
+          for(cp[0] = minChunk[0]; cp[0] <= maxChunk[0]; cp[0]++)
+            {
+              const Point3f minP = Vector3f(cp)*Chunk::size;
+              mFrustumBoxes.add(minP, minP + Vector3f(Chunk::size));
+            }
+    }
+  cam->getFrustum().cull(mFrustumBoxes, mFrustumMask);
   
-  while(steps.size() > 0)
+  // breadth-first through the window, only crossing chunks whose entry and exit sides connect
+  //  (see minecraft cave culling) -- each chunk is visited once
+  int head = 0;
+  int tail = 0;
+  mVisitStamps[visitIndex(iCamPos)] = mVisitStamp;
+  mVisibleSteps[tail++] = VisibleStep{iCamPos, blockSide_t::NONE, blockSide_t::NONE};
+  while(head < tail)
     {
-      const OrderNode order = steps.front().first;
-      const blockSide_t prevSide = steps.front().second;
-      steps.pop();
+      const VisibleStep step = mVisibleSteps[head++];
+      ChunkPtr chunk = mGrid.at(step.pos);
+      const int vi = visitIndex(step.pos);
+      if(chunk && !((mFrustumMask[vi / 64] >> (vi % 64)) & 1))
+        { continue; }
       
-      const hash_t hash = order.hash;
-
-      ChunkPtr chunk = nullptr;
-      {
-        std::lock_guard<std::mutex> lock(mChunkLock);
-        auto cIter = mChunks.find(hash);
-        if(cIter != mChunks.end())
-          { chunk = cIter->second; }
-      }
-
-      Point3i cp;// = Hash::unhash(hash);
-      if(chunk)
-        { cp = chunk->pos(); }
-      
-      if(!chunk || cam->cubeInFrustum(Vector3f(cp)*Chunk::size, Vector3f(Chunk::size)) )
+      // propagate to each side connected to the side this chunk was entered through
+      for(int i = 0; i < 6; i++)
         {
-          // propogate to each unvisited side
-          for(int i = 0; i < 6; i++)
-            {
-              if(stepSides[i] != prevSide && (!chunk || prevSide == blockSide_t::NONE ||
-                                              chunk->edgesConnected(prevSide, stepSides[i]) ))
-                {
-                  const Point3i nextPos = cp + stepDirs[i];
-                  const hash_t nextHash = Hash::hash(nextPos);
-                  if(traversed.count(nextHash) == 0)
-                    { //  unvisited chunk
-                      traversed.insert(nextHash);
-                      visible.push_back(nextHash);
-
-                      ChunkPtr nextChunk = nullptr;
-                      {
-                        std::lock_guard<std::mutex> lock(mChunkLock);
-                        auto cIter2 = mChunks.find(nextHash);
-                        if(cIter2 != mChunks.end())
-                          { nextChunk = cIter2->second; }
-                      }
-                      if(order.node)
-                        {
-                          order.node->children.emplace_back(nextChunk,
-                                                            order.node,
-                                                            order.node->depth + 1);
-                          steps.push({{nextHash, &order.node->children.back()},
-                                      oppositeSide(stepSides[i]) });
-                        }
-                    }
-                }
+          // stop if stepping back against a direction already taken
+          //  (anything reached that way is behind chunks already traversed)
+          if((step.stepped & stepSides[(i+3) % 6]) != blockSide_t::NONE)
+            { continue; }
+          if(chunk && step.enterSide != blockSide_t::NONE &&
+             !chunk->edgesConnected(step.enterSide, stepSides[i]) )
+            { continue; }
+          const Point3i nextPos = step.pos + stepDirs[i];
+          if(!pointInRange(nextPos, minChunk, maxChunk))
+            { continue; }
+          uint32_t &stamp = mVisitStamps[visitIndex(nextPos)];
+          if(stamp != mVisitStamp)
+            { //  unvisited chunk
+              stamp = mVisitStamp;
+              visibleOut.push_back(Hash::hash(nextPos));
+              mVisibleSteps[tail++] = VisibleStep{nextPos, stepSides[(i+3) % 6],
+                                                  step.stepped | stepSides[i] };
             }
         }
     }
-  
-  return visible;
+}
+
+void ChunkMap::cullOccluded(Camera *cam, OcclusionBuffer &buffer, std::vector<hash_t> &visible)
+{
+  EpochGuard epoch; // (called from render thread)
+  cullOccludedChunks(*cam, buffer, [this](const Point3i &cp) -> Chunk* { return findChunk(cp); }, visible);
 }
 
 std::vector<hash_t> ChunkMap::unloadOutside(const Point3i minChunk, const Point3i maxChunk)
 {
   std::vector<hash_t> unloadChunks;
   {
-    std::lock_guard<std::mutex> lock(mChunkLock);
+    std::lock_guard<std::mutex> lock(mChunkLock); // (map only changes with mChunkLock held)
+    if(mGrid.setWindow(minChunk, maxChunk))
+      { // grid reallocated -- add chunks still in range
+        for(auto iter : mChunks)
+          { mGrid.set(iter.second->pos(), iter.second); }
+      }
     for(auto iter : mChunks)
       {
         if(!pointInRange(iter.second->pos(), minChunk, maxChunk))
@@ -598,6 +595,20 @@ std::vector<hash_t> ChunkMap::unloadOutside(const Point3i minChunk, const Point3
             unloadChunks.push_back(iter.first);
           }
       }
+    // stop loading chunks out of range
+    for(auto iter = mLoadingChunks.begin(); iter != mLoadingChunks.end(); )
+      {
+        if(!pointInRange(Hash::unhash(*iter), minChunk, maxChunk))
+          {
+            iter = mLoadingChunks.erase(iter);
+            mNumLoading--;
+          }
+        else
+          { iter++; }
+      }
+    // cancel queued loads (chunks already loading are recycled when finished)
+    for(auto chunk : mLoader->cancelOutside(minChunk, maxChunk))
+      { mUnusedChunks.push(chunk); }
   }
   for(auto hash : unloadChunks)
     {
@@ -610,56 +621,55 @@ std::vector<hash_t> ChunkMap::unloadOutside(const Point3i minChunk, const Point3
   return unloadChunks;
 }
 
+#define REPRIORITIZE_ANGLE_COS 0.9f // reprioritize loading when camera turns past this angle
+#define FRUSTUM_PRIORITY_SCALE 4    // priority multiplier for chunks outside view frustum
+
 void ChunkMap::update()
 {
-  //auto startT = std::chrono::high_resolution_clock::now();
-  //updateTree();
-  //std::vector<hash_t> order = updateTree();
-  //LOGD("Tree update time: %fs", (std::chrono::high_resolution_clock::now() - startT).count());
-
-  //startT = std::chrono::high_resolution_clock::now();
-  //mLoadOrder.sort([this](const Point3i &p1, const Point3i &p2)
-  //                { return chunkPriority(p1) > chunkPriority(p2); });
-  while(mLoadOrder.size() > 0 && mNumLoading < 256)
+  // add all chunks that finished loading since last update
+  mLoadedBatch.clear();
+  if(mLoadedQueue.popBatch(mLoadedBatch, LOADED_QUEUE_SIZE) > 0)
     {
-      std::lock_guard<std::mutex> lock(mLoadLock);
-      //{
-        //std::lock_guard<std::mutex> lock(mLoadLock);
-        Point3i cp = mLoadOrder.front();
-        mLoadOrder.pop_front();
-        //}
-      //std::lock_guard<std::mutex> lock(mChunkLock);
-      loadChunk(Hash::hash(cp));
+      std::lock_guard<std::mutex> lock(mChunkLock);
+      for(auto chunk : mLoadedBatch)
+        { addLoadedChunk(chunk); }
     }
-  //LOGD("Load update time: %fs", (std::chrono::high_resolution_clock::now() - startT).count());
+  
+  updateCamPos();
+  if(mCamera && (mCamPos != mPriorityPos ||
+                 mCamera->getForward().dot(mCamForward) < REPRIORITIZE_ANGLE_COS ))
+    { reprioritize(); }
 }
 
-int ChunkMap::chunkPriority(const Point3i &cp)
+void ChunkMap::updateCamPos()
 {
-  /*
-  //std::lock_guard<std::mutex> lock(mChunkLock);
-  Point3f camPos = mCamera->getPos();
-  mCamPos = World::chunkPos(Point3i{camPos[0], camPos[1], camPos[2]});
-
-  hash_t hash = Hash::hash(cp);
+  if(mCamera)
+    {
+      Vector3f camPos = mCamera->getPos();
+      mCamPos = World::chunkPos(Point3i{camPos[0], camPos[1], camPos[2]});
+    }
+}
 
-  Vector3i diff = (mCamPos - cp).abs();
-  int maxDiff = diff.max();
-  
-  if(maxDiff < 3)
-    { return maxDiff; }
-  else
+void ChunkMap::reprioritize()
+{
+  updateCamPos();
+  if(mCamera)
     {
-      // auto tIter = mTreeOrder.find(hash);
-      // if(tIter != mTreeOrder.end())
-      //   { return tIter->second; }
-      // else
-        {
-          Vector3i diff = mCamPos - cp;
-          //return 1000 + diff.dot(diff);
-          return diff.dot(diff);
-        }
+      mCamForward = mCamera->getForward();
+      mPriorityPos = mCamPos;
     }
-  */
-  return 0;
+  mLoader->reprioritize([this](const Point3i &cp){ return chunkPriority(cp); });
+}
+
+int ChunkMap::chunkPriority(const Point3i &cp)
+{
+  // nearest chunks first
+  const Vector3i diff = mCamPos - cp;
+  int priority = diff.dot(diff);
+  
+  // chunks adjacent to camera are always needed -- otherwise prefer chunks in view
+  if(mCamera && priority > 3 &&
+     !mCamera->cubeInFrustum(Vector3f(cp)*Chunk::size, Vector3f(Chunk::size)) )
+    { priority *= FRUSTUM_PRIORITY_SCALE; }
+  return priority;
 }
@@ -0,0 +1,95 @@
+#include "chunkOcclusion.hpp"
+
+#include "chunk.hpp"
+#include "camera.hpp"
+#include "occlusionBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// adds a quad perpendicular to axis a as an occluder
+static void addOccluderQuad(OcclusionBuffer &buffer, int a, float plane,
+                            float min1, float max1, float min2, float max2 )
+{
+  const int a1 = (a + 1) % 3;
+  const int a2 = (a + 2) % 3;
+  Point3f corners[4];
+  for(int c = 0; c < 4; c++)
+    {
+      corners[c][a] = plane;
+      corners[c][a1] = ((c == 1 || c == 2) ? max1 : min1);
+      corners[c][a2] = ((c >= 2) ? max2 : min2);
+    }
+  buffer.addOccluder(corners);
+}
+
+void cullOccludedChunks(const Camera &cam, OcclusionBuffer &buffer, const chunkLookup_t &getChunk,
+                        std::vector<hash_t> &visible )
+{
+  const Point3f camPos = cam.getPos();
+  const Point3i camBlock{camPos[0], camPos[1], camPos[2]};
+  const Point3i camChunk{camBlock[0] >> Chunk::shiftX, camBlock[1] >> Chunk::shiftY,
+                         camBlock[2] >> Chunk::shiftZ }; // (World::chunkPos)
+  const int numTiles = Chunk::occluderTiles*Chunk::occluderTiles;
+  const float tileSize = (float)Chunk::sizeX / Chunk::occluderTiles;
+
+  // occluders -- outer faces of the solid layers in nearby chunks that face the camera
+  buffer.begin(cam);
+  for(auto hash : visible)
+    {
+      const Point3i cp = Hash::unhash(hash);
+      const Vector3i diff = cp - camChunk;
+      if(std::abs(diff[0]) > OCCLUDER_RADIUS || std::abs(diff[1]) > OCCLUDER_RADIUS ||
+         std::abs(diff[2]) > OCCLUDER_RADIUS )
+        { continue; }
+      const Chunk *chunk = getChunk(cp);
+      if(!chunk || chunk->isEmpty())
+        { continue; }
+      
+      const Chunk::SolidLayers &layers = chunk->solidLayers();
+      const Point3f minP = Vector3f(cp)*Chunk::size;
+      for(int a = 0; a < 3; a++)
+        {
+          const int a1 = (a + 1) % 3;
+          const int a2 = (a + 2) % 3;
+          for(int end = 0; end < 2; end++)
+            {
+              const uint8_t *layer = (end == 0 ? layers.lowest[a] : layers.highest[a]);
+              // (whole chunk side if every tile has the same solid layer)
+              const bool merged = std::all_of(layer, layer + numTiles,
+                                              [layer](uint8_t l) { return l == layer[0]; });
+              for(int t = 0; t < (merged ? 1 : numTiles); t++)
+                {
+                  if(layer[t] == Chunk::noLayer)
+                    { continue; }
+                  const float plane = minP[a] + layer[t] + end; // (bottom of lowest/top of highest)
+                  if(end == 0 ? camPos[a] >= plane : camPos[a] <= plane)
+                    { continue; } // (faces away)
+                  
+                  if(merged)
+                    {
+                      addOccluderQuad(buffer, a, plane, minP[a1], minP[a1] + Chunk::sizeX,
+                                      minP[a2], minP[a2] + Chunk::sizeX );
+                    }
+                  else
+                    {
+                      const float min1 = minP[a1] + (t % Chunk::occluderTiles)*tileSize;
+                      const float min2 = minP[a2] + (t / Chunk::occluderTiles)*tileSize;
+                      addOccluderQuad(buffer, a, plane, min1, min1 + tileSize, min2, min2 + tileSize);
+                    }
+                }
+            }
+        }
+    }
+  buffer.finish();
+
+  int numVisible = 0;
+  for(auto hash : visible)
+    {
+      const Point3i cp = Hash::unhash(hash);
+      const Point3f minP = Vector3f(cp)*Chunk::size;
+      if(cp == camChunk || buffer.boxVisible(minP, minP + Vector3f(Chunk::size)))
+        { visible[numVisible++] = hash; }
+    }
+  visible.resize(numVisible);
+}
@@ -7,6 +7,7 @@
 #include "meshData.hpp"
 #include "world.hpp"
 #include "pointMath.hpp"
+#include "taskExecutor.hpp"
 
 #include <unordered_set>
 
@@ -209,7 +210,7 @@ std::unordered_map<int32_t, bool> FluidManager::step(float evapRate)
               if(boundsNZ)
                 {
                   boundsNZ->lock();
-                  bNZ = boundsNZ->getBlock(Hash::hash(nzbp));
+                  bNZ = boundsNZ->getBlock(nzbp);
                   boundsNZ->unlock();
                 }
               Point3i pzp = wp + Vector3i{0,0,1};
@@ -221,7 +222,7 @@ std::unordered_map<int32_t, bool> FluidManager::step(float evapRate)
               if(boundsPZ)
                 {
                   boundsPZ->lock();
-                  bPZ = boundsPZ->getBlock(Hash::hash(pzbp));
+                  bPZ = boundsPZ->getBlock(pzbp);
                   boundsPZ->unlock();
                 }
               bool fluidFull = false;
@@ -312,7 +313,7 @@ std::unordered_map<int32_t, bool> FluidManager::step(float evapRate)
                       if(sbounds)
                         {
                           sbounds->lock();
-                          sblock = sbounds->getBlock(Hash::hash(sbp));
+                          sblock = sbounds->getBlock(sbp);
                           sbounds->unlock();
                         }
 
@@ -345,7 +346,7 @@ std::unordered_map<int32_t, bool> FluidManager::step(float evapRate)
                               if(snzbounds)
                                 {
                                   snzbounds->lock();
-                                  snzblock = snzbounds->getBlock(Hash::hash(snzbp));
+                                  snzblock = snzbounds->getBlock(snzbp);
                                   snzbounds->unlock();
                                 }
                               if(!snzblock)
@@ -404,11 +405,15 @@ std::unordered_map<int32_t, bool> FluidManager::step(float evapRate)
       mMeshData[c] = nullptr;
     }
     
-  for(auto iter : updates)
-    {
-      if(iter.second)
-        { makeMesh(iter.first); }
-    }
+  { // mesh updated chunks in parallel
+    TaskGroup meshTasks(mExecutor);
+    for(auto iter : updates)
+      {
+        if(iter.second)
+          { meshTasks.submit(std::bind(&FluidManager::makeMesh, this, iter.first)); }
+      }
+    meshTasks.wait();
+  }
   
   for(auto &cIter : mFluids)
     {
@@ -619,7 +624,7 @@ void FluidManager::makeMesh(int32_t hash)
     { return; }
   
   bounds->lock();
-  auto shell = bounds->getBounds();
+  std::vector<ActiveBlock> shell = bounds->getFaces();
   bounds->unlock();
   
   Point3i cp = chunk->pos();
@@ -641,7 +646,7 @@ void FluidManager::makeMesh(int32_t hash)
                 {
                   Vector3i sdir = sideDirections[(int)r.dir];
                   int dim = sideDim(r.dir);
-                  auto iter = shell.find(Hash::hash(bp + sdir));
+                  const ActiveBlock *sblock = ChunkBounds::find(shell, bp + sdir);
                   bool draw = true;
                   for(auto &v : faceVertices[r.dir])
                     { // add vertices for this face
@@ -652,9 +657,9 @@ void FluidManager::makeMesh(int32_t hash)
                         }
                     }
 
-                  if(!draw && iter != shell.end() &&
-                     iter->second.block != block_t::NONE &&
-                     (iter->second.sides & oppositeSide(r.dir)) != blockSide_t::NONE)
+                  if(!draw && sblock &&
+                     sblock->block != block_t::NONE &&
+                     (sblock->sides & oppositeSide(r.dir)) != blockSide_t::NONE)
                     { continue; }
                       
                   const unsigned int numVert = mesh->vertices().size();
@@ -450,6 +450,7 @@ void Player::update(double dt)
   static Point3i lastChunkPos = chunkPos;
   if(chunkPos != lastChunkPos)
     {
+      mWorld->setVelocity(mVel);
       mWorld->setCenter(chunkPos);
       lastChunkPos = chunkPos;
     }
@@ -1,18 +1,23 @@
 #include "regionFile.hpp"
 
-#include "fluid.hpp"
-
 #include <sstream>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
+#include <algorithm>
 
 RegionFile::RegionFile(const std::string &filePath, const Vector<uint8_t, 4> &version,
                          bool create )
   : mFilePath(filePath), mVersion(version)
 {
+  for(int i = 0; i < CHUNKS_PER_REGION; i++)
+    {
+      mChunkStatus[i].store(false);
+      mPrefetched[i].store(false);
+    }
+  
   bool success;
   if(create)
     { success = createRegion(); }
@@ -22,7 +27,7 @@ RegionFile::RegionFile(const std::string &filePath, const Vector<uint8_t, 4> &ve
   if(!success)
     {
       LOGE("Region file failed!");
-      exit(1);
+      close();
     }
   
   calRegionPos();
@@ -37,14 +42,18 @@ void RegionFile::close()
 {
   std::lock_guard<std::mutex> lock(mMapLock);
   LOGD("UNMAPPING REGION FILE MEMORY...");
-  if(munmap(mFileData, mFileSize) < 0)
+  if(mFileData)
     {
-      LOGE("Failed to close region file!");
+      msync(mFileData, mFileSize, MS_SYNC);
+      if(munmap(mFileData, mFileSize) < 0)
+        { LOGE("Failed to close region file!"); }
+      mFileData = nullptr;
     }
-    LOGD("CLOSING FD...");
+  LOGD("CLOSING FD...");
   if(mFd >= 0)
     { ::close(mFd); }
-    LOGD("DONE");
+  mFd = -1;
+  LOGD("DONE");
 }
 
 bool RegionFile::openFile()
@@ -98,9 +107,8 @@ bool RegionFile::createFile()
       return false;
     }
 
-  // initial file sizing (header + lookup + room for one chunk)
-  mFileSize = (sizeof(wData::Header) + sizeof(wData::ChunkInfo) * CHUNKS_PER_REGION +
-               Chunk::totalSize * (Block::dataSize+Fluid::dataSize) );
+  // initial file sizing (header + lookup + room for a few chunks)
+  mFileSize = dataStart() + REGION_GROW_BYTES;
   if(ftruncate(mFd, mFileSize) < 0)
     {
       ::close(mFd);
@@ -121,29 +129,41 @@ bool RegionFile::createFile()
   return true;
 }
 
-bool RegionFile::resizeFile(int extraBytes)
-{
-  std::lock_guard<std::mutex> lock(mMapLock);
-  if(ftruncate(mFd, mFileSize + extraBytes) < 0)
+bool RegionFile::resizeFile(size_t newSize)
+{ // NOTE: mMapLock must be held by caller
+  if(newSize == mFileSize)
+    { return true; }
+  if(mFileData && munmap(mFileData, mFileSize) < 0)
+    { LOGE("Failed to unmap region file memory. Error: %d.", errno); }
+  mFileData = nullptr;
+  
+  if(ftruncate(mFd, newSize) < 0)
     {
       LOGE("Failed to resize region file!");
-      return false;
+      newSize = mFileSize; // remap at old size
     }
-  fsync(mFd); // flush
-
-  { // resize file
-    //std::lock_guard<std::mutex> lock(mMapLock);
-    mFileData = (uint8_t*)mmap(0, mFileSize + extraBytes, PROT_READ | PROT_WRITE,
-                               MAP_SHARED, mFd, 0 );
-    if(mFileData == MAP_FAILED)
-      {
-        LOGE("Failed to remap region file memory. Error: %d.", errno);
-        return false; // TODO: File broken?
-      }
-    mFileSize += extraBytes;
-    return true;
-  }
+  mFileData = (uint8_t*)mmap(0, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+  if(mFileData == MAP_FAILED)
+    {
+      LOGE("Failed to remap region file memory. Error: %d.", errno);
+      mFileData = nullptr;
+      mFileSize = 0;
+      return false; // TODO: File broken?
+    }
+  const bool resized = (newSize != mFileSize);
+  mFileSize = newSize;
+  return resized;
 }
+bool RegionFile::growFile(size_t minSize)
+{ // NOTE: mMapLock must be held by caller
+  if(minSize <= mFileSize)
+    { return true; }
+  // grow geometrically so appending chunks doesn't remap every write
+  const size_t newSize = sectorAlign(std::max(minSize, mFileSize + std::max((size_t)REGION_GROW_BYTES,
+                                                                            mFileSize / 4 )));
+  return resizeFile(newSize);
+}
+
 bool RegionFile::readRegion()
 {
   if(!openFile())
@@ -158,12 +178,7 @@ bool RegionFile::readRegion()
     }
   readOffset();
   readLookup();
-  for(auto &d : mChunkInfo)
-    {
-      //if(d.chunkSize != 0)
-      //{ std::cout << "Found chunk: " << d.offset << " | " << d.chunkSize << "\n"; }
-    }
-  
+  buildFreeList();
   return true;
 }
 
@@ -173,7 +188,7 @@ bool RegionFile::createRegion()
   if(!createFile())
     { return false; }
 
-  mNextOffset.store(sizeof(wData::Header) + sizeof(wData::ChunkInfo) * CHUNKS_PER_REGION);
+  mNextOffset.store(dataStart());
   writeVersion();
   writeOffset();
 
@@ -181,6 +196,8 @@ bool RegionFile::createRegion()
 
   std::fill(mChunkInfo.begin(), mChunkInfo.end(), wData::ChunkInfo{0, 0});
   writeLookup();
+  mChunkCapacity.fill(0);
+  mFreeList.clear();
 
   return true;
 }
@@ -189,27 +206,45 @@ bool RegionFile::createRegion()
 bool RegionFile::readChunk(Chunk *chunk)
 {
   const Point3i chunkPos = chunk->pos();
-  //std::cout << "READING CHUNK: " << chunkPos << "\n";
   const Point3i cPos{chunkPos[0] & (15),
                      chunkPos[1] & (15),
                      chunkPos[2] & (15) };
   const uint16_t cIndex = chunkIndex(cPos);
-  //std::cout << "Chunk index: " << cIndex << " : " << cPos << "\n";
 
   if(!mChunkStatus[cIndex].exchange(true))
     {
       mChunkData[cIndex].clear();
-
-      if(mChunkInfo[cIndex].chunkSize != 0)
-        { // read chunk data
-          mChunkData[cIndex].resize(mChunkInfo[cIndex].chunkSize);
-          readChunkData(cIndex);
-          //LOGD("READING CHUNK (size: %d)", mChunkInfo[cIndex].chunkSize);
+      {
+        std::lock_guard<std::mutex> lock(mMapLock);
+        if(!mFileData || (!isUniformRecord(mChunkInfo[cIndex]) &&
+                          mChunkInfo[cIndex].offset + mChunkInfo[cIndex].chunkSize > mFileSize ))
+          { // file isn't mapped (remapping failed) -- can't read
+            LOGE("Region file not mapped -- can't read chunk!");
+            mChunkStatus[cIndex].store(false);
+            return false;
+          }
+        else if(isUniformRecord(mChunkInfo[cIndex]))
+          { // no data to read
+            chunk->setUniform((block_t)(mChunkInfo[cIndex].offset & 0xFF));
+            mChunkStatus[cIndex].store(false);
+            return true;
+          }
+        else if(mChunkInfo[cIndex].chunkSize != 0)
+          { // read chunk data
+            if(mPrefetched[cIndex].exchange(false))
+              { mPrefetchHits++; }
+            else
+              { mPrefetchMisses++; }
+            mChunkData[cIndex].resize(mChunkInfo[cIndex].chunkSize);
+            readChunkData(cIndex);
+          }
+      }
       
-          // deserialize chunk
-          chunk->deserialize(mChunkData[cIndex]);
+      if(mChunkData[cIndex].size() > 0)
+        { // deserialize chunk (legacy raw or compressed format)
+          const bool success = chunk->deserialize(mChunkData[cIndex]);
           mChunkStatus[cIndex].store(false);
-          return true;
+          return success;
         }
       else // chunk not created yet
         {
@@ -222,60 +257,251 @@ bool RegionFile::readChunk(Chunk *chunk)
 
 bool RegionFile::writeChunk(const Chunk *chunk)
 {
-  //std::lock_guard<std::mutex> lock(mMapLock);
-  const Point3i chunkPos = chunk->pos();
-  //std::cout << "WRITING CHUNK: " << chunkPos << "\n";
-  const Point3i cPos{chunkPos[0] & (15),
-                     chunkPos[1] & (15),
-                     chunkPos[2] & (15) };
-  const uint16_t cIndex = chunkIndex(cPos);
-  //std::cout << "Chunk index: " << cIndex << " : " << cPos << "\n";
-  
-  if(!mChunkStatus[cIndex].exchange(true))
+  std::vector<std::pair<Point3i, std::vector<uint8_t>>> batch(1);
+  batch[0].first = chunk->pos();
+  chunk->serialize(batch[0].second);
+  return (writeChunks(batch) == 1);
+}
+
+int RegionFile::writeChunks(const std::vector<std::pair<Point3i, std::vector<uint8_t>>> &chunks,
+                            std::vector<int> *failedOut )
+{
+  std::lock_guard<std::mutex> lock(mMapLock);
+  if(!mFileData)
     {
-      // get chunk data
-      mChunkData[cIndex].clear();
-      const int dataSize = chunk->serialize(mChunkData[cIndex]); // max chunk size
+      if(failedOut)
+        {
+          for(int i = 0; i < (int)chunks.size(); i++)
+            { failedOut->push_back(i); }
+        }
+      return 0;
+    }
   
-      if(mChunkInfo[cIndex].chunkSize == 0)
-        { // add chunk to end of file
-          mHeader.nextOffset = mNextOffset.load();
-          mChunkInfo[cIndex].offset = mHeader.nextOffset;
-          mChunkInfo[cIndex].chunkSize = dataSize;
+  // grow file once for any chunks that need a new slot
+  size_t needed = 0;
+  for(auto &c : chunks)
+    {
+      const int cIndex = chunkIndex(Point3i{c.first[0] & 15, c.first[1] & 15, c.first[2] & 15});
+      if(!Chunk::isUniformData(c.second) && c.second.size() > mChunkCapacity[cIndex])
+        { needed += sectorAlign(c.second.size()); }
+    }
+  if(needed > mFreeBytes)
+    { growFile(sectorAlign(mNextOffset.load()) + needed); }
 
-          LOGD("NEXT OFFSET: %d", mHeader.nextOffset);
+  int written = 0;
+  for(int i = 0; i < (int)chunks.size(); i++)
+    {
+      const Point3i &cp = chunks[i].first;
+      const int cIndex = chunkIndex(Point3i{cp[0] & 15, cp[1] & 15, cp[2] & 15});
+      if(writeSlot(cIndex, chunks[i].second))
+        { written++; }
+      else if(failedOut)
+        { failedOut->push_back(i); }
+    }
+  writeOffset();
+  msync(mFileData, mFileSize, MS_ASYNC);
+  return written;
+}
+
+bool RegionFile::writeSlot(int cIndex, const std::vector<uint8_t> &data)
+{ // NOTE: mMapLock must be held by caller
+  if(Chunk::isUniformData(data))
+    { // zero-byte record -- type is stored in the lookup
+      if(mChunkCapacity[cIndex] > 0)
+        { release(mChunkInfo[cIndex].offset, mChunkCapacity[cIndex]); }
+      mChunkCapacity[cIndex] = 0;
+      mChunkInfo[cIndex].offset = CHUNK_UNIFORM_OFFSET | data[1];
+      mChunkInfo[cIndex].chunkSize = 0;
+      writeLookup(cIndex);
+      return true;
+    }
   
-          LOGD("Writing to offset %d (%d bytes)", mChunkInfo[cIndex].offset, mChunkInfo[cIndex].chunkSize);
-          // overwrite chunk
-          LOGD("Writing lookup data...");
-          writeLookup(cIndex);
-          LOGD("Writing chunk data...");
-          writeChunkData(cIndex);
-      
-          mNextOffset.store(mHeader.nextOffset + dataSize);
-          LOGD("Next offset: %d", mHeader.nextOffset + dataSize);
-          writeOffset();
-      
-          if(!resizeFile(dataSize))
-            { 
-              mChunkStatus[cIndex].store(false);
-              return false;
-            }
+  const uint32_t dataSize = data.size();
+  if(dataSize > mChunkCapacity[cIndex])
+    { // chunk doesn't fit in its slot -- relocate
+      const uint32_t capacity = sectorAlign(dataSize);
+      const uint32_t offset = allocate(capacity);
+      if(offset == 0)
+        {
+          LOGE("Failed to allocate %d bytes in region file!", dataSize);
+          return false;
         }
+      if(mChunkCapacity[cIndex] > 0)
+        { release(mChunkInfo[cIndex].offset, mChunkCapacity[cIndex]); }
+      mChunkInfo[cIndex].offset = offset;
+      mChunkCapacity[cIndex] = capacity;
+    }
+  // write chunk data before updating lookup
+  std::memcpy((void*)(mFileData + mChunkInfo[cIndex].offset), (void*)data.data(), dataSize);
+  mChunkInfo[cIndex].chunkSize = dataSize;
+  writeLookup(cIndex);
+  return true;
+}
+
+int RegionFile::prefetch(const std::vector<int> &chunkIndices)
+{
+  // collect page ranges of chunks that haven't been prefetched yet
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  std::vector<std::pair<size_t, size_t>> ranges;
+  std::lock_guard<std::mutex> lock(mMapLock);
+  if(!mFileData)
+    { return 0; }
+  for(auto i : chunkIndices)
+    {
+      if(mChunkInfo[i].chunkSize != 0 && !mPrefetched[i].exchange(true))
+        {
+          const size_t start = (mChunkInfo[i].offset / pageSize) * pageSize;
+          const size_t end = mChunkInfo[i].offset + mChunkInfo[i].chunkSize;
+          ranges.emplace_back(start, end);
+        }
+    }
+  if(ranges.size() == 0)
+    { return 0; }
+
+  // merge overlapping/adjacent ranges and advise
+  std::sort(ranges.begin(), ranges.end());
+  std::pair<size_t, size_t> current = ranges[0];
+  for(int i = 1; i <= ranges.size(); i++)
+    {
+      if(i < ranges.size() && ranges[i].first <= current.second + pageSize)
+        { current.second = std::max(current.second, ranges[i].second); }
       else
         {
-          mChunkInfo[cIndex].chunkSize = dataSize;
-          //LOGD("Writing to offset %d (%d bytes)", mChunkInfo[cIndex].offset, mChunkInfo[cIndex].chunkSize);
-          // overwrite chunk
-          //LOGD("Writing lookup data...");
-          writeLookup(cIndex);
-          //LOGD("Writing chunk data...");
-          writeChunkData(cIndex);
+          if(madvise(mFileData + current.first, current.second - current.first, MADV_WILLNEED) < 0)
+            { LOGW("madvise() failed on region file. Error: %d.", errno); }
+          if(i < ranges.size())
+            { current = ranges[i]; }
+        }
+    }
+  return ranges.size();
+}
+
+uint32_t RegionFile::allocate(uint32_t capacity)
+{ // NOTE: mMapLock must be held by caller
+  // first fit from free list
+  for(auto iter = mFreeList.begin(); iter != mFreeList.end(); iter++)
+    {
+      if(iter->second >= capacity)
+        {
+          const uint32_t offset = iter->first;
+          const uint32_t remaining = iter->second - capacity;
+          mFreeList.erase(iter);
+          if(remaining > 0)
+            { mFreeList.emplace(offset + capacity, remaining); }
+          mFreeBytes -= capacity;
+          return offset;
         }
-      mChunkStatus[cIndex].store(false);
-  }
+    }
+  // append to end of file
+  const uint32_t offset = sectorAlign(mNextOffset.load());
+  if(!growFile(offset + capacity))
+    { return 0; }
+  mNextOffset.store(offset + capacity);
+  return offset;
+}
+
+void RegionFile::release(uint32_t offset, uint32_t capacity)
+{ // NOTE: mMapLock must be held by caller
+  if(offset + capacity >= mNextOffset.load())
+    { // last slot in file -- shrink used space instead (merge with any free space before it)
+      auto prev = mFreeList.lower_bound(offset);
+      if(prev != mFreeList.begin() && (--prev)->first + prev->second == offset)
+        {
+          offset = prev->first;
+          mFreeBytes -= prev->second;
+          mFreeList.erase(prev);
+        }
+      mNextOffset.store(offset);
+      return;
+    }
   
-  return true;
+  auto next = mFreeList.lower_bound(offset);
+  if(next != mFreeList.end() && offset + capacity == next->first)
+    { // merge with next free extent
+      capacity += next->second;
+      mFreeBytes -= next->second;
+      next = mFreeList.erase(next);
+    }
+  if(next != mFreeList.begin())
+    { // merge with previous free extent
+      auto prev = std::prev(next);
+      if(prev->first + prev->second == offset)
+        {
+          prev->second += capacity;
+          mFreeBytes += capacity;
+          return;
+        }
+    }
+  mFreeList.emplace(offset, capacity);
+  mFreeBytes += capacity;
+}
+
+void RegionFile::buildFreeList()
+{
+  // sort used slots by offset
+  std::vector<int> used;
+  for(int i = 0; i < CHUNKS_PER_REGION; i++)
+    {
+      if(mChunkInfo[i].chunkSize != 0)
+        { used.push_back(i); }
+    }
+  std::sort(used.begin(), used.end(), [this](int a, int b)
+                                      { return mChunkInfo[a].offset < mChunkInfo[b].offset; });
+
+  // each slot's capacity extends to the next slot (or end of data), up to its aligned size
+  mChunkCapacity.fill(0);
+  mFreeList.clear();
+  mFreeBytes = 0;
+  uint32_t lastEnd = dataStart();
+  for(int j = 0; j < used.size(); j++)
+    {
+      const uint32_t offset = mChunkInfo[used[j]].offset;
+      const uint32_t size = mChunkInfo[used[j]].chunkSize;
+      const uint32_t end = (j+1 < used.size() ? mChunkInfo[used[j+1]].offset : mNextOffset.load());
+      if(offset > lastEnd)
+        { release(lastEnd, offset - lastEnd); }
+      mChunkCapacity[used[j]] = std::max(size, std::min(sectorAlign(size), end - offset));
+      lastEnd = offset + mChunkCapacity[used[j]];
+    }
+  if(lastEnd < mNextOffset.load())
+    { mNextOffset.store(lastEnd); }
+}
+
+size_t RegionFile::compact()
+{
+  std::lock_guard<std::mutex> lock(mMapLock);
+  std::vector<int> used;
+  for(int i = 0; i < CHUNKS_PER_REGION; i++)
+    {
+      if(mChunkInfo[i].chunkSize != 0)
+        { used.push_back(i); }
+    }
+  std::sort(used.begin(), used.end(), [this](int a, int b)
+                                      { return mChunkInfo[a].offset < mChunkInfo[b].offset; });
+
+  // slide each chunk down to the lowest free position
+  uint32_t next = dataStart();
+  for(auto i : used)
+    {
+      wData::ChunkInfo &info = mChunkInfo[i];
+      if(info.offset > next)
+        {
+          std::memmove((void*)(mFileData + next), (void*)(mFileData + info.offset), info.chunkSize);
+          info.offset = next;
+        }
+      mChunkCapacity[i] = sectorAlign(info.chunkSize);
+      next = info.offset + mChunkCapacity[i];
+    }
+  writeLookup();
+  
+  const size_t oldSize = mFileSize;
+  mFreeList.clear();
+  mFreeBytes = 0;
+  mNextOffset.store(next);
+  writeOffset();
+  resizeFile(std::max((size_t)next, dataStart()));
+  msync(mFileData, mFileSize, MS_SYNC);
+  return (oldSize > mFileSize ? oldSize - mFileSize : 0);
 }
 
 std::string RegionFile::regionFileName(const Point3i &regionPos)
@@ -309,9 +535,9 @@ void RegionFile::calRegionPos()
 }
 
 
-inline int RegionFile::chunkIndex(int bx, int by, int bz)
+int RegionFile::chunkIndex(int bx, int by, int bz)
 { return bx + REGION_SIZEX * (bz + REGION_SIZEZ * by); }
-inline int RegionFile::chunkIndex(const Point3i cp)
+int RegionFile::chunkIndex(const Point3i cp)
 { return chunkIndex(cp[0], cp[1], cp[2]); }
 inline Point3i RegionFile::unflattenChunkIndex(int index)
 {
@@ -371,9 +597,3 @@ inline void RegionFile::readChunkData(int chunkIndex)
   std::memcpy((void*)&mChunkData[chunkIndex][0], (void*)(mFileData + mChunkInfo[chunkIndex].offset),
               mChunkInfo[chunkIndex].chunkSize );
 }
-inline void RegionFile::writeChunkData(int chunkIndex)
-{
-  //std::cout << "Writing chunk at: " << mChunkInfo[chunkIndex].offset << " (" << mChunkInfo[chunkIndex].chunkSize  << " bytes)\n";
-  std::memcpy((void*)(mFileData + mChunkInfo[chunkIndex].offset),
-                (void*)&mChunkData[chunkIndex][0], mChunkInfo[chunkIndex].chunkSize );
-}
@@ -5,14 +5,83 @@
 #include <algorithm>
 
 
-// NOTE: For performance, check out https://github.com/Auburns/FastNoiseSIMD
+void TerrainGenerator::NoiseGrid::fill(const float *ax, const float *ay, const float *az)
+{
+  int bi = 0;
+  for(int y = 0; y < Chunk::sizeY; y++)
+    for(int z = 0; z < Chunk::sizeZ; z++)
+      for(int x = 0; x < Chunk::sizeX; x++, bi++)
+        {
+          this->x[bi] = ax[x];
+          this->y[bi] = ay[y];
+          this->z[bi] = az[z];
+        }
+}
+
+bool TerrainGenerator::uniformChunk(const Point3i &chunkPos, terrain_t genType, block_t &blockOut)
+{
+  const int minZ = chunkPos[2]*Chunk::sizeZ;
+  const int maxZ = minZ + Chunk::sizeZ - 1;
+  const double B = SimplexBatch::bound;
+  switch(genType)
+    {
+    case terrain_t::DIRT_GROUND:
+      if(minZ >= 4)
+        { blockOut = block_t::NONE; return true; }
+      else if(maxZ < 4)
+        { blockOut = block_t::DIRT; return true; }
+      break;
+    case terrain_t::PERLIN_WORLD:
+      { // n = 100*n0 - 3*wz - 1000*|n2|*(0.5+n1)  (wz = 12*z)
+        const double nMax = 100*B + 1000*B*std::max(0.0, B - 0.5);
+        const double nMin = -100*B - 1000*B*(0.5 + B);
+        // (extra margin of 1 for float rounding)
+        if(nMax - 3.0*(minZ*4*3) < -1.0)
+          { blockOut = block_t::NONE; return true; }
+        else if(nMin - 3.0*(maxZ*4*3) >= 150.0 + 1.0)
+          { blockOut = block_t::STONE; return true; }
+      }
+      break;
+    case terrain_t::PERLIN:
+      { // n = 1000*n0 - wz
+        if(1000*B - minZ < -1.0)
+          { blockOut = block_t::NONE; return true; }
+        else if(-1000*B - maxZ >= 150.0 + 1.0)
+          { blockOut = block_t::STONE; return true; }
+      }
+      break;
+    case terrain_t::TEST:
+      blockOut = ((((chunkPos[0]) % 4) == 0 || chunkPos[1] % 4 == 0) && std::abs(chunkPos[0]) % 4 != 2 ? block_t::NONE : block_t::STONE);
+      return true;
+    default:
+      break;
+    }
+  return false;
+}
+
 void TerrainGenerator::generate(const Point3i &chunkPos, terrain_t genType,
                                 std::vector<uint8_t> &dataOut )
 {
-  dataOut.resize(Chunk::totalSize * Block::dataSize);
+  // noise for the whole chunk is evaluated in batches (SIMD) before blocks are classified
+  static thread_local NoiseGrid grid0;
+  static thread_local NoiseGrid grid1;
+  static thread_local NoiseGrid grid2;
+  // each noise input only depends on one axis -- computed per axis, then expanded
+  float ax[3][Chunk::sizeX];
+  float ay[3][Chunk::sizeY];
+  float az[3][Chunk::sizeZ];
+
   block_t b;
   int x,y,z;
   int bi = 0;
+
+  if(uniformChunk(chunkPos, genType, b))
+    { // entirely above/below the terrain (no block data)
+      Chunk::serializeUniform(b, dataOut);
+      return;
+    }
+  dataOut.resize(Chunk::totalSize * Block::dataSize);
+
   switch(genType)
     {
     case terrain_t::DIRT_GROUND:
@@ -26,26 +95,45 @@ void TerrainGenerator::generate(const Point3i &chunkPos, terrain_t genType,
               //b.serialize(&dataOut[i*Block::dataSize]);
               std::memcpy((void*)&dataOut[i*Block::dataSize], (void*)&b, Block::dataSize);
             }
-      break;              
+      break;
     case terrain_t::PERLIN_WORLD:
-      mNoise.SetFrequency(1.0);
-      mNoise.SetNoiseType(FastNoise::Simplex);
-      
+      for(int i = 0; i < Chunk::sizeX; i++)
+        {
+          const int wx = (chunkPos[0]*Chunk::sizeX + i)*4;
+          const int wy = (chunkPos[1]*Chunk::sizeY + i)*4;
+          const int wz = (chunkPos[2]*Chunk::sizeZ + i)*4*3;
+          ax[0][i] = (float)wx/Chunk::sizeX;
+          ay[0][i] = (float)wy/Chunk::sizeY;
+          az[0][i] = (float)wz/Chunk::sizeZ;
+          ax[1][i] = (float)wx/Chunk::sizeX/8.0;
+          ay[1][i] = (float)wy/Chunk::sizeY/8.0;
+          az[1][i] = (float)wz/Chunk::sizeZ/8.0;
+          ax[2][i] = (float)wx/Chunk::sizeX/16.0;
+          ay[2][i] = (float)wy/Chunk::sizeY/16.0;
+          az[2][i] = (float)wz/Chunk::sizeZ/8.0;
+        }
+      grid0.resize(Chunk::totalSize);
+      grid1.resize(Chunk::totalSize);
+      grid2.resize(Chunk::totalSize);
+      grid0.fill(ax[0], ay[0], az[0]);
+      grid1.fill(ax[1], ay[1], az[1]);
+      grid2.fill(ax[2], ay[2], az[2]);
+      mNoise.eval(grid0.x.data(), grid0.y.data(), grid0.z.data(), grid0.n.data(), Chunk::totalSize);
+      mNoise.eval(grid1.x.data(), grid1.y.data(), grid1.z.data(), grid1.n.data(), Chunk::totalSize);
+      mNoise.eval(grid2.x.data(), grid2.y.data(), grid2.z.data(), grid2.n.data(), Chunk::totalSize);
+
       for(y = 0; y < Chunk::sizeY; y++)
         for(z = 0; z < Chunk::sizeZ; z++)
           for(x = 0; x < Chunk::sizeX; x++, bi++)
             {
-              Point3i worldPos = Point3i{chunkPos[0]*Chunk::sizeX+x, chunkPos[1]*Chunk::sizeY + y, chunkPos[2]*Chunk::sizeZ + z}*4;
-              //if(worldPos[2] > 64)
-              //{ continue; }
-              worldPos[2]*=3;
-              float n0 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX, (float)worldPos[1]/Chunk::sizeY, (float)worldPos[2]/Chunk::sizeZ);
-              float n1 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX/8.0, (float)worldPos[1]/Chunk::sizeY/8.0, (float)worldPos[2]/Chunk::sizeZ/8.0);
-              float n2 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX/16.0, (float)worldPos[1]/Chunk::sizeY/16.0, (float)worldPos[2]/Chunk::sizeZ/8.0);
-
-              float n = 100*n0 - 3.0*(worldPos[2]) - 1000*std::abs(n2)*(0.5+n1);
+              const int wz = (chunkPos[2]*Chunk::sizeZ + z)*4*3;
+              float n0 = grid0.n[bi];
+              float n1 = grid1.n[bi];
+              float n2 = grid2.n[bi];
+
+              float n = 100*n0 - 3.0*(wz) - 1000*std::abs(n2)*(0.5+n1);
               float nn = 10*n1;
-              
+
               if(n < 0)
                 { b = block_t::NONE; }
               else if(n < 75.0)
@@ -57,26 +145,39 @@ void TerrainGenerator::generate(const Point3i &chunkPos, terrain_t genType,
               else
                 { b = block_t::STONE; }
 
-              //if(b.type != block_t::NONE)
-              ///{ LOGD("GENERATED BLOCK --> %d", (int)b.type); }
-              
               std::memcpy((void*)&dataOut[bi*Block::dataSize], (void*)&b, Block::dataSize);
             }
       break;
     case terrain_t::PERLIN:
-      mNoise.SetFrequency(1.0);
-      mNoise.SetNoiseType(FastNoise::Simplex);
+      for(int i = 0; i < Chunk::sizeX; i++)
+        {
+          const int wx = chunkPos[0]*Chunk::sizeX + i;
+          const int wy = chunkPos[1]*Chunk::sizeY + i;
+          const int wz = chunkPos[2]*Chunk::sizeZ + i;
+          ax[0][i] = (float)wx/Chunk::sizeX;
+          ay[0][i] = (float)wy/Chunk::sizeY;
+          az[0][i] = (float)wz/Chunk::sizeZ;
+          ax[1][i] = (float)wx/Chunk::sizeX/8.0;
+          ay[1][i] = (float)wy/Chunk::sizeY/8.0;
+          az[1][i] = (float)wz/Chunk::sizeZ/8.0;
+        }
+      grid0.resize(Chunk::totalSize);
+      grid1.resize(Chunk::totalSize);
+      grid0.fill(ax[0], ay[0], az[0]);
+      grid1.fill(ax[1], ay[1], az[1]);
+      mNoise.eval(grid0.x.data(), grid0.y.data(), grid0.z.data(), grid0.n.data(), Chunk::totalSize);
+      mNoise.eval(grid1.x.data(), grid1.y.data(), grid1.z.data(), grid1.n.data(), Chunk::totalSize);
+
       for(y = 0; y < Chunk::sizeY; y++)
         for(z = 0; z < Chunk::sizeZ; z++)
           for(x = 0; x < Chunk::sizeX; x++, bi++)
             {
-              Point3i worldPos = Point3i{chunkPos[0]*Chunk::sizeX+x, chunkPos[1]*Chunk::sizeY+y, chunkPos[2]*Chunk::sizeZ+z};
-              float n0 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX, (float)worldPos[1]/Chunk::sizeY, (float)worldPos[2]/Chunk::sizeZ);
-              //mNoise.SetFrequency(1.0);
-              float n1 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX/8.0, (float)worldPos[1]/Chunk::sizeY/8.0, (float)worldPos[2]/Chunk::sizeZ/8.0);
+              const int wz = chunkPos[2]*Chunk::sizeZ + z;
+              float n0 = grid0.n[bi];
+              float n1 = grid1.n[bi];
+
+              float n = 1000*n0 - wz;
 
-              float n = 1000*n0 - worldPos[2];
-              
               if(n < 0)
                 { b = block_t::NONE; }
               else if(n < 75.0)
@@ -87,47 +188,41 @@ void TerrainGenerator::generate(const Point3i &chunkPos, terrain_t genType,
               else
                 { b = block_t::STONE; }
 
-              //if(b.type != block_t::NONE)
-              //{ LOGD("GENERATED BLOCK --> %d", (int)b.type); }
-              
               std::memcpy((void*)&dataOut[bi*Block::dataSize], (void*)&b, Block::dataSize);
             }
       break;
     case terrain_t::PERLIN_CAVES:
-      mNoise.SetFrequency(1.0);
-      mNoise.SetNoiseType(FastNoise::Simplex);
-      for(y = 0; y < Chunk::sizeY; y++)
-        for(z = 0; z < Chunk::sizeZ; z++)
-          for(x = 0; x < Chunk::sizeX; x++, bi++)
-            {
-              Point3i worldPos = Point3i{chunkPos[0]*Chunk::sizeX+x, chunkPos[1]*Chunk::sizeY+y, chunkPos[2]*Chunk::sizeZ+z};
-              float n0 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX, (float)worldPos[1]/Chunk::sizeY, (float)worldPos[2]/Chunk::sizeZ);
-              float n1 = mNoise.GetNoise((float)worldPos[0]/Chunk::sizeX, (float)worldPos[1]/Chunk::sizeY, (float)worldPos[2]/Chunk::sizeZ*n0);
+      for(int i = 0; i < Chunk::sizeX; i++)
+        {
+          ax[0][i] = (float)(chunkPos[0]*Chunk::sizeX + i)/Chunk::sizeX;
+          ay[0][i] = (float)(chunkPos[1]*Chunk::sizeY + i)/Chunk::sizeY;
+          az[0][i] = (float)(chunkPos[2]*Chunk::sizeZ + i)/Chunk::sizeZ;
+        }
+      grid0.resize(Chunk::totalSize);
+      grid1.resize(Chunk::totalSize);
+      grid0.fill(ax[0], ay[0], az[0]);
+      mNoise.eval(grid0.x.data(), grid0.y.data(), grid0.z.data(), grid0.n.data(), Chunk::totalSize);
+      // (second noise is warped by the first)
+      for(bi = 0; bi < Chunk::totalSize; bi++)
+        { grid1.z[bi] = grid0.z[bi]*grid0.n[bi]; }
+      mNoise.eval(grid0.x.data(), grid0.y.data(), grid1.z.data(), grid1.n.data(), Chunk::totalSize);
 
-              float n = 0.1 - n1*n1;
-              
-              if(std::abs(n) < 0.01)
-                { b = block_t::STONE; }
-              //else if(n < 75.0)
-                //  { b = block_t::GRASS; }
-                //{ b = ((n1 > 0 || n1 < -100.0) ? block_t::GRASS : block_t::SAND); }
-              else if(n < 0.05)
-                { b = block_t::DIRT; }
-              else
-                { b = block_t::NONE; }
-              
-              std::memcpy((void*)&dataOut[bi*Block::dataSize], (void*)&b, Block::dataSize);
-            }
+      for(bi = 0; bi < Chunk::totalSize; bi++)
+        {
+          float n1 = grid1.n[bi];
+          float n = 0.1 - n1*n1;
+
+          if(std::abs(n) < 0.01)
+            { b = block_t::STONE; }
+          else if(n < 0.05)
+            { b = block_t::DIRT; }
+          else
+            { b = block_t::NONE; }
+
+          std::memcpy((void*)&dataOut[bi*Block::dataSize], (void*)&b, Block::dataSize);
+        }
       break;
-    case terrain_t::TEST:
-      b = ((((chunkPos[0]) % 4) == 0 || chunkPos[1] % 4 == 0) && std::abs(chunkPos[0]) % 4 != 2 ? block_t::NONE : block_t::STONE);
-      for(y = 0; y < Chunk::sizeY; y++)
-        for(z = 0; z < Chunk::sizeZ; z++)
-          for(x = 0; x < Chunk::sizeX; x++, bi++)
-            {
-              std::memcpy((void*)&dataOut[bi*Block::dataSize], (void*)&b, Block::dataSize);
-            }
+    default: // (TEST is always uniform)
       break;
     }
-  mNoise.SetFrequency(1.0);
 }
@@ -2,6 +2,7 @@
 
 #include "logging.hpp"
 #include "player.hpp"
+#include "epoch.hpp"
 #include <chrono>
 
 VoxelEngine::VoxelEngine(QObject *qParent)
@@ -103,11 +104,13 @@ void VoxelEngine::mainLoop()
 }
 void VoxelEngine::stepBlocks(int us)
 {
+  EpochGuard epoch; // (holds chunk pointers outside the chunk map)
   if(!mPaused)
     { mWorld->step(); }
 }
 void VoxelEngine::stepPhysics(int us)
 {
+  EpochGuard epoch; // (holds chunk pointers outside the chunk map)
   static bool ready = false;
   if(!ready)
     {
@@ -13,6 +13,7 @@
 #include "chunkVisualizer.hpp"
 
 #include <unistd.h>
+#include <sstream>
 #include <random>
 
 
@@ -21,12 +22,14 @@
 
 
 World::World()
-  : mLoader(new ChunkLoader(1, std::bind(&World::chunkLoadCallback,
-                                         this, std::placeholders::_1 ))),
+  : mLoader(new ChunkLoader(std::bind(&World::chunkLoadCallback, this, std::placeholders::_1))),
     mRenderer(new MeshRenderer()), mRayTracer(new RayTracer()),
     mVisualizer(new ChunkVisualizer(Vector2i{512, 512}))
 {
   mChunkMap.setLoader(mLoader);
+  mLoader->setExecutor(&mExecutor);
+  mRenderer->setExecutor(&mExecutor);
+  mFluids.setExecutor(&mExecutor);
   mFluids.setRange(mMinChunk, mMaxChunk);
   mRenderer->setFluids(&mFluids);
   mRenderer->setMap(&mChunkMap);
@@ -43,6 +46,7 @@ World::~World()
 
 void World::start()
 {
+  mExecutor.start();
   mLoader->start();
   mRenderer->startMeshing();
 }
@@ -50,6 +54,9 @@ void World::stop()
 {
   mLoader->stop();
   mRenderer->stopMeshing();
+  mExecutor.stop();
+  if(!mMeshCachePath.empty())
+    { mRenderer->saveMeshCache(mMeshCachePath); }
 }
 
 std::vector<World::Options> World::getWorlds() const
@@ -68,8 +75,11 @@ bool World::worldExists(const std::string &name) const
 }
 void World::updateInfo(const World::Options &opt)
 {
-  mLoader->setThreads(opt.loadThreads);
-  mRenderer->setMeshThreads(opt.meshThreads);
+  mExecutor.setThreads(opt.loadThreads + opt.meshThreads);
+  mRenderer->setGreedyMeshing(opt.greedyMesh);
+  // (mesh cache is saved alongside the world's region files)
+  mRenderer->clearMeshCache();
+  mMeshCachePath = (opt.persistMeshCache ? mLoader->getWorldDir() + MESH_CACHE_FILE : "");
   
   mLoadRadius = opt.chunkRadius;
   mChunkDim = mLoadRadius * 2 + 1;
@@ -122,6 +132,8 @@ bool World::loadWorld(World::Options &opt)
       mPlayerStartPos = mLoader->getPlayerPos();
       opt.playerPos = mPlayerStartPos;
       updateInfo(opt);
+      if(!mMeshCachePath.empty())
+        { mRenderer->loadMeshCache(mMeshCachePath); }
       mPlayerReady = true;
       LOGI("Done loading world.");
       return true;
@@ -314,6 +326,21 @@ bool World::chunkIsEmpty(const Point3i &cp)
   ChunkPtr chunk = mChunkMap[cp];
   return (chunk && chunk->isEmpty());
 }
+bool World::noFaces(Chunk *chunk)
+{
+  if(!chunk->isUniform())
+    { return false; }
+  else if(chunk->uniformType() == block_t::NONE)
+    { return true; }
+  // solid -- hidden if every neighbor is solid too
+  for(auto side : gBlockSides)
+    {
+      ChunkPtr neighbor = mChunkMap[chunk->pos() + sideDirection(side)];
+      if(!neighbor || !neighbor->isUniform() || !isSimpleBlock(neighbor->uniformType()))
+        { return false; }
+    }
+  return true;
+}
 bool World::chunkIsReady(const Point3i &cp)
 {
   /*
@@ -450,6 +477,13 @@ void World::render(const Matrix4 &pvm)
   else
     {
       mRenderer->render(pvm, mCamPos, mResetGL);
+      std::lock_guard<std::mutex> lock(mTeleportLock);
+      if(mTeleported && mRenderer->anyVisible(mTeleportMin, mTeleportMax))
+        { // (first chunk loaded after the teleport was drawn)
+          mTeleported = false;
+          LOGI("Time to first visible chunk: %fs",
+               std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - mTeleportTime).count() );
+        }
     }
   
   //mVisualizer->render();
@@ -497,7 +531,7 @@ void World::render(const Matrix4 &pvm)
 }
 
 #define LOAD_PER_UPDATE 512
-#define SAVES_PER_UPDATE 4
+#define SAVES_PER_UPDATE 64
 
 void World::update()
 {
@@ -607,7 +641,14 @@ void World::update()
               
                   if(chunk->isDirty())
                     { // mesh needs updating
-                      if(ready)
+                      if(ready && noFaces(chunk))
+                        { // (skip the mesher)
+                          chunk->setDirty(false);
+                          chunk->setPriority(false);
+                          chunk->takeDirtySections();
+                          mRenderer->unload(hash);
+                        }
+                      else if(ready)
                         {
                           chunk->setDirty(false);
                           bool priority = chunk->isPriority();
@@ -623,13 +664,16 @@ void World::update()
                         }
                     }
 
-                  // save chunk
-                  if(chunk->needsSave())
+                  // save chunk (snapshot is written in background -- retry next update if queue is full)
+                  if(chunk->needsSave() && saves < SAVES_PER_UPDATE)
                     {
-                      mLoader->save(chunk);
-                      chunk->setNeedSave(false);
-                      if(++saves >= SAVES_PER_UPDATE)
-                        { break; }
+                      if(mLoader->save(chunk))
+                        {
+                          chunk->setNeedSave(false);
+                          saves++;
+                        }
+                      else
+                        { saves = SAVES_PER_UPDATE; }
                     }
                 }
             }
@@ -645,6 +689,11 @@ void World::update()
   if(mUpdateCount >= 2)
     {
       LOGD("Update Time: %f", mUpdateTime / 2 / 1000000000.0f);
+      std::vector<float> util = mExecutor.utilization();
+      std::ostringstream ss;
+      for(auto u : util)
+        { ss << " " << (int)(u*100.0f) << "%"; }
+      LOGD("Executor queue: %d, utilization:%s", mExecutor.queueDepth(), ss.str().c_str());
       mUpdateTime = 0.0;
       mUpdateCount = 0;
     }
@@ -729,7 +778,8 @@ bool World::setBlock(const Point3i &worldPos, block_t type, BlockData *data)
       if((type == block_t::NONE || isSimpleBlock(type)) &&
          chunk->setBlock(Chunk::blockPos(worldPos), type) )
         {
-          mChunkMap.updateAdjacent(chunkPos(worldPos), Chunk::chunkEdge(bp));
+          mChunkMap.updateBlock(worldPos);
+          mRenderer->blockEdited(Hash::hash(cp));
           chunk->updateConnected();
           chunk->setNeedSave(true);
           chunk->setPriority(true);
@@ -740,7 +790,7 @@ bool World::setBlock(const Point3i &worldPos, block_t type, BlockData *data)
         {
           if(mFluids.set(worldPos, reinterpret_cast<Fluid*>(data)))
             {
-              mChunkMap.updateAdjacent(chunkPos(worldPos), Chunk::chunkEdge(bp));
+              mChunkMap.updateBlock(worldPos);
               chunk->setNeedSave(true);
               chunk->setPriority(true);
               return true;
@@ -750,7 +800,7 @@ bool World::setBlock(const Point3i &worldPos, block_t type, BlockData *data)
         {
           if(chunk->setComplex(Chunk::blockPos(worldPos), {type, data}))
             {
-              mChunkMap.updateAdjacent(chunkPos(worldPos), Chunk::chunkEdge(bp));
+              mChunkMap.updateBlock(worldPos);
               chunk->setNeedSave(true);
               chunk->setPriority(true);
               return true;
@@ -1170,14 +1220,25 @@ void World::chunkLoadCallback(Chunk *chunk)
 }
 
 
+#define PREFETCH_AHEAD_S 2.0f // seconds of player movement to prefetch ahead
+
 void World::setCenter(const Point3i &chunkCenter)
 {
   //std::lock_guard<std::mutex> lock(mChunkLock);
   LOGI("Moving center from (%d, %d, %d) to (%d, %d, %d)", mCenter[0], mCenter[1], mCenter[2],
        chunkCenter[0], chunkCenter[1], chunkCenter[2] );
+  const Vector3i jump = (chunkCenter - mCenter).abs();
   mCenter = chunkCenter;
   mMinChunk = mCenter - mLoadRadius;
   mMaxChunk = mCenter + mLoadRadius;
+  if(jump[0] > 2*mLoadRadius[0] || jump[1] > 2*mLoadRadius[1] || jump[2] > 2*mLoadRadius[2])
+    { // teleported (new window doesn't overlap the old one) -- time until one of its chunks is drawn
+      std::lock_guard<std::mutex> lock(mTeleportLock);
+      mTeleportTime = std::chrono::high_resolution_clock::now();
+      mTeleportMin = mMinChunk;
+      mTeleportMax = mMaxChunk;
+      mTeleported = true;
+    }
   mFluids.setRange(mMinChunk, mMaxChunk);
   
   auto unload = mChunkMap.unloadOutside(mMinChunk-1, mMaxChunk+1);
@@ -1187,10 +1248,35 @@ void World::setCenter(const Point3i &chunkCenter)
       //mRayTracer->unload(hash);
       mVisualizer->unload(hash);
     }
+  mChunkMap.reprioritize();
 
   mRenderer->setCenter(mCenter);
   //mRayTracer->setCenter(mCenter);
   mVisualizer->setCenter(mCenter);
+  // remesh chunks whose level of detail changed
+  for(auto hash : mRenderer->lodChanges())
+    {
+      ChunkPtr chunk = mChunkMap[hash];
+      if(chunk)
+        { chunk->setDirty(true); }
+    }
+
+  // prefetch chunks that will enter load range soon (based on player velocity)
+  //  - rounds away from zero so any movement covers at least the next slab of chunks
+  auto chunksAhead = [](float v, int size) -> int
+                     {
+                       const float c = v * PREFETCH_AHEAD_S / size;
+                       return (int)(c >= 0.0f ? std::ceil(c) : std::floor(c));
+                     };
+  const Vector3i ahead{chunksAhead(mVelocity[0], Chunk::sizeX),
+                       chunksAhead(mVelocity[1], Chunk::sizeY),
+                       chunksAhead(mVelocity[2], Chunk::sizeZ) };
+  if(ahead != Vector3i{0,0,0})
+    {
+      const int num = mLoader->prefetch(mMinChunk + ahead, mMaxChunk + ahead, mMinChunk, mMaxChunk);
+      LOGD("Prefetched %d chunks (hits: %d, misses: %d)", num, mLoader->prefetchHits(),
+           mLoader->prefetchMisses() );
+    }
 }
 
 void World::setRadius(const Vector3i &chunkRadius)
@@ -0,0 +1,247 @@
+// Stress test -- ArenaAllocator and DrawCommandList (CPU side of MeshArena, no GL).
+//  - random allocate/free, compacting (and growing like MeshArena) whenever an allocation doesn't fit
+//  - a shadow buffer tagged with allocation ids is copied through compact()'s moves, so lost or
+//    misplaced data shows up as a wrong tag
+//  - checks: no overlaps, ranges within capacity, exact used() accounting, DrawCommand fields
+//  - usage: arenaAllocatorTest [operations]  (exits with 1 on failure)
+#include "arenaAllocator.hpp"
+#include "drawCommandList.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#define DEFAULT_OPS 200000
+#define INITIAL_CAPACITY 4096
+#define MAX_ALLOC 512
+
+static int gFailures = 0;
+#define CHECK(cond, ...)                                        \
+  do {                                                          \
+    if(!(cond))                                                 \
+      {                                                         \
+        if(gFailures++ < 10)                                    \
+          {                                                     \
+            std::printf("FAILED (%s:%d): ", __FILE__, __LINE__); \
+            std::printf(__VA_ARGS__);                           \
+            std::printf("\n");                                  \
+          }                                                     \
+      }                                                         \
+  } while(false)
+
+struct Allocation
+{
+  int size;
+  int id;
+};
+
+// checks live allocations against the allocator and the tagged buffer
+static void checkArena(const ArenaAllocator &arena, const std::map<int, Allocation> &live,
+                       const std::vector<int> &buffer )
+{
+  int used = 0;
+  int end = 0;
+  for(auto &iter : live)
+    {
+      CHECK(iter.first >= end, "allocation at %d overlaps previous allocation (ends at %d)", iter.first, end);
+      end = iter.first + iter.second.size;
+      CHECK(end <= arena.capacity(), "allocation [%d, %d) outside capacity %d", iter.first, end, arena.capacity());
+      used += iter.second.size;
+      for(int i = iter.first; i < end && i < (int)buffer.size(); i++)
+        {
+          if(buffer[i] != iter.second.id)
+            {
+              CHECK(false, "data of allocation %d (offset %d) lost at element %d", iter.second.id, iter.first, i);
+              break;
+            }
+        }
+    }
+  CHECK(arena.used() == used, "used() is %d, live allocations total %d", arena.used(), used);
+  CHECK(arena.numAllocations() == (int)live.size(), "numAllocations() is %d, %d live",
+        arena.numAllocations(), (int)live.size() );
+  CHECK(arena.largestFree() <= arena.available(), "largest free range %d > available %d",
+        arena.largestFree(), arena.available() );
+}
+
+static void testArena(int ops)
+{
+  std::mt19937 rng(1337);
+  std::uniform_int_distribution<int> sizeDist(1, MAX_ALLOC);
+  ArenaAllocator arena(INITIAL_CAPACITY);
+  std::vector<int> buffer(INITIAL_CAPACITY, -1);
+  std::map<int, Allocation> live; // offset --> allocation
+  std::vector<int> offsets;       // (live offsets, for picking one at random)
+  int nextId = 0;
+  int numCompacts = 0;
+  int numGrows = 0;
+  
+  // compacts into a new buffer, copying the tagged data through the returned moves
+  auto compactTo = [&](int capacity)
+    {
+      numCompacts++;
+      std::vector<int> newBuffer(capacity, -1);
+      std::map<int, Allocation> moved;
+      int packedEnd = 0;
+      for(auto &move : arena.compact(capacity))
+        {
+          auto iter = live.find(move.from);
+          CHECK(iter != live.end() && iter->second.size == move.size,
+                "move from %d (size %d) doesn't match a live allocation", move.from, move.size );
+          CHECK(move.to == packedEnd, "move to %d, expected packed offset %d", move.to, packedEnd);
+          packedEnd = move.to + move.size;
+          std::copy(buffer.begin() + move.from, buffer.begin() + move.from + move.size,
+                    newBuffer.begin() + move.to );
+          if(iter != live.end())
+            { moved.emplace(move.to, iter->second); }
+        }
+      CHECK(moved.size() == live.size(), "compact moved %d of %d allocations", (int)moved.size(), (int)live.size());
+      CHECK(arena.capacity() == capacity, "capacity %d after compacting to %d", arena.capacity(), capacity);
+      CHECK(arena.largestFree() == arena.available(), "free space not contiguous after compacting (%d of %d)",
+            arena.largestFree(), arena.available() );
+      live.swap(moved);
+      buffer.swap(newBuffer);
+      offsets.clear();
+      for(auto &iter : live)
+        { offsets.push_back(iter.first); }
+      checkArena(arena, live, buffer);
+    };
+  
+  for(int op = 0; op < ops; op++)
+    {
+      // (live allocations drift between 100 and 400, so freed ranges get fragmented and reused)
+      const int target = ((op / 5000) % 2 ? 100 : 400);
+      const bool alloc = (offsets.size() == 0 || (rng() % 100) < ((int)offsets.size() < target ? 70u : 30u));
+      if(alloc)
+        {
+          const int size = sizeDist(rng);
+          int offset = arena.allocate(size);
+          if(offset < 0)
+            { // compact into a new buffer, growing it if mostly full (same as MeshArena::allocate)
+              int capacity = std::max(arena.capacity(), 1);
+              while(arena.used() + size > capacity*3/4)
+                { capacity *= 2; }
+              numGrows += (capacity != arena.capacity());
+              compactTo(capacity);
+              
+              offset = arena.allocate(size);
+              CHECK(offset >= 0, "allocation of %d failed after compacting (%d used of %d)",
+                    size, arena.used(), arena.capacity() );
+              if(offset < 0)
+                { continue; }
+            }
+          // (neighbors must not overlap the new range)
+          auto next = live.lower_bound(offset);
+          CHECK(next == live.end() || next->first >= offset + size, "allocation [%d, %d) overlaps allocation at %d",
+                offset, offset + size, next->first );
+          if(next != live.begin())
+            {
+              auto prev = std::prev(next);
+              CHECK(prev->first + prev->second.size <= offset, "allocation at %d overlaps allocation [%d, %d)",
+                    offset, prev->first, prev->first + prev->second.size );
+            }
+          live.emplace(offset, Allocation{size, nextId});
+          offsets.push_back(offset);
+          std::fill(buffer.begin() + offset, buffer.begin() + offset + size, nextId);
+          nextId++;
+        }
+      else
+        {
+          const int i = rng() % offsets.size();
+          const int offset = offsets[i];
+          offsets[i] = offsets.back();
+          offsets.pop_back();
+          auto iter = live.find(offset);
+          std::fill(buffer.begin() + offset, buffer.begin() + offset + iter->second.size, -1);
+          live.erase(iter);
+          arena.free(offset);
+        }
+      
+      // (also compact in place now and then, without growing)
+      if(op % 2000 == 1999)
+        { compactTo(arena.capacity()); }
+      
+      // (used() every op, everything else periodically)
+      int used = 0;
+      if(op % 1000 == 0)
+        { checkArena(arena, live, buffer); }
+      else
+        {
+          for(auto &iter : live)
+            { used += iter.second.size; }
+          CHECK(arena.used() == used, "used() is %d after op %d, live allocations total %d", arena.used(), op, used);
+        }
+    }
+  checkArena(arena, live, buffer);
+
+  // freeing everything leaves one free range covering the arena
+  for(auto &iter : live)
+    { arena.free(iter.first); }
+  CHECK(arena.used() == 0, "used() is %d after freeing everything", arena.used());
+  CHECK(arena.largestFree() == arena.capacity(), "largest free range %d after freeing everything (capacity %d)",
+        arena.largestFree(), arena.capacity() );
+  
+  std::printf("arena: %d ops, %d compactions (%d grows), final capacity %d\n",
+              ops, numCompacts, numGrows, arena.capacity() );
+}
+
+static void testDrawCommands()
+{
+  std::mt19937 rng(7331);
+  std::vector<ArenaMesh> meshes(1000);
+  std::vector<Point3f> positions;
+  for(int i = 0; i < (int)meshes.size(); i++)
+    {
+      ArenaMesh &mesh = meshes[i];
+      mesh.vOffset = rng() % 1000000;
+      mesh.numVertices = rng() % 4096;
+      mesh.vCapacity = mesh.numVertices;
+      mesh.iOffset = rng() % 1000000;
+      mesh.numIndices = (i % 10 == 0 ? 0 : (int)(rng() % 6144) + 1); // (some empty meshes)
+      mesh.iCapacity = mesh.numIndices;
+      mesh.indexBase = (i % 3 == 0 ? 0 : (int)(rng() % 2048));
+      positions.push_back(Point3f{(float)i, (float)(i*2), (float)(-i)});
+    }
+
+  DrawCommandList list;
+  for(int r = 0; r < 2; r++) // (second pass checks clear())
+    {
+      list.clear();
+      for(int i = 0; i < (int)meshes.size(); i++)
+        { list.add(meshes[i], positions[i]); }
+      
+      int c = 0;
+      for(int i = 0; i < (int)meshes.size(); i++)
+        {
+          const ArenaMesh &mesh = meshes[i];
+          if(mesh.numIndices == 0)
+            { continue; }
+          CHECK(c < list.size(), "missing draw command for mesh %d", i);
+          if(c >= list.size())
+            { break; }
+          const DrawCommand &cmd = list.commands()[c];
+          CHECK(cmd.count == (uint32_t)mesh.numIndices, "command %d count %u, expected %d", c, cmd.count, mesh.numIndices);
+          CHECK(cmd.instanceCount == 1, "command %d instanceCount %u", c, cmd.instanceCount);
+          CHECK(cmd.firstIndex == (uint32_t)mesh.iOffset, "command %d firstIndex %u, expected %d", c, cmd.firstIndex, mesh.iOffset);
+          CHECK(cmd.baseVertex == mesh.vOffset - mesh.indexBase, "command %d baseVertex %d, expected %d",
+                c, cmd.baseVertex, mesh.vOffset - mesh.indexBase );
+          CHECK(cmd.baseInstance == (uint32_t)c, "command %d baseInstance %u", c, cmd.baseInstance);
+          CHECK(list.positions()[cmd.baseInstance] == positions[i], "command %d position doesn't match mesh %d", c, i);
+          c++;
+        }
+      CHECK(list.size() == c, "%d draw commands, expected %d", list.size(), c);
+      CHECK((int)list.positions().size() == list.size(), "%d positions for %d draw commands",
+            (int)list.positions().size(), list.size() );
+    }
+  std::printf("draw commands: %d meshes, %d commands\n", (int)meshes.size(), list.size());
+}
+
+int main(int argc, char *argv[])
+{
+  const int ops = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_OPS);
+  testArena(ops);
+  testDrawCommands();
+  std::printf("%s (%d failures)\n", (gFailures == 0 ? "PASSED" : "FAILED"), gFailures);
+  return (gFailures == 0 ? 0 : 1);
+}
@@ -0,0 +1,12 @@
+# ArenaAllocator / DrawCommandList stress test, no GL context needed (qmake && make && ./arenaAllocatorTest)
+TARGET = arenaAllocatorTest
+TEMPLATE = app
+QT += gui
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += arenaAllocatorTest.cpp ../../../source/src/graphics/arenaAllocator.cpp ../../../source/src/graphics/drawCommandList.cpp
+INCLUDEPATH = ../../../config ../../../source/inc/graphics ../../../source/inc/math ../../../source/inc/tools ../../../source/inc
+
+OBJECTS_DIR = build/.obj
@@ -0,0 +1,62 @@
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+// shared benchmark helpers (header only -- each bench is a single .cpp, included as "../benchCommon.hpp")
+#include "chunk.hpp"
+#include "terrain.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// average ms per call
+static inline double timeMs(int repeats, const std::function<void()> &func)
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+  for(int r = 0; r < repeats; r++)
+    { func(); }
+  return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                  start ).count() / repeats;
+}
+
+// generated block of size^3 chunks around the surface (z from -size/2)
+//  - inner chunks have all their neighbors generated
+struct TerrainGrid
+{
+  int size;
+  Point3i origin;
+  std::unordered_map<hash_t, std::unique_ptr<Chunk>> chunks;
+
+  TerrainGrid(int gridSize, uint32_t seed, terrain_t terrain = terrain_t::PERLIN_WORLD)
+    : size(gridSize), origin{0, 0, -gridSize/2}
+  {
+    TerrainGenerator generator(seed);
+    std::vector<uint8_t> data;
+    for(int x = 0; x < size; x++)
+      for(int y = 0; y < size; y++)
+        for(int z = 0; z < size; z++)
+          {
+            const Point3i cp = origin + Point3i{x, y, z};
+            generator.generate(cp, terrain, data);
+            std::unique_ptr<Chunk> chunk(new Chunk(cp));
+            chunk->deserialize(data);
+            chunks.emplace(Hash::hash(cp), std::move(chunk));
+          }
+  }
+
+  // nullptr if outside the grid
+  Chunk* find(const Point3i &cp) const
+  {
+    auto iter = chunks.find(Hash::hash(cp));
+    return (iter != chunks.end() ? iter->second.get() : nullptr);
+  }
+  bool isInner(const Chunk *chunk) const
+  {
+    const Point3i p = chunk->pos() - origin;
+    return (p[0] > 0 && p[0] < size-1 && p[1] > 0 && p[1] < size-1 && p[2] > 0 && p[2] < size-1);
+  }
+};
+
+#endif // BENCH_COMMON_HPP
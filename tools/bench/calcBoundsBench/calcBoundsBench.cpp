@@ -0,0 +1,132 @@
+// Benchmark -- ChunkBounds::calcBounds (bitmask occupancy rows over a PaddedChunk) vs. the old
+//              per-block neighbor lookups into an unordered_map.
+//  - PERLIN_WORLD chunks with all their neighbors generated (inner 3x3x3 of a 5x5x5 block of chunks)
+//  - both paths must find the same faces (block type and active sides for every block)
+//  - usage: calcBoundsBench [repeats]
+#include "../benchCommon.hpp"
+#include "meshing.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define DEFAULT_REPEATS 20
+#define SEED 1337
+#define GRID 5 // (chunks per side -- only the inner chunks are measured)
+
+static const std::array<blockSide_t, 6> gSides {{ blockSide_t::PX, blockSide_t::PY, blockSide_t::PZ,
+                                                  blockSide_t::NX, blockSide_t::NY, blockSide_t::NZ }};
+static const std::array<Point3i, 6> gDirections {{ Point3i{1,0,0}, Point3i{0,1,0}, Point3i{0,0,1},
+                                                   Point3i{-1,0,0}, Point3i{0,-1,0}, Point3i{0,0,-1} }};
+
+// (old ChunkBounds::calcBounds -- neighbor chunks are probed per block on the chunk's edges)
+static int legacyBounds(Chunk *chunk, std::unordered_map<hash_t, ActiveBlock> &boundsOut)
+{
+  boundsOut.clear();
+  if(chunk->isEmpty())
+    { return 0; }
+  int numFaces = 0;
+  Point3i bp;
+  for(bp[1] = 0; bp[1] < Chunk::size[1]; bp[1]++)
+    for(bp[2] = 0; bp[2] < Chunk::size[2]; bp[2]++)
+      for(bp[0] = 0; bp[0] < Chunk::size[0]; bp[0]++)
+        {
+          const block_t bt = chunk->getType(bp);
+          if(isSimpleBlock(bt))
+            {
+              blockSide_t activeSides = blockSide_t::NONE;
+              for(int i = 0; i < 6; i++)
+                {
+                  const Point3i np = bp + gDirections[i];
+                  block_t nt;
+                  if((Chunk::chunkEdge(bp) & gSides[i]) != blockSide_t::NONE)
+                    {
+                      Chunk *n = chunk->getNeighbor(gSides[i]);
+                      nt = (n ? n->getType(Chunk::blockPos(np)) : block_t::NONE);
+                    }
+                  else
+                    { nt = chunk->getType(np); }
+                  if(!isSimpleBlock(nt))
+                    {
+                      activeSides |= gSides[i];
+                      numFaces++;
+                    }
+                }
+              if(activeSides != blockSide_t::NONE)
+                { boundsOut.emplace(Hash::hash(bp), ActiveBlock{bt, activeSides}); }
+            }
+        }
+  return numFaces;
+}
+
+int main(int argc, char *argv[])
+{
+  const int repeats = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_REPEATS);
+
+  // generate chunks around the surface
+  TerrainGrid grid(GRID, SEED);
+  auto getChunk = [&grid](const Point3i &cp) { return grid.find(cp); };
+  std::vector<Chunk*> chunks;
+  for(auto &iter : grid.chunks)
+    {
+      Chunk *chunk = iter.second.get();
+      for(int i = 0; i < 6; i++)
+        { chunk->setNeighbor(gSides[i], grid.find(chunk->pos() + gDirections[i])); }
+      if(grid.isInner(chunk))
+        { chunks.push_back(chunk); }
+    }
+  std::printf("%d PERLIN_WORLD chunks (with neighbors), %d repeats\n", (int)chunks.size(), repeats);
+
+  // check both paths find the same faces
+  std::unordered_map<hash_t, ActiveBlock> oldBounds;
+  PaddedChunk padded;
+  ChunkBounds bounds;
+  int oldFaces = 0;
+  int newFaces = 0;
+  int differ = 0;
+  for(auto chunk : chunks)
+    {
+      oldFaces += legacyBounds(chunk, oldBounds);
+      padded.capture(chunk, getChunk);
+      bounds.calcBounds(padded);
+      newFaces += bounds.numFaces();
+      bool same = (oldBounds.size() == bounds.getFaces().size());
+      for(auto &block : bounds.getFaces())
+        {
+          auto iter = oldBounds.find(Hash::hash(ChunkBounds::blockPos(block)));
+          same = same && (iter != oldBounds.end() && iter->second.block == block.block &&
+                          iter->second.sides == block.sides );
+        }
+      differ += !same;
+    }
+  std::printf("faces:  old %d,  new %d  (%d chunks differ)\n", oldFaces, newFaces, differ);
+
+  std::vector<std::unique_ptr<PaddedChunk>> captured;
+  for(auto chunk : chunks)
+    {
+      captured.emplace_back(new PaddedChunk());
+      captured.back()->capture(chunk, getChunk);
+    }
+  const double oldMs = timeMs(repeats, [&]()
+                              {
+                                for(auto chunk : chunks)
+                                  { legacyBounds(chunk, oldBounds); }
+                              });
+  const double captureMs = timeMs(repeats, [&]()
+                                  {
+                                    for(auto chunk : chunks)
+                                      { padded.capture(chunk, getChunk); }
+                                  });
+  const double newMs = timeMs(repeats, [&]()
+                              {
+                                for(auto &p : captured)
+                                  { bounds.calcBounds(*p); }
+                              });
+  std::printf("old (hash map):        %8.3f ms/chunk\n", oldMs / chunks.size());
+  std::printf("new (bitmask rows):    %8.3f ms/chunk  (%.1fx)\n", newMs / chunks.size(), oldMs / newMs);
+  std::printf("    + padded capture:  %8.3f ms/chunk  (%.1fx)\n", (newMs + captureMs) / chunks.size(),
+              oldMs / (newMs + captureMs) );
+  return 0;
+}
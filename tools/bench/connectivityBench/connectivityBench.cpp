@@ -0,0 +1,191 @@
+// Benchmark -- Chunk::updateConnected (row bitset flood fill) vs. the old hash set flood fill.
+//  - non-uniform PERLIN_CAVES and PERLIN_WORLD chunks
+//  - connected edges are checked against a plain 6-connected reference BFS
+//    (the old fill had its y/z neighbor guards inverted, so its mismatches are reported too)
+//  - usage: connectivityBench [repeats]
+#include "../benchCommon.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#define DEFAULT_REPEATS 5
+#define SEED 1337
+
+// side pairs connected through empty space (bit i + 6*j set for sides 1<<i and 1<<j, i < j)
+typedef uint64_t edges_t;
+
+static edges_t pairEdges(int sides)
+{
+  edges_t edges = 0;
+  for(int i = 0; i < 6; i++)
+    for(int j = i+1; j < 6; j++)
+      {
+        const int c = (1 << i) | (1 << j);
+        if((sides & c) == c)
+          { edges |= (edges_t)1 << (i + 6*j); }
+      }
+  return edges;
+}
+
+static int edgeSides(const Point3i &bp)
+{
+  return ((bp[0] == Chunk::sizeX-1 ? (int)blockSide_t::PX : 0) |
+          (bp[1] == Chunk::sizeY-1 ? (int)blockSide_t::PY : 0) |
+          (bp[2] == Chunk::sizeZ-1 ? (int)blockSide_t::PZ : 0) |
+          (bp[0] == 0              ? (int)blockSide_t::NX : 0) |
+          (bp[1] == 0              ? (int)blockSide_t::NY : 0) |
+          (bp[2] == 0              ? (int)blockSide_t::NZ : 0) );
+}
+
+// (reference -- breadth first search over 6-connected empty blocks from each surface block)
+static edges_t referenceEdges(const block_t *blocks)
+{
+  const auto &indexer = Chunk::indexer();
+  std::vector<bool> visited(Chunk::totalSize, false);
+  std::queue<Point3i> open;
+  edges_t edges = 0;
+  for(int bi = 0; bi < Chunk::totalSize; bi++)
+    {
+      const Point3i start = indexer.unindex(bi);
+      if(visited[bi] || blocks[bi] != block_t::NONE || edgeSides(start) == 0)
+        { continue; }
+      int sides = 0;
+      visited[bi] = true;
+      open.push(start);
+      while(open.size() > 0)
+        {
+          const Point3i bp = open.front();
+          open.pop();
+          sides |= edgeSides(bp);
+          for(int d = 0; d < 6; d++)
+            {
+              Point3i np = bp;
+              np[d % 3] += (d < 3 ? 1 : -1);
+              if(np[0] < 0 || np[0] >= Chunk::sizeX || np[1] < 0 || np[1] >= Chunk::sizeY ||
+                 np[2] < 0 || np[2] >= Chunk::sizeZ )
+                { continue; }
+              const int ni = indexer.index(np);
+              if(!visited[ni] && blocks[ni] == block_t::NONE)
+                {
+                  visited[ni] = true;
+                  open.push(np);
+                }
+            }
+        }
+      edges |= pairEdges(sides);
+    }
+  return edges;
+}
+
+// (old Chunk::updateConnected -- hash sets of block indices, y/z guards as they were)
+static edges_t legacyEdges(const block_t *blocks)
+{
+  const auto &indexer = Chunk::indexer();
+  const int dy = Chunk::sizeX * Chunk::sizeZ;
+  const int dz = Chunk::sizeX;
+  std::unordered_set<int> untraversed;
+  std::unordered_set<int> edgeBlocks;
+  for(int bi = 0; bi < Chunk::totalSize; bi++)
+    {
+      if(blocks[bi] == block_t::NONE)
+        {
+          untraversed.insert(bi);
+          if(Chunk::chunkEdge(indexer.unindex(bi)) != blockSide_t::NONE)
+            { edgeBlocks.insert(bi); }
+        }
+    }
+
+  edges_t edges = 0;
+  while(edgeBlocks.size() > 0 && untraversed.size() > 0)
+    {
+      const int start = *edgeBlocks.begin();
+      edgeBlocks.erase(start);
+      std::queue<int> fill;
+      fill.push(start);
+      int sides = 0;
+      while(fill.size() > 0)
+        {
+          const int bi = fill.front();
+          fill.pop();
+          if(untraversed.count(bi) > 0)
+            {
+              untraversed.erase(bi);
+              const Point3i p = indexer.unindex(bi);
+              sides |= edgeSides(p);
+              if(p[0] > 0)                { fill.push(bi - 1); }
+              if(p[0] < Chunk::sizeX-1)   { fill.push(bi + 1); }
+              if(p[1] > 0)                { fill.push(bi + dy); }
+              if(p[1] < Chunk::sizeY-1)   { fill.push(bi - dy); }
+              if(p[2] > 0)                { fill.push(bi + dz); }
+              if(p[2] < Chunk::sizeZ-1)   { fill.push(bi - dz); }
+            }
+        }
+      edges |= pairEdges(sides);
+    }
+  return edges;
+}
+
+static edges_t chunkEdges(Chunk &chunk)
+{
+  edges_t edges = 0;
+  for(int i = 0; i < 6; i++)
+    for(int j = i+1; j < 6; j++)
+      {
+        if(chunk.edgesConnected((blockSide_t)(1 << i), (blockSide_t)(1 << j)))
+          { edges |= (edges_t)1 << (i + 6*j); }
+      }
+  return edges;
+}
+
+int main(int argc, char *argv[])
+{
+  const int repeats = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_REPEATS);
+
+  // non-uniform cave and surface chunks
+  TerrainGenerator generator(SEED);
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  std::vector<uint8_t> data;
+  for(terrain_t terrain : {terrain_t::PERLIN_CAVES, terrain_t::PERLIN_WORLD})
+    for(int x = 0; x < 6; x++)
+      for(int y = 0; y < 6; y++)
+        for(int z = -3; z < 4; z++)
+          {
+            const Point3i cp{x, y, z};
+            generator.generate(cp, terrain, data);
+            if(Chunk::isUniformData(data))
+              { continue; }
+            std::unique_ptr<Chunk> chunk(new Chunk(cp));
+            chunk->deserialize(data);
+            if(!chunk->isUniform())
+              { chunks.emplace_back(std::move(chunk)); }
+          }
+  std::printf("%d non-uniform chunks, %d repeats\n", (int)chunks.size(), repeats);
+
+  int newMismatches = 0;
+  int oldMismatches = 0;
+  for(auto &chunk : chunks)
+    {
+      const edges_t reference = referenceEdges(chunk->blocks());
+      newMismatches += (chunkEdges(*chunk) != reference);
+      oldMismatches += (legacyEdges(chunk->blocks()) != reference);
+    }
+  std::printf("mismatches vs reference BFS:  new %d,  old %d\n", newMismatches, oldMismatches);
+
+  const double oldMs = timeMs(repeats, [&]()
+                              {
+                                for(auto &chunk : chunks)
+                                  { legacyEdges(chunk->blocks()); }
+                              });
+  const double newMs = timeMs(repeats, [&]()
+                              {
+                                for(auto &chunk : chunks)
+                                  { chunk->updateConnected(); }
+                              });
+  std::printf("old (hash sets):     %8.3f ms/chunk\n", oldMs / chunks.size());
+  std::printf("new (row bitsets):   %8.3f ms/chunk  (%.1fx)\n", newMs / chunks.size(), oldMs / newMs);
+  return 0;
+}
@@ -0,0 +1,14 @@
+# Chunk connectivity benchmark (qmake && make && ./connectivityBench)
+TARGET = connectivityBench
+TEMPLATE = app
+QT += gui opengl
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += connectivityBench.cpp ../../../source/src/voxels/chunk.cpp ../../../source/src/math/meshing.cpp \
+           ../../../source/src/voxels/terrain.cpp ../../../source/src/math/simplexBatch.cpp
+INCLUDEPATH = ../../../config ../../../source/inc/compute ../../../source/inc/graphics ../../../source/inc/math \
+              ../../../source/inc/threading ../../../source/inc/tools ../../../source/inc/voxels ../../../source/inc
+
+OBJECTS_DIR = build/.obj
@@ -0,0 +1,107 @@
+// Benchmark -- batch frustum culling (scalar/SSE/AVX) vs. per-box corner tests (the old Camera::cubeInFrustum).
+//  - chunk sized boxes at random chunk positions around a camera at the origin looking along +x
+//  - SIMD masks are checked against the scalar mask
+//  - usage: frustumBench [repeats]
+#include "frustum.hpp"
+#include "../benchCommon.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#define DEFAULT_REPEATS 20
+#define BOX_SIZE 32.0f
+
+// (old test -- box is outside if all 8 corners are outside one of the 4 side planes)
+static bool cornersInside(const Frustum &frustum, const Point3f &minP, const Point3f &maxP)
+{
+  static const Frustum::planeIndex_t sides[4] = {Frustum::LEFT, Frustum::RIGHT,
+                                                 Frustum::TOP, Frustum::BOTTOM };
+  for(auto side : sides)
+    {
+      const Frustum::Plane &plane = frustum.getPlane(side);
+      const Point3f center = plane.normal*(-plane.d);
+      bool outside = true;
+      for(int c = 0; c < 8 && outside; c++)
+        {
+          const Point3f p{(c & 1) ? maxP[0] : minP[0],
+                          (c & 2) ? maxP[1] : minP[1],
+                          (c & 4) ? maxP[2] : minP[2] };
+          outside = (plane.normal.dot((p - center).normalized()) < 0.0f);
+        }
+      if(outside)
+        { return false; }
+    }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  const int repeats = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_REPEATS);
+
+  // 90 degree horizontal/60 degree vertical field of view, near 0.1, far 1000
+  Frustum frustum;
+  const float tanY = std::tan(M_PI / 6.0);
+  const float lenX = std::sqrt(2.0f);
+  const float lenY = std::sqrt(tanY*tanY + 1.0f);
+  frustum.setPlane(Frustum::LEFT,   Frustum::Plane{Vector3f{1.0f/lenX, -1.0f/lenX, 0.0f}, 0.0f});
+  frustum.setPlane(Frustum::RIGHT,  Frustum::Plane{Vector3f{1.0f/lenX, 1.0f/lenX, 0.0f}, 0.0f});
+  frustum.setPlane(Frustum::TOP,    Frustum::Plane{Vector3f{tanY/lenY, 0.0f, -1.0f/lenY}, 0.0f});
+  frustum.setPlane(Frustum::BOTTOM, Frustum::Plane{Vector3f{tanY/lenY, 0.0f, 1.0f/lenY}, 0.0f});
+  frustum.setPlane(Frustum::FRONT,  Frustum::Plane{Vector3f{1.0f, 0.0f, 0.0f}, -0.1f});
+  frustum.setPlane(Frustum::BACK,   Frustum::Plane{Vector3f{-1.0f, 0.0f, 0.0f}, 1000.0f});
+  std::printf("best supported: %s, %d repeats\n", Frustum::toString(Frustum::supported()), repeats);
+
+  std::mt19937 rng(1337);
+  for(int numBoxes : {10000, 100000})
+    {
+      // (boxes within a cube of chunks 3x the far distance wide)
+      std::uniform_int_distribution<int> chunk(-48, 47);
+      Frustum::BoxList boxes;
+      boxes.reserve(numBoxes);
+      for(int i = 0; i < numBoxes; i++)
+        {
+          const Point3f minP{chunk(rng)*BOX_SIZE, chunk(rng)*BOX_SIZE, chunk(rng)*BOX_SIZE};
+          boxes.add(minP, minP + Vector3f{BOX_SIZE, BOX_SIZE, BOX_SIZE});
+        }
+
+      int numCorners = 0;
+      const double cornersMs = timeMs(repeats, [&]()
+                                      {
+                                        numCorners = 0;
+                                        for(int i = 0; i < numBoxes; i++)
+                                          {
+                                            numCorners += cornersInside(frustum,
+                                                                        Point3f{boxes.minX[i], boxes.minY[i], boxes.minZ[i]},
+                                                                        Point3f{boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]} );
+                                          }
+                                      });
+      std::printf("%6d boxes  corners (old): %8.3f ms  (%d inside, side planes only)\n",
+                  numBoxes, cornersMs, numCorners );
+
+      std::vector<uint64_t> scalarMask;
+      for(auto simd : {Frustum::simd_t::SCALAR, Frustum::simd_t::SSE, Frustum::simd_t::AVX})
+        {
+          frustum.setSimd(simd);
+          if(frustum.getSimd() != simd)
+            {
+              std::printf("%6d boxes  %-13s (not supported)\n", numBoxes, Frustum::toString(simd));
+              continue;
+            }
+          std::vector<uint64_t> mask;
+          const double ms = timeMs(repeats, [&]() { frustum.cull(boxes, mask); });
+          if(simd == Frustum::simd_t::SCALAR)
+            { scalarMask = mask; }
+          int inside = 0;
+          for(auto word : mask)
+            { inside += __builtin_popcountll(word); }
+          std::printf("%6d boxes  %-13s %8.3f ms  (%d inside%s)\n", numBoxes,
+                      (std::string(Frustum::toString(simd)) + ":").c_str(), ms, inside,
+                      (mask == scalarMask ? "" : ", MASK DIFFERS FROM SCALAR") );
+        }
+    }
+  return 0;
+}
@@ -0,0 +1,13 @@
+# Frustum culling benchmark (qmake && make && ./frustumBench)
+TARGET = frustumBench
+TEMPLATE = app
+QT += gui
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += frustumBench.cpp ../../../source/src/math/frustum.cpp
+INCLUDEPATH = ../../../config ../../../source/inc/compute ../../../source/inc/graphics ../../../source/inc/math \
+              ../../../source/inc/threading ../../../source/inc/tools ../../../source/inc/voxels ../../../source/inc
+
+OBJECTS_DIR = build/.obj
@@ -0,0 +1,192 @@
+// Benchmark -- greedy (ChunkBounds::simplifyGreedy) vs. naive per-face chunk meshing.
+//  - non-empty PERLIN_WORLD chunks with all their neighbors generated, meshed on one thread
+//  - vertices are built with MeshRenderer's own lighting (AO) and quad helpers (see meshQuads.cpp)
+//  - merged rects must cover exactly the naive path's faces, each with the same type and lighting
+//  - usage: greedyMeshBench [repeats]
+#include "../benchCommon.hpp"
+#include "meshing.hpp"
+#include "meshData.hpp"
+#include "meshRenderer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define DEFAULT_REPEATS 10
+#define SEED 1337
+#define GRID 5 // (chunks per side -- only the inner chunks are meshed)
+
+// (MeshRenderer::meshSides order)
+static const std::array<blockSide_t, 6> gSides {{ blockSide_t::PX, blockSide_t::PY, blockSide_t::PZ,
+                                                  blockSide_t::NX, blockSide_t::NY, blockSide_t::NZ }};
+
+static int sideBit(blockSide_t side)
+{ return __builtin_ctz((unsigned int)side); }
+
+static void meshNaive(BlockMeshData &mesh, const PaddedChunk &padded, ChunkBounds &bounds)
+{
+  for(int s = 0; s < Chunk::numSections; s++)
+    {
+      int first, last;
+      bounds.sectionFaces(s, first, last);
+      for(int f = first; f < last; f++)
+        {
+          const ActiveBlock &block = bounds.getFaces()[f];
+          const Point3i bp = ChunkBounds::blockPos(block);
+          for(auto side : gSides)
+            {
+              if((block.sides & side) != blockSide_t::NONE)
+                {
+                  MeshRenderer::addQuad(mesh, bp, Vector3i{1, 1, 1}, side, block.block,
+                                        MeshRenderer::faceLighting(padded, bp, side) );
+                }
+            }
+        }
+    }
+}
+
+static Point3i rectOrigin(const ActiveRect &rect, Vector3i &sizeOut)
+{
+  int normalDim, dim0, dim1;
+  ChunkBounds::rectDims(rect.side, normalDim, dim0, dim1);
+  Point3i bp;
+  bp[normalDim] = rect.depth;
+  bp[dim0] = rect.pos[0];
+  bp[dim1] = rect.pos[1];
+  sizeOut = Vector3i{1, 1, 1};
+  sizeOut[dim0] = rect.size[0];
+  sizeOut[dim1] = rect.size[1];
+  return bp;
+}
+
+static void meshGreedy(BlockMeshData &mesh, const PaddedChunk &padded, ChunkBounds &bounds,
+                       std::vector<ActiveRect> *rectsOut = nullptr )
+{
+  auto key = [&padded](const Point3i &bp, blockSide_t side) { return MeshRenderer::faceLighting(padded, bp, side); };
+  for(int s = 0; s < Chunk::numSections; s++)
+    {
+      for(auto &rect : bounds.simplifyGreedy(key, s))
+        {
+          MeshRenderer::addRect(mesh, rect);
+          if(rectsOut)
+            { rectsOut->push_back(rect); }
+        }
+    }
+}
+
+// checks rects cover each naive face exactly once, with the same type and lighting
+static bool sameCoverage(const PaddedChunk &padded, ChunkBounds &bounds, const std::vector<ActiveRect> &rects,
+                         int &numFacesOut )
+{
+  std::unordered_map<int, uint32_t> faces; // (block index*6 + side) --> type | lighting << 8
+  for(auto &block : bounds.getFaces())
+    {
+      const Point3i bp = ChunkBounds::blockPos(block);
+      for(auto side : gSides)
+        {
+          if((block.sides & side) != blockSide_t::NONE)
+            { faces.emplace(block.index*6 + sideBit(side), (uint32_t)block.block | (MeshRenderer::faceLighting(padded, bp, side) << 8)); }
+        }
+    }
+  numFacesOut = faces.size();
+  
+  int covered = 0;
+  for(auto &rect : rects)
+    {
+      int normalDim, dim0, dim1;
+      ChunkBounds::rectDims(rect.side, normalDim, dim0, dim1);
+      Vector3i size;
+      const Point3i origin = rectOrigin(rect, size);
+      for(int r1 = 0; r1 < rect.size[1]; r1++)
+        for(int r0 = 0; r0 < rect.size[0]; r0++)
+          {
+            Point3i bp = origin;
+            bp[dim0] += r0;
+            bp[dim1] += r1;
+            auto iter = faces.find(Chunk::indexer().index(bp)*6 + sideBit(rect.side));
+            if(iter == faces.end() || iter->second != ((uint32_t)rect.type | (rect.key << 8)))
+              { return false; }
+            faces.erase(iter); // (covered twice is a miss the second time)
+            covered++;
+          }
+    }
+  return faces.size() == 0 && covered == numFacesOut;
+}
+
+int main(int argc, char *argv[])
+{
+  const int repeats = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_REPEATS);
+
+  // generate chunks around the surface
+  TerrainGrid grid(GRID, SEED);
+  auto getChunk = [&grid](const Point3i &cp) { return grid.find(cp); };
+  // (inner chunks with any faces)
+  std::vector<std::unique_ptr<PaddedChunk>> padded;
+  for(auto &iter : grid.chunks)
+    {
+      if(grid.isInner(iter.second.get()))
+        {
+          std::unique_ptr<PaddedChunk> pc(new PaddedChunk());
+          pc->capture(iter.second.get(), getChunk);
+          if(ChunkBounds(*pc).getFaces().size() > 0)
+            { padded.emplace_back(std::move(pc)); }
+        }
+    }
+  const int numChunks = padded.size();
+  std::printf("%d non-empty PERLIN_WORLD chunks, %d repeats\n", numChunks, repeats);
+
+  // vertex counts and coverage
+  ChunkBounds bounds;
+  BlockMeshData mesh;
+  long naiveVertices = 0;
+  long greedyVertices = 0;
+  int totalFaces = 0;
+  int differ = 0;
+  for(auto &p : padded)
+    {
+      bounds.calcBounds(*p);
+      mesh.swap();
+      meshNaive(mesh, *p, bounds);
+      naiveVertices += mesh.vertices().size();
+      mesh.swap();
+      std::vector<ActiveRect> rects;
+      meshGreedy(mesh, *p, bounds, &rects);
+      greedyVertices += mesh.vertices().size();
+      int numFaces = 0;
+      differ += !sameCoverage(*p, bounds, rects, numFaces);
+      totalFaces += numFaces;
+    }
+  std::printf("%d faces, greedy rects cover them exactly in %d of %d chunks\n",
+              totalFaces, numChunks - differ, numChunks );
+
+  const double boundsMs = timeMs(repeats, [&]()
+                                 {
+                                   for(auto &p : padded)
+                                     { bounds.calcBounds(*p); }
+                                 });
+  const double naiveMs = timeMs(repeats, [&]()
+                                {
+                                  for(auto &p : padded)
+                                    {
+                                      bounds.calcBounds(*p);
+                                      mesh.swap();
+                                      meshNaive(mesh, *p, bounds);
+                                    }
+                                });
+  const double greedyMs = timeMs(repeats, [&]()
+                                 {
+                                   for(auto &p : padded)
+                                     {
+                                       bounds.calcBounds(*p);
+                                       mesh.swap();
+                                       meshGreedy(mesh, *p, bounds);
+                                     }
+                                 });
+  std::printf("calcBounds                      %8.3f ms/chunk  (included in both)\n", boundsMs / numChunks);
+  std::printf("naive   %7ld vertices/chunk  %8.3f ms/chunk\n", naiveVertices / numChunks, naiveMs / numChunks);
+  std::printf("greedy  %7ld vertices/chunk  %8.3f ms/chunk  (%.1fx fewer vertices)\n",
+              greedyVertices / numChunks, greedyMs / numChunks, (double)naiveVertices / greedyVertices );
+  return 0;
+}
@@ -0,0 +1,15 @@
+# Greedy vs. naive chunk meshing benchmark (qmake && make && ./greedyMeshBench)
+TARGET = greedyMeshBench
+TEMPLATE = app
+QT += gui opengl
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += greedyMeshBench.cpp ../../../source/src/voxels/chunk.cpp ../../../source/src/math/meshing.cpp \
+           ../../../source/src/voxels/terrain.cpp ../../../source/src/math/simplexBatch.cpp \
+           ../../../source/src/graphics/meshData.cpp ../../../source/src/graphics/meshQuads.cpp
+INCLUDEPATH = ../../../config ../../../source/inc/compute ../../../source/inc/graphics ../../../source/inc/math \
+              ../../../source/inc/threading ../../../source/inc/tools ../../../source/inc/voxels ../../../source/inc
+
+OBJECTS_DIR = build/.obj
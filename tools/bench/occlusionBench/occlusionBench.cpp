@@ -0,0 +1,390 @@
+// Benchmark -- occlusion culling (cullOccludedChunks, as used by ChunkMap::cullOccluded) along camera
+//              paths, without a GL context.
+//  - a 25x25x9 chunk world is generated for each path's terrain, and the camera follows the
+//    path's keyframes (read from a path file -- see paths.txt)
+//  - chunks/frame from the connected edge traversal (ChunkMap::getVisible), then after
+//    occlusion culling, with the cost of culling each frame
+//  - every culled chunk is checked by casting rays from the camera to points sampled inside it --
+//    a ray that reaches the chunk before entering a solid block means a visible chunk was culled
+//  - usage: occlusionBench [path file] [repeats]
+#include "chunk.hpp"
+#include "terrain.hpp"
+#include "camera.hpp"
+#include "occlusionBuffer.hpp"
+#include "chunkOcclusion.hpp"
+#include "hashing.hpp"
+#include "pointMath.hpp"
+#include "params.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DEFAULT_PATHS "paths.txt"
+#define DEFAULT_REPEATS 5
+#define SEED 1337
+#define ASPECT (16.0f/9.0f)
+#define RAY_SAMPLES 4 // (sample points per axis in each culled chunk)
+
+static const std::array<blockSide_t, 6> gSides {{ blockSide_t::PX, blockSide_t::PY, blockSide_t::PZ,
+                                                  blockSide_t::NX, blockSide_t::NY, blockSide_t::NZ }};
+static const std::array<Point3i, 6> gDirections {{ Point3i{1,0,0}, Point3i{0,1,0}, Point3i{0,0,1},
+                                                   Point3i{-1,0,0}, Point3i{0,-1,0}, Point3i{0,0,-1} }};
+
+static const std::vector<std::pair<std::string, terrain_t>> gTerrainNames
+  {{ {"DIRT_GROUND", terrain_t::DIRT_GROUND}, {"PERLIN_WORLD", terrain_t::PERLIN_WORLD},
+     {"PERLIN", terrain_t::PERLIN}, {"PERLIN_CAVES", terrain_t::PERLIN_CAVES} }};
+
+static const Point3i gMinChunk{0, 0, -4};
+static const Point3i gMaxChunk{24, 24, 4};
+
+// (same as World::chunkPos)
+static Point3i chunkPos(const Point3i &wp)
+{ return Point3i{wp[0] >> Chunk::shiftX, wp[1] >> Chunk::shiftY, wp[2] >> Chunk::shiftZ}; }
+
+// every chunk in the window is loaded (indexed like ChunkMap's visit stamps)
+struct BenchWorld
+{
+  terrain_t terrain = terrain_t::INVALID;
+  Vector3i dim = gMaxChunk - gMinChunk + 1;
+  std::vector<std::unique_ptr<Chunk>> chunks;
+
+  int index(const Point3i &cp) const
+  {
+    const Point3i p = cp - gMinChunk;
+    return p[0] + dim[0]*(p[2] + dim[2]*p[1]);
+  }
+  Chunk* at(const Point3i &cp) const
+  { return (pointInRange(cp, gMinChunk, gMaxChunk) ? chunks[index(cp)].get() : nullptr); }
+  // (empty outside the window)
+  block_t block(const Point3i &wp) const
+  {
+    const Point3i cp = chunkPos(wp);
+    const Chunk *chunk = at(cp);
+    return (chunk ? chunk->getType(wp - cp*Chunk::size) : block_t::NONE);
+  }
+
+  void generate(terrain_t t)
+  {
+    terrain = t;
+    TerrainGenerator generator(SEED);
+    std::vector<uint8_t> data;
+    chunks.clear();
+    chunks.resize(dim[0]*dim[1]*dim[2]);
+    Point3i cp;
+    for(cp[1] = gMinChunk[1]; cp[1] <= gMaxChunk[1]; cp[1]++)
+      for(cp[2] = gMinChunk[2]; cp[2] <= gMaxChunk[2]; cp[2]++)
+        for(cp[0] = gMinChunk[0]; cp[0] <= gMaxChunk[0]; cp[0]++)
+          {
+            generator.generate(cp, terrain, data);
+            std::unique_ptr<Chunk> chunk(new Chunk(cp));
+            chunk->deserialize(data);
+            chunks[index(cp)] = std::move(chunk);
+          }
+  }
+};
+
+// chunks to cull (same as ChunkMap::getVisible -- breadth first through chunks whose entry and exit
+//  sides connect)
+static void getVisible(const BenchWorld &world, Camera &cam, std::vector<hash_t> &visibleOut)
+{
+  struct VisibleStep
+  {
+    Point3i pos;
+    blockSide_t enterSide;
+    blockSide_t stepped;
+  };
+  static std::vector<bool> visited;
+  static std::vector<VisibleStep> steps;
+  static Frustum::BoxList boxes;
+  static std::vector<uint64_t> mask;
+  const int numChunks = world.chunks.size();
+  visited.assign(numChunks, false);
+  steps.resize(numChunks);
+  if(boxes.size() != numChunks)
+    {
+      Point3i cp;
+      for(cp[1] = gMinChunk[1]; cp[1] <= gMaxChunk[1]; cp[1]++)
+        for(cp[2] = gMinChunk[2]; cp[2] <= gMaxChunk[2]; cp[2]++)
+          for(cp[0] = gMinChunk[0]; cp[0] <= gMaxChunk[0]; cp[0]++)
+            {
+              const Point3f minP = Vector3f(cp)*Chunk::size;
+              boxes.add(minP, minP + Vector3f(Chunk::size));
+            }
+    }
+  cam.getFrustum().cull(boxes, mask);
+
+  visibleOut.clear();
+  const Point3f camPos = cam.getPos();
+  const Point3i camChunk = chunkPos(Point3i{camPos[0], camPos[1], camPos[2]});
+  visibleOut.push_back(Hash::hash(camChunk));
+  if(!pointInRange(camChunk, gMinChunk, gMaxChunk))
+    { return; }
+  int head = 0;
+  int tail = 0;
+  visited[world.index(camChunk)] = true;
+  steps[tail++] = VisibleStep{camChunk, blockSide_t::NONE, blockSide_t::NONE};
+  while(head < tail)
+    {
+      const VisibleStep step = steps[head++];
+      Chunk *chunk = world.at(step.pos);
+      const int vi = world.index(step.pos);
+      if(chunk && !((mask[vi / 64] >> (vi % 64)) & 1))
+        { continue; }
+      for(int i = 0; i < 6; i++)
+        {
+          if((step.stepped & gSides[(i+3) % 6]) != blockSide_t::NONE)
+            { continue; }
+          if(chunk && step.enterSide != blockSide_t::NONE &&
+             !chunk->edgesConnected(step.enterSide, gSides[i]) )
+            { continue; }
+          const Point3i nextPos = step.pos + gDirections[i];
+          if(!pointInRange(nextPos, gMinChunk, gMaxChunk) || visited[world.index(nextPos)])
+            { continue; }
+          visited[world.index(nextPos)] = true;
+          visibleOut.push_back(Hash::hash(nextPos));
+          steps[tail++] = VisibleStep{nextPos, gSides[(i+3) % 6], step.stepped | gSides[i]};
+        }
+    }
+}
+
+// steps block by block from the camera toward p (inside chunk cp)
+//  - true if the ray enters a solid block from an open one (a face toward the camera) first
+static bool rayBlocked(const BenchWorld &world, const Point3f &o, const Point3f &p, const Point3i &cp)
+{
+  const Vector3f d = p - o;
+  Point3i bp{(int)std::floor(o[0]), (int)std::floor(o[1]), (int)std::floor(o[2])};
+  Point3i step;
+  Vector3f tMax;
+  Vector3f tDelta;
+  for(int a = 0; a < 3; a++)
+    {
+      step[a] = (d[a] > 0.0f ? 1 : (d[a] < 0.0f ? -1 : 0));
+      tDelta[a] = (step[a] != 0 ? std::abs(1.0f / d[a]) : INFINITY);
+      tMax[a] = (step[a] > 0 ? (bp[a] + 1 - o[a]) / d[a] :
+                 (step[a] < 0 ? (bp[a] - o[a]) / d[a] : INFINITY) );
+    }
+  bool solid = isSimpleBlock(world.block(bp));
+  while(true)
+    {
+      const int a = (tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2));
+      if(tMax[a] > 1.0f)
+        { return false; } // (reached p)
+      bp[a] += step[a];
+      tMax[a] += tDelta[a];
+      if(chunkPos(bp) == cp)
+        { return false; } // (reached the chunk)
+      const bool nextSolid = isSimpleBlock(world.block(bp));
+      if(nextSolid && !solid)
+        { return true; }
+      solid = nextSolid;
+    }
+}
+
+// checks rays to RAY_SAMPLES^3 points in each culled chunk (only rays that enter the chunk on screen)
+static int checkCulled(const BenchWorld &world, Camera &cam, const std::vector<hash_t> &culled,
+                       long &raysOut )
+{
+  const Point3f o = cam.getPos();
+  const Frustum &frustum = cam.getFrustum();
+  int numVisible = 0;
+  for(auto hash : culled)
+    {
+      const Point3i cp = Hash::unhash(hash);
+      const Point3f minP = Vector3f(cp)*Chunk::size;
+      const Point3f maxP = minP + Vector3f(Chunk::size);
+      bool visible = false;
+      for(int i = 0; i < RAY_SAMPLES*RAY_SAMPLES*RAY_SAMPLES && !visible; i++)
+        {
+          // (off block boundaries)
+          const Vector3f s{(float)(i % RAY_SAMPLES), (float)((i / RAY_SAMPLES) % RAY_SAMPLES),
+                           (float)(i / (RAY_SAMPLES*RAY_SAMPLES)) };
+          const Point3f p = minP + (s + 0.5f)*((float)Chunk::sizeX / RAY_SAMPLES) + 0.37f;
+          // point where the ray enters the chunk
+          const Vector3f d = p - o;
+          float tEnter = 0.0f;
+          for(int a = 0; a < 3; a++)
+            {
+              if(d[a] != 0.0f)
+                { tEnter = std::max(tEnter, ((d[a] > 0.0f ? minP[a] : maxP[a]) - o[a]) / d[a]); }
+            }
+          if(!frustum.pointInside(o + d*tEnter))
+            { continue; }
+          raysOut++;
+          visible = !rayBlocked(world, o, p, cp);
+        }
+      numVisible += visible;
+    }
+  return numVisible;
+}
+
+struct Keyframe
+{
+  Point3f pos;
+  float yaw;   // (degrees from +x toward +y)
+  float pitch; // (-1 looks straight down, 1 straight up)
+  int frames;  // (frames from this keyframe to the next)
+};
+struct CameraPath
+{
+  std::string name;
+  terrain_t terrain;
+  std::vector<Keyframe> keys;
+};
+
+static bool loadPaths(const std::string &file, std::vector<CameraPath> &pathsOut)
+{
+  std::ifstream in(file);
+  if(!in.is_open())
+    {
+      std::printf("Couldn't open path file \"%s\"!\n", file.c_str());
+      return false;
+    }
+  std::string line;
+  for(int l = 1; std::getline(in, line); l++)
+    {
+      std::istringstream ss(line);
+      std::string first;
+      if(!(ss >> first) || first[0] == '#')
+        { continue; }
+      if(first == "path")
+        {
+          CameraPath path;
+          std::string terrain;
+          ss >> path.name >> terrain;
+          auto iter = std::find_if(gTerrainNames.begin(), gTerrainNames.end(),
+                                   [&terrain](const std::pair<std::string, terrain_t> &t)
+                                   { return t.first == terrain; });
+          if(path.name.empty() || iter == gTerrainNames.end())
+            {
+              std::printf("%s:%d -- expected \"path <name> <terrain>\"\n", file.c_str(), l);
+              return false;
+            }
+          path.terrain = iter->second;
+          pathsOut.push_back(path);
+          continue;
+        }
+      Keyframe key{Point3f{0,0,0}, 0.0f, 0.0f, 1};
+      ss.clear();
+      ss.str(line);
+      if(pathsOut.size() == 0 || !(ss >> key.pos[0] >> key.pos[1] >> key.pos[2] >> key.yaw >> key.pitch))
+        {
+          std::printf("%s:%d -- expected \"x y z yaw pitch [frames]\" after a path\n", file.c_str(), l);
+          return false;
+        }
+      ss >> key.frames;
+      pathsOut.back().keys.push_back(key);
+    }
+  return true;
+}
+
+// every frame of the path (keyframes interpolated linearly)
+static std::vector<Keyframe> pathFrames(const CameraPath &path)
+{
+  std::vector<Keyframe> frames;
+  for(int k = 0; k < (int)path.keys.size(); k++)
+    {
+      const Keyframe &key = path.keys[k];
+      if(k + 1 == (int)path.keys.size())
+        {
+          frames.push_back(key);
+          break;
+        }
+      const Keyframe &next = path.keys[k+1];
+      for(int f = 0; f < std::max(1, key.frames); f++)
+        {
+          const float t = (float)f / std::max(1, key.frames);
+          frames.push_back(Keyframe{key.pos + (next.pos - key.pos)*t, key.yaw + (next.yaw - key.yaw)*t,
+                                    key.pitch + (next.pitch - key.pitch)*t, 1 });
+        }
+    }
+  return frames;
+}
+
+int main(int argc, char *argv[])
+{
+  const std::string pathFile = (argc > 1 ? argv[1] : DEFAULT_PATHS);
+  const int repeats = (argc > 2 ? std::atoi(argv[2]) : DEFAULT_REPEATS);
+  std::vector<CameraPath> paths;
+  if(!loadPaths(pathFile, paths))
+    { return 1; }
+
+  BenchWorld world;
+  const chunkLookup_t lookup = [&world](const Point3i &cp) { return world.at(cp); };
+  OcclusionBuffer buffer;
+  std::vector<hash_t> visible;
+  std::vector<hash_t> culled;
+  std::vector<hash_t> remaining;
+  int totalVisibleCulled = 0;
+  std::printf("%dx%dx%d chunk world, %d repeats\n", world.dim[0], world.dim[1], world.dim[2], repeats);
+  for(auto &path : paths)
+    {
+      if(path.terrain != world.terrain)
+        { world.generate(path.terrain); }
+      const std::vector<Keyframe> frames = pathFrames(path);
+
+      long numVisible = 0;
+      long numRemaining = 0;
+      long numOccluders = 0;
+      long numRays = 0;
+      int visibleCulled = 0;
+      double cullMs = 0.0;
+      for(auto &frame : frames)
+        {
+          const float yaw = frame.yaw*M_PI/180.0;
+          Camera cam(frame.pos);
+          cam.setProjection(PLAYER_FOV, ASPECT, PLAYER_Z_NEAR, PLAYER_Z_FAR);
+          cam.setView(Vector3f{std::cos(yaw), std::sin(yaw), 0.0f}, Vector3f{0.0f, 0.0f, 1.0f});
+          cam.rotate(-100.0f*frame.pitch, 0.0f);
+
+          getVisible(world, cam, visible);
+          for(int r = 0; r < repeats; r++)
+            {
+              remaining = visible;
+              const auto start = std::chrono::high_resolution_clock::now();
+              cullOccludedChunks(cam, buffer, lookup, remaining);
+              cullMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                                  start ).count() / repeats;
+            }
+          numVisible += visible.size();
+          numRemaining += remaining.size();
+          numOccluders += buffer.numOccluders();
+
+          // culled chunks (remaining keeps the order of visible)
+          culled.clear();
+          for(int i = 0, j = 0; i < (int)visible.size(); i++)
+            {
+              if(j < (int)remaining.size() && remaining[j] == visible[i])
+                { j++; }
+              else
+                { culled.push_back(visible[i]); }
+            }
+          visibleCulled += checkCulled(world, cam, culled, numRays);
+        }
+      totalVisibleCulled += visibleCulled;
+
+      const int n = frames.size();
+      std::printf("%-12s (%s, %d frames)\n", path.name.c_str(), toString(path.terrain).c_str(), n);
+      std::printf("  chunks/frame:  %8.1f traversal --> %8.1f after culling  (%.1f%% removed)\n",
+                  (double)numVisible / n, (double)numRemaining / n,
+                  100.0*(numVisible - numRemaining) / std::max(1L, numVisible) );
+      std::printf("  culling:       %8.3f ms/frame  (%.1f occluders/frame)\n",
+                  cullMs / n, (double)numOccluders / n );
+      std::printf("  ray check:     %ld rays into %ld culled chunks -- %d visible\n",
+                  numRays, numVisible - numRemaining, visibleCulled );
+    }
+  if(totalVisibleCulled > 0)
+    {
+      std::printf("FAILED -- %d visible chunks were culled\n", totalVisibleCulled);
+      return 1;
+    }
+  std::printf("PASSED\n");
+  return 0;
+}
@@ -0,0 +1,17 @@
+# Occlusion culling benchmark (qmake && make && ./occlusionBench [paths.txt])
+TARGET = occlusionBench
+TEMPLATE = app
+QT += gui opengl
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += occlusionBench.cpp ../../../source/src/voxels/chunk.cpp ../../../source/src/math/meshing.cpp \
+           ../../../source/src/voxels/terrain.cpp ../../../source/src/math/simplexBatch.cpp \
+           ../../../source/src/math/camera.cpp ../../../source/src/math/matrix.cpp \
+           ../../../source/src/math/frustum.cpp ../../../source/src/math/occlusionBuffer.cpp \
+           ../../../source/src/voxels/chunkOcclusion.cpp ../../../source/src/graphics/meshData.cpp
+INCLUDEPATH = ../../../config ../../../source/inc/compute ../../../source/inc/graphics ../../../source/inc/math \
+              ../../../source/inc/threading ../../../source/inc/tools ../../../source/inc/voxels ../../../source/inc
+
+OBJECTS_DIR = build/.obj
@@ -0,0 +1,96 @@
+// Benchmark -- compressed chunk serialization (Chunk::serialize/deserialize).
+//  - generated PERLIN_WORLD and PERLIN_CAVES chunks around the surface
+//  - every chunk is round tripped and compared block for block, and also read back from
+//    legacy untagged raw data and tagged RAW data
+//  - reports compressed size (vs. raw), format counts and serialize/deserialize time
+//  - usage: serializeBench [repeats]  (exits with 1 if any chunk doesn't match)
+#include "../benchCommon.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#define DEFAULT_REPEATS 10
+#define SEED 1337
+#define GRID 6 // (chunks per side)
+
+typedef std::array<block_t, Chunk::totalSize> BlockArray;
+
+static void readBlocks(const Chunk &chunk, BlockArray &blocksOut)
+{
+  for(int bi = 0; bi < Chunk::totalSize; bi++)
+    {
+      const Point3i bp = Chunk::indexer().unindex(bi);
+      blocksOut[bi] = chunk.getType(bp);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+  const int repeats = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_REPEATS);
+  int failures = 0;
+
+  std::printf("%d repeats\n", repeats);
+  for(terrain_t terrain : {terrain_t::PERLIN_WORLD, terrain_t::PERLIN_CAVES})
+    {
+      TerrainGrid grid(GRID, SEED, terrain);
+      std::vector<Chunk*> chunks;
+      std::vector<BlockArray> blocks;
+      std::vector<uint8_t> data;
+      for(auto &iter : grid.chunks)
+        {
+          chunks.push_back(iter.second.get());
+          blocks.emplace_back();
+          readBlocks(*chunks.back(), blocks.back());
+        }
+      const int numChunks = chunks.size();
+
+      // round trip, and legacy/tagged raw reads
+      std::vector<std::vector<uint8_t>> serialized(numChunks);
+      std::array<int, 5> formats = {0};
+      long totalBytes = 0;
+      int roundTrip = 0;
+      int legacy = 0;
+      int raw = 0;
+      Chunk decoded(Point3i{0, 0, 0});
+      BlockArray check;
+      for(int c = 0; c < numChunks; c++)
+        {
+          totalBytes += chunks[c]->serialize(serialized[c]);
+          formats[serialized[c][0] < formats.size() ? serialized[c][0] : 0]++;
+          roundTrip += (decoded.deserialize(serialized[c]) && (readBlocks(decoded, check), check == blocks[c]));
+
+          data.assign((const uint8_t*)blocks[c].data(), (const uint8_t*)blocks[c].data() + Chunk::totalSize);
+          legacy += (decoded.deserialize(data) && (readBlocks(decoded, check), check == blocks[c]));
+          data.insert(data.begin(), (uint8_t)Chunk::format_t::RAW);
+          raw += (decoded.deserialize(data) && (readBlocks(decoded, check), check == blocks[c]));
+        }
+      failures += (numChunks - roundTrip) + (numChunks - legacy) + (numChunks - raw);
+
+      const double serializeMs = timeMs(repeats, [&]()
+                                        {
+                                          for(int c = 0; c < numChunks; c++)
+                                            { chunks[c]->serialize(serialized[c]); }
+                                        });
+      const double deserializeMs = timeMs(repeats, [&]()
+                                          {
+                                            for(int c = 0; c < numChunks; c++)
+                                              { decoded.deserialize(serialized[c]); }
+                                          });
+      const long rawBytes = (long)numChunks * Chunk::totalSize * Block::dataSize;
+      std::printf("%s: %d chunks\n", toString(terrain).c_str(), numChunks);
+      std::printf("  size:        %ld --> %ld bytes (%.1fx)\n", rawBytes, totalBytes, (double)rawBytes / totalBytes);
+      std::printf("  formats:     %d uniform, %d RLE, %d palette, %d raw\n",
+                  formats[(int)Chunk::format_t::UNIFORM], formats[(int)Chunk::format_t::RLE],
+                  formats[(int)Chunk::format_t::PALETTE], formats[(int)Chunk::format_t::RAW] );
+      std::printf("  identical:   %d/%d round trip, %d/%d legacy raw, %d/%d tagged raw\n",
+                  roundTrip, numChunks, legacy, numChunks, raw, numChunks );
+      std::printf("  serialize:   %8.1f us/chunk\n", serializeMs * 1000.0 / numChunks);
+      std::printf("  deserialize: %8.1f us/chunk\n", deserializeMs * 1000.0 / numChunks);
+    }
+  std::printf("%s\n", (failures == 0 ? "PASSED" : "FAILED"));
+  return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,176 @@
+// Benchmark -- batch SimplexBatch noise vs. FastNoise, and TerrainGenerator vs. the old per-block FastNoise generator.
+//  - noise: random points (negative, fractional and integer) at each supported SIMD level, compared bit for bit
+//  - terrain: chunks/sec for each terrain_t over a block of chunks around the surface, block data compared
+//    against the old generator (uniform chunks are expanded before comparing)
+//  - usage: terrainBench [repeats]
+#include "terrain.hpp"
+#include "simplexBatch.hpp"
+#include "FastNoise.h"
+#include "../benchCommon.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#define DEFAULT_REPEATS 3
+#define NUM_POINTS (1 << 20)
+#define SEED 1337
+
+// (old TerrainGenerator::generate -- one FastNoise call per block per layer)
+static void legacyGenerate(FastNoise &noise, const Point3i &chunkPos, terrain_t genType, std::vector<uint8_t> &dataOut)
+{
+  dataOut.resize(Chunk::totalSize * Block::dataSize);
+  block_t b;
+  int bi = 0;
+  for(int y = 0; y < Chunk::sizeY; y++)
+    for(int z = 0; z < Chunk::sizeZ; z++)
+      for(int x = 0; x < Chunk::sizeX; x++, bi++)
+        {
+          Point3i wp{chunkPos[0]*Chunk::sizeX + x, chunkPos[1]*Chunk::sizeY + y, chunkPos[2]*Chunk::sizeZ + z};
+          switch(genType)
+            {
+            case terrain_t::DIRT_GROUND:
+              b = (wp[2] < 4 ? block_t::DIRT : block_t::NONE);
+              break;
+            case terrain_t::PERLIN_WORLD:
+              {
+                wp = wp*4;
+                wp[2] *= 3;
+                float n0 = noise.GetNoise((float)wp[0]/Chunk::sizeX, (float)wp[1]/Chunk::sizeY, (float)wp[2]/Chunk::sizeZ);
+                float n1 = noise.GetNoise((float)wp[0]/Chunk::sizeX/8.0, (float)wp[1]/Chunk::sizeY/8.0, (float)wp[2]/Chunk::sizeZ/8.0);
+                float n2 = noise.GetNoise((float)wp[0]/Chunk::sizeX/16.0, (float)wp[1]/Chunk::sizeY/16.0, (float)wp[2]/Chunk::sizeZ/8.0);
+                float n = 100*n0 - 3.0*(wp[2]) - 1000*std::abs(n2)*(0.5+n1);
+                float nn = 10*n1;
+                if(n < 0)           { b = block_t::NONE; }
+                else if(n < 75.0)   { b = block_t::GRASS; }
+                else if(n < 150.0)  { b = (nn > 0 ? block_t::DIRT : block_t::SAND); }
+                else                { b = block_t::STONE; }
+              }
+              break;
+            case terrain_t::PERLIN:
+              {
+                float n0 = noise.GetNoise((float)wp[0]/Chunk::sizeX, (float)wp[1]/Chunk::sizeY, (float)wp[2]/Chunk::sizeZ);
+                float n1 = noise.GetNoise((float)wp[0]/Chunk::sizeX/8.0, (float)wp[1]/Chunk::sizeY/8.0, (float)wp[2]/Chunk::sizeZ/8.0);
+                float n = 1000*n0 - wp[2];
+                if(n < 0)           { b = block_t::NONE; }
+                else if(n < 75.0)   { b = ((n1 > 0 || n1 < -100.0) ? block_t::GRASS : block_t::SAND); }
+                else if(n < 150.0)  { b = block_t::DIRT; }
+                else                { b = block_t::STONE; }
+              }
+              break;
+            case terrain_t::PERLIN_CAVES:
+              {
+                float n0 = noise.GetNoise((float)wp[0]/Chunk::sizeX, (float)wp[1]/Chunk::sizeY, (float)wp[2]/Chunk::sizeZ);
+                float n1 = noise.GetNoise((float)wp[0]/Chunk::sizeX, (float)wp[1]/Chunk::sizeY, (float)wp[2]/Chunk::sizeZ*n0);
+                float n = 0.1 - n1*n1;
+                if(std::abs(n) < 0.01) { b = block_t::STONE; }
+                else if(n < 0.05)      { b = block_t::DIRT; }
+                else                   { b = block_t::NONE; }
+              }
+              break;
+            default: // TEST
+              b = ((((chunkPos[0]) % 4) == 0 || chunkPos[1] % 4 == 0) && std::abs(chunkPos[0]) % 4 != 2 ? block_t::NONE : block_t::STONE);
+              break;
+            }
+          std::memcpy((void*)&dataOut[bi*Block::dataSize], (void*)&b, Block::dataSize);
+        }
+}
+
+// (expands uniform chunk data to raw blocks)
+static void expand(const std::vector<uint8_t> &data, std::vector<uint8_t> &blocksOut)
+{
+  if(Chunk::isUniformData(data))
+    { blocksOut.assign(Chunk::totalSize * Block::dataSize, data[1]); }
+  else
+    { blocksOut = data; }
+}
+
+int main(int argc, char *argv[])
+{
+  const int repeats = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_REPEATS);
+  std::printf("best supported: %s, %d repeats\n", SimplexBatch::toString(SimplexBatch::supported()), repeats);
+
+  FastNoise fastNoise(SEED);
+  fastNoise.SetNoiseType(FastNoise::Simplex);
+  fastNoise.SetFrequency(1.0);
+
+  // noise -- a third each of fractional, integer and small fractional points (positive and negative)
+  std::mt19937 rng(SEED);
+  std::uniform_real_distribution<float> wide(-1000.0f, 1000.0f);
+  std::uniform_real_distribution<float> narrow(-4.0f, 4.0f);
+  std::vector<float> px(NUM_POINTS), py(NUM_POINTS), pz(NUM_POINTS);
+  for(int i = 0; i < NUM_POINTS; i++)
+    {
+      switch(i % 3)
+        {
+        case 0:  px[i] = wide(rng); py[i] = wide(rng); pz[i] = wide(rng); break;
+        case 1:  px[i] = std::round(wide(rng)); py[i] = std::round(wide(rng)); pz[i] = std::round(wide(rng)); break;
+        default: px[i] = narrow(rng); py[i] = narrow(rng); pz[i] = narrow(rng); break;
+        }
+    }
+  std::vector<float> reference(NUM_POINTS);
+  const double fastMs = timeMs(repeats, [&]()
+                               {
+                                 for(int i = 0; i < NUM_POINTS; i++)
+                                   { reference[i] = fastNoise.GetNoise(px[i], py[i], pz[i]); }
+                               });
+  std::printf("noise  %-10s %8.1f Mpts/s\n", "FastNoise:", NUM_POINTS / fastMs / 1000.0);
+
+  SimplexBatch batch(SEED);
+  for(auto simd : {SimplexBatch::simd_t::SCALAR, SimplexBatch::simd_t::SSE2, SimplexBatch::simd_t::AVX2})
+    {
+      batch.setSimd(simd);
+      if(batch.getSimd() != simd)
+        {
+          std::printf("noise  %-10s (not supported)\n", SimplexBatch::toString(simd));
+          continue;
+        }
+      std::vector<float> out(NUM_POINTS);
+      const double ms = timeMs(repeats, [&]() { batch.eval(px.data(), py.data(), pz.data(), out.data(), NUM_POINTS); });
+      int mismatches = 0;
+      for(int i = 0; i < NUM_POINTS; i++)
+        { mismatches += (std::memcmp(&out[i], &reference[i], sizeof(float)) != 0); }
+      std::printf("noise  %-10s %8.1f Mpts/s  (%d mismatches vs FastNoise)\n",
+                  (std::string(SimplexBatch::toString(simd)) + ":").c_str(), NUM_POINTS / ms / 1000.0, mismatches );
+    }
+
+  // terrain -- 4x4x5 chunks across the surface
+  std::vector<Point3i> chunks;
+  for(int x = 0; x < 4; x++)
+    for(int y = 0; y < 4; y++)
+      for(int z = -2; z < 3; z++)
+        { chunks.push_back(Point3i{x, y, z}); }
+
+  TerrainGenerator generator(SEED);
+  std::printf("%d chunks per terrain\n", (int)chunks.size());
+  std::printf("%-14s %14s %14s\n", "terrain", "old (chunks/s)", "new (chunks/s)");
+  for(int t = 0; t < (int)terrain_t::COUNT; t++)
+    {
+      const terrain_t terrain = (terrain_t)t;
+      std::vector<std::vector<uint8_t>> oldData(chunks.size());
+      std::vector<std::vector<uint8_t>> newData(chunks.size());
+      const double oldMs = timeMs(repeats, [&]()
+                                  {
+                                    for(int c = 0; c < (int)chunks.size(); c++)
+                                      { legacyGenerate(fastNoise, chunks[c], terrain, oldData[c]); }
+                                  });
+      const double newMs = timeMs(repeats, [&]()
+                                  {
+                                    for(int c = 0; c < (int)chunks.size(); c++)
+                                      { generator.generate(chunks[c], terrain, newData[c]); }
+                                  });
+      int differ = 0;
+      std::vector<uint8_t> blocks;
+      for(int c = 0; c < (int)chunks.size(); c++)
+        {
+          expand(newData[c], blocks);
+          differ += (blocks != oldData[c]);
+        }
+      std::printf("%-14s %14.1f %14.1f  (%d chunks differ)\n", (toString(terrain) + ":").c_str(),
+                  chunks.size() / oldMs * 1000.0, chunks.size() / newMs * 1000.0, differ );
+    }
+  return 0;
+}
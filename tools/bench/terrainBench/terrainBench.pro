@@ -0,0 +1,15 @@
+# Terrain generation benchmark (qmake && make && ./terrainBench)
+TARGET = terrainBench
+TEMPLATE = app
+QT += gui opengl
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += terrainBench.cpp ../../../source/src/voxels/terrain.cpp ../../../source/src/math/simplexBatch.cpp \
+           ../../../source/src/voxels/chunk.cpp ../../../source/src/math/meshing.cpp ../../../libs/FastNoise/FastNoise.cpp
+INCLUDEPATH = ../../../config ../../../source/inc/compute ../../../source/inc/graphics ../../../source/inc/math \
+              ../../../source/inc/threading ../../../source/inc/tools ../../../source/inc/voxels ../../../source/inc \
+              ../../../libs/FastNoise
+
+OBJECTS_DIR = build/.obj
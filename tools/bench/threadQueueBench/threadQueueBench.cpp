@@ -0,0 +1,86 @@
+// Microbenchmark -- lock-free ThreadQueue vs. a mutex-guarded std::queue (the old ThreadQueue).
+//  - every thread pushes then pops one entry per op, so the queue holds at most one entry per thread
+//  - usage: threadQueueBench [ops per thread]
+#include "threadQueue.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_OPS 1000000
+#define QUEUE_SIZE 1024
+
+// (same locking as the old ThreadQueue, without its unsynchronized mLocked flag)
+template<typename T>
+class MutexQueue
+{
+public:
+  bool tryPush(const T &obj)
+  {
+    std::lock_guard<std::mutex> lock(mLock);
+    mQueue.push(obj);
+    return true;
+  }
+  bool tryPop(T &objOut)
+  {
+    std::lock_guard<std::mutex> lock(mLock);
+    if(mQueue.size() == 0)
+      { return false; }
+    objOut = mQueue.front();
+    mQueue.pop();
+    return true;
+  }
+
+private:
+  std::queue<T> mQueue;
+  std::mutex mLock;
+};
+
+// ns per push/pop pair, over all threads
+template<typename Q>
+double runBench(Q &queue, int numThreads, int ops)
+{
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::high_resolution_clock::now();
+  for(int t = 0; t < numThreads; t++)
+    {
+      threads.emplace_back([&queue, ops, t]()
+                           {
+                             int *obj = nullptr;
+                             for(int i = 0; i < ops; i++)
+                               {
+                                 while(!queue.tryPush(reinterpret_cast<int*>((intptr_t)(t*ops + i + 1))))
+                                   { std::this_thread::yield(); }
+                                 while(!queue.tryPop(obj))
+                                   { std::this_thread::yield(); }
+                               }
+                           });
+    }
+  for(auto &t : threads)
+    { t.join(); }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() -
+                                                            start ).count();
+  return ns / ((double)ops*numThreads);
+}
+
+int main(int argc, char *argv[])
+{
+  const int ops = (argc > 1 ? std::atoi(argv[1]) : DEFAULT_OPS);
+  std::printf("%d push/pop pairs per thread (%d hardware threads)\n", ops,
+              (int)std::thread::hardware_concurrency() );
+  std::printf("%8s  %14s  %14s\n", "threads", "mutex (ns/op)", "ring (ns/op)");
+  for(int numThreads : {1, 4, 16})
+    {
+      MutexQueue<int*> mutexQueue;
+      ThreadQueue<int*> ringQueue(QUEUE_SIZE);
+      const double mutexNs = runBench(mutexQueue, numThreads, ops);
+      const double ringNs = runBench(ringQueue, numThreads, ops);
+      std::printf("%8d  %14.1f  %14.1f\n", numThreads, mutexNs, ringNs);
+    }
+  return 0;
+}
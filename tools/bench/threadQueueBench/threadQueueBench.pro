@@ -0,0 +1,13 @@
+# ThreadQueue microbenchmark (qmake && make && ./threadQueueBench)
+TARGET = threadQueueBench
+TEMPLATE = app
+QT -= core gui
+CONFIG += c++20 console release warn_off
+CONFIG -= app_bundle
+LIBS += -pthread
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += threadQueueBench.cpp
+INCLUDEPATH = ../../../source/inc/threading
+
+OBJECTS_DIR = build/.obj